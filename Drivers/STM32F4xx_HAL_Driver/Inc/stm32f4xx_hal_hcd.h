@@ -74,6 +74,34 @@ typedef USB_OTG_HCTypeDef       HCD_HCTypeDef ;
 typedef USB_OTG_URBStateTypeDef HCD_URBStateTypeDef ;
 typedef USB_OTG_HCStateTypeDef  HCD_HCStateTypeDef ;
 
+/** 
+  * @brief  HCD per-channel statistics structure definition
+  *         Interrupt counters are written by the HCD interrupt handler
+  *         only, submission counters by the submitting thread only, always
+  *         with single word updates; use HAL_HCD_HC_GetStats to read a
+  *         consistent copy from thread context.
+  */ 
+typedef struct
+{
+  uint32_t                  xfrc;         /*!< Transfer completed interrupts          */
+  uint32_t                  nak;          /*!< NAK responses                          */
+  uint32_t                  stall;        /*!< STALL responses                        */
+  uint32_t                  txerr;        /*!< Transaction errors                     */
+  uint32_t                  bberr;        /*!< Babble errors                          */
+  uint32_t                  frmor;        /*!< Frame overruns                         */
+  uint32_t                  dterr;        /*!< Data toggle errors                     */
+  uint32_t                  bytes_in;     /*!< Bytes received by completed URBs       */
+  uint32_t                  bytes_out;    /*!< Bytes sent by completed URBs           */
+  uint32_t                  urb_count;    /*!< Completed URBs                         */
+  uint32_t                  urb_lat_max;  /*!< Max submit to done latency, CPU cycles */
+  uint32_t                  submit_count; /*!< Full submissions (thread context)      */
+  uint32_t                  submit_cycles;/*!< CPU cycles spent in full submissions   */
+  uint32_t                  rearm_count;  /*!< Re-arm submissions (thread context)    */
+  uint32_t                  rearm_cycles; /*!< CPU cycles spent in re-arm submissions */
+  uint32_t                  rxflvl;       /*!< Rx FIFO packets popped (slave mode)    */
+  
+} HCD_HCStatsTypeDef;
+
 /** 
   * @brief  HCD Handle Structure definition  
   */ 
@@ -82,6 +110,10 @@ typedef struct
   HCD_TypeDef               *Instance;  /*!< Register base address    */ 
   HCD_InitTypeDef           Init;       /*!< HCD required parameters  */
   HCD_HCTypeDef             hc[15];     /*!< Host channels parameters */
+  HCD_HCStatsTypeDef        hc_stats[15];  /*!< Host channels statistics        */
+  uint32_t                  hc_submit_cyc[15]; /*!< Cycle stamp of pending URB  */
+  __IO uint32_t             StatsSeq;   /*!< Odd while the ISR updates hc_stats */
+  uint32_t                  StatsTick;  /*!< HAL tick of the last statistics reset */
   HAL_LockTypeDef           Lock;       /*!< HCD peripheral status    */
   __IO HCD_StateTypeDef     State;      /*!< HCD communication state  */
   void                      *pData;     /*!< Pointer Stack Handler    */    
@@ -184,6 +216,10 @@ HAL_StatusTypeDef       HAL_HCD_HC_SubmitRequest(HCD_HandleTypeDef *hhcd,
                                                  uint8_t* pbuff, 
                                                  uint16_t length,
                                                  uint8_t do_ping);
+HAL_StatusTypeDef       HAL_HCD_HC_Rearm(HCD_HandleTypeDef *hhcd,
+                                         uint8_t ch_num,
+                                         uint8_t* pbuff,
+                                         uint16_t length);
 
  /* Non-Blocking mode: Interrupt */
 void                    HAL_HCD_IRQHandler(HCD_HandleTypeDef *hhcd);
@@ -209,6 +245,8 @@ uint32_t                HAL_HCD_HC_GetXferCount(HCD_HandleTypeDef *hhcd, uint8_t
 HCD_HCStateTypeDef      HAL_HCD_HC_GetState(HCD_HandleTypeDef *hhcd, uint8_t chnum);
 uint32_t                HAL_HCD_GetCurrentFrame(HCD_HandleTypeDef *hhcd);
 uint32_t                HAL_HCD_GetCurrentSpeed(HCD_HandleTypeDef *hhcd);
+HAL_StatusTypeDef       HAL_HCD_HC_GetStats(HCD_HandleTypeDef *hhcd, uint8_t chnum, HCD_HCStatsTypeDef *stats);
+void                    HAL_HCD_ResetStats(HCD_HandleTypeDef *hhcd);
 
 /**
   * @}
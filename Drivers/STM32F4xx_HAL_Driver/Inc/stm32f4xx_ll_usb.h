@@ -121,6 +121,12 @@ typedef struct
   uint32_t use_dedicated_ep1;    /*!< Enable or disable the use of the dedicated EP1 interrupt.              */      
   
   uint32_t use_external_vbus;    /*!< Enable or disable the use of the external VBUS.                        */   
+
+  uint32_t Host_rx_fifo_size;    /*!< Host Rx FIFO depth in 32-bit words, 0 keeps the default partition.   */
+
+  uint32_t Host_nptx_fifo_size;  /*!< Host non periodic Tx FIFO depth in 32-bit words.                       */
+
+  uint32_t Host_ptx_fifo_size;   /*!< Host periodic Tx FIFO depth in 32-bit words.                           */
   
 }USB_OTG_CfgTypeDef;
 
@@ -260,6 +266,15 @@ typedef struct
   * @}
   */
 
+/** @defgroup USB_Core_FIFO_RAM_
+  * @{
+  */
+#define USB_OTG_FS_TOTAL_FIFO_SIZE           320   /* 1.25 Kbytes, in 32-bit words */
+#define USB_OTG_HS_TOTAL_FIFO_SIZE           1024  /* 4 Kbytes, in 32-bit words */
+/**
+  * @}
+  */
+
 /** @defgroup USB_Core_Phy_Frequency_
   * @{
   */
@@ -430,6 +445,7 @@ HAL_StatusTypeDef USB_HC_Init(USB_OTG_GlobalTypeDef *USBx,
                                   uint8_t ep_type,
                                   uint16_t mps);
 HAL_StatusTypeDef USB_HC_StartXfer(USB_OTG_GlobalTypeDef *USBx, USB_OTG_HCTypeDef *hc, uint8_t dma);
+HAL_StatusTypeDef USB_HC_Rearm(USB_OTG_GlobalTypeDef *USBx, USB_OTG_HCTypeDef *hc, uint8_t dma);
 uint32_t          USB_HC_ReadInterrupt (USB_OTG_GlobalTypeDef *USBx);
 HAL_StatusTypeDef USB_HC_Halt(USB_OTG_GlobalTypeDef *USBx , uint8_t hc_num);
 HAL_StatusTypeDef USB_DoPing(USB_OTG_GlobalTypeDef *USBx , uint8_t ch_num);
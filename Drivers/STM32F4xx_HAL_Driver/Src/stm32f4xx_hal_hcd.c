@@ -80,34 +80,6 @@
  * Debug configuration
  *
  */
-#define DEBUG_HC_HAINT_ALL      ((uint32_t)0x0000FFFF)
-
-
-// uint32_t debug_hc_haint_mask = 0;                       /** init as none enabled **/
-uint32_t debug_hc_hcintx_mask[16] = {
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT,
-    DEBUG_HC_HCINTX_MASK_DEFAULT};                      /** init as none enabled **/
-
-static struct hcint_t hcint[16];
-static struct hcint_t hcint_last = {0};
-
-static uint32_t hc_report_channel[16];
-static unsigned int debug_hc_uid = 0;
-
 int debug_hal_hcd_hc_submitrequest_print = DEBUG_HAL_HCD_HC_SUBMITREQUEST_DEFAULT;
 int debug_hal_hcd_hc_submitrequest_halt = 0;
 
@@ -117,8 +89,10 @@ int debug_hal_hcd_hc_submitrequest_halt = 0;
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
 /* Private macro -------------------------------------------------------------*/
+#define __HCD_STATS_INC(__HANDLE__, chnum, __FIELD__)  ((__HANDLE__)->hc_stats[(chnum)].__FIELD__++)
 /* Private variables ---------------------------------------------------------*/
 /* Private function prototypes -----------------------------------------------*/
+static inline void HCD_HC_URBDone(HCD_HandleTypeDef *hhcd, uint8_t chnum);
 static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum);
 static inline void HCD_HC_OUT_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum);
 static inline void HCD_RXQLVL_IRQHandler(HCD_HandleTypeDef *hhcd);
@@ -159,6 +133,11 @@ HAL_StatusTypeDef HAL_HCD_Init(HCD_HandleTypeDef *hhcd)
   /* Init Host */
   USB_HostInit(hhcd->Instance, hhcd->Init);
 
+  /* Free running cycle counter used for URB latency statistics */
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+  HAL_HCD_ResetStats(hhcd);
+
   hhcd->State = HAL_HCD_STATE_READY;
 
   return HAL_OK;
@@ -341,6 +320,7 @@ HAL_StatusTypeDef HAL_HCD_HC_SubmitRequest(HCD_HandleTypeDef *hhcd,
                                             uint8_t do_ping) 
 {
   HAL_StatusTypeDef status;
+  uint32_t start = DWT->CYCCNT;
 
   if (debug_hal_hcd_hc_submitrequest_halt) {
     debug_hal_hcd_hc_submitrequest_halt = 0;
@@ -452,6 +432,7 @@ HAL_StatusTypeDef HAL_HCD_HC_SubmitRequest(HCD_HandleTypeDef *hhcd,
   hhcd->hc[ch_num].xfer_count = 0 ;
   hhcd->hc[ch_num].ch_num = ch_num;
   hhcd->hc[ch_num].state = HC_IDLE;
+  hhcd->hc_submit_cyc[ch_num] = start;
 
   status = USB_HC_StartXfer(hhcd->Instance, &(hhcd->hc[ch_num]), hhcd->Init.dma_enable);
 
@@ -459,9 +440,56 @@ HAL_StatusTypeDef HAL_HCD_HC_SubmitRequest(HCD_HandleTypeDef *hhcd,
     USBH_UsrLog("%s: ", __func__);
   }
 
+  hhcd->hc_stats[ch_num].submit_count++;
+  hhcd->hc_stats[ch_num].submit_cycles += DWT->CYCCNT - start;
+
   return status;
 }
 
+/**
+  * @brief  Re-arm a host channel for another IN transfer
+  * @note   Fast path for repeating interrupt and bulk IN polls. The channel
+  *         must be an opened bulk or interrupt IN channel whose address,
+  *         endpoint and type did not change since it was opened or last
+  *         submitted; PID selection follows the IN data toggle.
+  * @param  hhcd: HCD handle
+  * @param  ch_num: Channel number.
+  *         This parameter can be a value from 1 to 15
+  * @param  pbuff: pointer to URB data
+  * @param  length: Length of URB data
+  * @retval HAL status, HAL_ERROR if the channel can not be re-armed and
+  *         HAL_HCD_HC_SubmitRequest must be used instead
+  */
+HAL_StatusTypeDef HAL_HCD_HC_Rearm(HCD_HandleTypeDef *hhcd,
+                                   uint8_t ch_num,
+                                   uint8_t* pbuff,
+                                   uint16_t length)
+{
+  HCD_HCTypeDef *hc = &hhcd->hc[ch_num];
+  uint32_t start = DWT->CYCCNT;
+
+  if ((hc->ep_is_in == 0) ||
+      ((hc->ep_type != EP_TYPE_BULK) && (hc->ep_type != EP_TYPE_INTR)))
+  {
+    return HAL_ERROR;
+  }
+
+  hc->data_pid = (hc->toggle_in == 0) ? HC_PID_DATA0 : HC_PID_DATA1;
+  hc->xfer_buff = pbuff;
+  hc->xfer_len  = length;
+  hc->urb_state = URB_IDLE;
+  hc->xfer_count = 0;
+  hc->state = HC_IDLE;
+  hhcd->hc_submit_cyc[ch_num] = start;
+
+  USB_HC_Rearm(hhcd->Instance, hc, hhcd->Init.dma_enable);
+
+  hhcd->hc_stats[ch_num].rearm_count++;
+  hhcd->hc_stats[ch_num].rearm_cycles += DWT->CYCCNT - start;
+
+  return HAL_OK;
+}
+
 /**
   * @brief  This function handles HCD interrupt request.
   * @param  hhcd: HCD handle
@@ -545,70 +573,26 @@ void HAL_HCD_IRQHandler(HCD_HandleTypeDef *hhcd)
     {
       interrupt = USB_HC_ReadInterrupt(hhcd->Instance);
 
+      /* statistics are inconsistent while the sequence number is odd */
+      hhcd->StatsSeq++;
+      
       for (i = 0; i < hhcd->Init.Host_channels ; i++)
       {
         if (interrupt & (1 << i))
         {
-          // uint32_t HCINT = (USBx_HC(i)->HCINT);
-          hc_report_channel[i] = (debug_hc_hcintx_mask[i] & (USBx_HC(i)->HCINT));
-
-          if (hc_report_channel[i])
-          {
-            memset(&hcint[i], 0, sizeof(hcint[i]));
-            hcint[i].interrupt = interrupt;
-            hcint[i].hcint_reg = (USBx_HC(i)->HCINT);
-            hcint[i].in_state = hhcd->hc[i].state;
-            hcint[i].in_urbstate = hhcd->hc[i].urb_state;
-            hcint[i].in_err_count = hhcd->hc[i].ErrCnt;
-            hcint[i].uid = debug_hc_uid++;
-          }
-
           if ((USBx_HC(i)->HCCHAR) &  USB_OTG_HCCHAR_EPDIR)
           {
-            if (hc_report_channel[i]) {
-              hcint[i].direction = 1;
-            }
             HCD_HC_IN_IRQHandler(hhcd, i);
           }
           else
           {
-            if (hc_report_channel[i]) {
-              hcint[i].direction = 0;
-            }
             HCD_HC_OUT_IRQHandler(hhcd, i);
           }
-
-          if (hc_report_channel[i]) {
-            hcint[i].out_state = hhcd->hc[i].state;
-            hcint[i].out_urbstate = hhcd->hc[i].urb_state;
-            hcint[i].out_err_count = hhcd->hc[i].ErrCnt;
-          }
-        }
-        else {
-          hc_report_channel[i] = 0;
         }
       }
+      
+      hhcd->StatsSeq++;
       __HAL_HCD_CLEAR_FLAG(hhcd, USB_OTG_GINTSTS_HCINT);
-
-      for (i = 0; i < hhcd->Init.Host_channels ; i++) {
-        if (hc_report_channel[i]) {
-
-          if (hcint[i].hcint_reg == hcint_last.hcint_reg &&
-              hcint[i].in_state == hcint_last.in_state &&
-              hcint[i].out_state == hcint_last.out_state &&
-              hcint[i].in_urbstate == hcint_last.in_urbstate &&
-              hcint[i].out_urbstate == hcint_last.out_urbstate &&
-              hcint[i].in_err_count == hcint_last.in_err_count &&
-              hcint[i].out_err_count == hcint_last.out_err_count) {
-            // skip duplicate hc report
-          }
-          else {
-            USBH_LL_HCINT(hhcd->pData, &hcint[i]);
-          }
-
-          memcpy(&hcint_last, &hcint[i], sizeof(hcint_last));
-        }
-      }
     } 
     
         /* Handle Rx Queue Level Interrupts */
@@ -616,7 +600,9 @@ void HAL_HCD_IRQHandler(HCD_HandleTypeDef *hhcd)
     {
       USB_MASK_INTERRUPT(hhcd->Instance, USB_OTG_GINTSTS_RXFLVL);
       
+      hhcd->StatsSeq++;
       HCD_RXQLVL_IRQHandler (hhcd);
+      hhcd->StatsSeq++;
       
       USB_UNMASK_INTERRUPT(hhcd->Instance, USB_OTG_GINTSTS_RXFLVL);
     }
@@ -861,10 +847,85 @@ uint32_t HAL_HCD_GetCurrentSpeed(HCD_HandleTypeDef *hhcd)
   return (USB_GetHostSpeed(hhcd->Instance));
 }
 
+/**
+  * @brief  Take a consistent snapshot of a host channel statistics
+  * @note   The counters are only written by the HCD interrupt handler, which
+  *         makes StatsSeq odd while it runs. The copy is retried if the
+  *         handler preempted it, so neither side ever waits on a lock.
+  * @param  hhcd: HCD handle
+  * @param  chnum: Channel number.
+  *         This parameter can be a value from 1 to 15
+  * @param  stats: destination of the snapshot
+  * @retval HAL status
+  */
+HAL_StatusTypeDef HAL_HCD_HC_GetStats(HCD_HandleTypeDef *hhcd, uint8_t chnum, HCD_HCStatsTypeDef *stats)
+{
+  uint32_t seq;
+  
+  if ((stats == NULL) || (chnum >= hhcd->Init.Host_channels))
+  {
+    return HAL_ERROR;
+  }
+  
+  do
+  {
+    seq = hhcd->StatsSeq;
+    __DMB();
+    *stats = hhcd->hc_stats[chnum];
+    __DMB();
+  } while ((seq & 1) || (seq != hhcd->StatsSeq));
+  
+  return HAL_OK;
+}
+
+/**
+  * @brief  Clear the statistics of all host channels
+  * @param  hhcd: HCD handle
+  * @retval None
+  */
+void HAL_HCD_ResetStats(HCD_HandleTypeDef *hhcd)
+{
+  uint32_t primask = __get_PRIMASK();
+  
+  __disable_irq();
+  memset(hhcd->hc_stats, 0, sizeof(hhcd->hc_stats));
+  hhcd->StatsTick = HAL_GetTick();
+  hhcd->StatsSeq += 2;
+  __set_PRIMASK(primask);
+}
+
 /**
   * @}
   */
 
+/**
+  * @brief  Account a completed URB in the channel statistics.
+  * @param  hhcd: HCD handle
+  * @param  chnum: Channel number.
+  *         This parameter can be a value from 1 to 15
+  * @retval none
+  */
+static inline void HCD_HC_URBDone(HCD_HandleTypeDef *hhcd, uint8_t chnum)
+{
+  HCD_HCStatsTypeDef *stats = &hhcd->hc_stats[chnum];
+  uint32_t latency = DWT->CYCCNT - hhcd->hc_submit_cyc[chnum];
+  
+  if (hhcd->hc[chnum].ep_is_in)
+  {
+    stats->bytes_in += hhcd->hc[chnum].xfer_count;
+  }
+  else
+  {
+    stats->bytes_out += hhcd->hc[chnum].xfer_len;
+  }
+  stats->urb_count++;
+  
+  if (latency > stats->urb_lat_max)
+  {
+    stats->urb_lat_max = latency;
+  }
+}
+
 /**
   * @brief  This function handles Host Channel IN interrupt requests.
   * @param  hhcd: HCD handle
@@ -893,6 +954,7 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
   }
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_STALL)
   {
+    __HCD_STATS_INC(hhcd, chnum, stall);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum);
     hhcd->hc[chnum].state = HC_STALL;
     __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_NAK);
@@ -901,6 +963,7 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
   }
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_DTERR)
   {
+    __HCD_STATS_INC(hhcd, chnum, dterr);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum);
     hhcd->hc[chnum].state = HC_DATATGLERR;
     __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_NAK);    
@@ -910,12 +973,14 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
   
   if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_FRMOR)
   {
+    __HCD_STATS_INC(hhcd, chnum, frmor);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum); 
     USB_HC_Halt(hhcd->Instance, chnum);  
     __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_FRMOR);
   }
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_XFRC)
   {
+    __HCD_STATS_INC(hhcd, chnum, xfrc);
     
     if (hhcd->Init.dma_enable)
     {
@@ -940,11 +1005,20 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
     {
       USBx_HC(chnum)->HCCHAR |= USB_OTG_HCCHAR_ODDFRM;
       hhcd->hc[chnum].urb_state = URB_DONE; 
+      HCD_HC_URBDone(hhcd, chnum);
       HAL_HCD_HC_NotifyURBChange_Callback(hhcd, chnum, hhcd->hc[chnum].urb_state);
     }
     hhcd->hc[chnum].toggle_in ^= 1;
     
   }
+  else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_BBERR)
+  {
+    __HCD_STATS_INC(hhcd, chnum, bberr);
+    __HAL_HCD_UNMASK_HALT_HC_INT(chnum);
+    hhcd->hc[chnum].state = HC_BBLERR;
+    USB_HC_Halt(hhcd->Instance, chnum);
+    __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_BBERR);
+  }
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_CHH)
   {
     __HAL_HCD_MASK_HALT_HC_INT(chnum); 
@@ -952,6 +1026,7 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
     if(hhcd->hc[chnum].state == HC_XFRC)
     {
       hhcd->hc[chnum].urb_state  = URB_DONE;      
+      HCD_HC_URBDone(hhcd, chnum);
     }
     
     else if (hhcd->hc[chnum].state == HC_STALL) 
@@ -959,6 +1034,11 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
       hhcd->hc[chnum].urb_state  = URB_STALL;
     }   
     
+    else if (hhcd->hc[chnum].state == HC_BBLERR) 
+    {
+      hhcd->hc[chnum].urb_state  = URB_ERROR;
+    }   
+    
     else if((hhcd->hc[chnum].state == HC_XACTERR) ||
             (hhcd->hc[chnum].state == HC_DATATGLERR))
     {
@@ -996,6 +1076,7 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
   }
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_TXERR)
   {
+    __HCD_STATS_INC(hhcd, chnum, txerr);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum);
     hhcd->hc[chnum].ErrCnt++;
     hhcd->hc[chnum].state = HC_XACTERR;
@@ -1004,6 +1085,7 @@ static inline void HCD_HC_IN_IRQHandler(HCD_HandleTypeDef *hhcd, uint8_t chnum)
   }
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_NAK)
   {
+    __HCD_STATS_INC(hhcd, chnum, nak);
 //    if (hhcd->hc[chnum].state == HC_DATATGLERR) {
 //      /* re-activate the channel  */
 //      USBx_HC(chnum)->HCCHAR &= ~USB_OTG_HCCHAR_CHDIS;
@@ -1082,6 +1164,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
   
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_FRMOR)
   {
+    __HCD_STATS_INC(hhcd, chnum, frmor);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum); 
     USB_HC_Halt(hhcd->Instance, chnum);  
     __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_FRMOR);
@@ -1089,6 +1172,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
   
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_XFRC)
   {
+    __HCD_STATS_INC(hhcd, chnum, xfrc);
       hhcd->hc[chnum].ErrCnt = 0;  
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum);
     USB_HC_Halt(hhcd->Instance, chnum);   
@@ -1099,6 +1183,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
 
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_STALL)  
   {
+    __HCD_STATS_INC(hhcd, chnum, stall);
     __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_STALL);  
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum);
     USB_HC_Halt(hhcd->Instance, chnum);   
@@ -1107,6 +1192,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
 
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_NAK)
   {  
+    __HCD_STATS_INC(hhcd, chnum, nak);
     hhcd->hc[chnum].ErrCnt = 0;  
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum); 
     USB_HC_Halt(hhcd->Instance, chnum);   
@@ -1116,6 +1202,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
 
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_TXERR)
   {
+    __HCD_STATS_INC(hhcd, chnum, txerr);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum); 
     USB_HC_Halt(hhcd->Instance, chnum);      
     hhcd->hc[chnum].state = HC_XACTERR;  
@@ -1124,6 +1211,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
   
   else if ((USBx_HC(chnum)->HCINT) &  USB_OTG_HCINT_DTERR)
   {
+    __HCD_STATS_INC(hhcd, chnum, dterr);
     __HAL_HCD_UNMASK_HALT_HC_INT(chnum); 
     USB_HC_Halt(hhcd->Instance, chnum);      
     __HAL_HCD_CLEAR_HC_INT(chnum, USB_OTG_HCINT_NAK);
@@ -1139,6 +1227,7 @@ static inline void HCD_HC_OUT_IRQHandler  (HCD_HandleTypeDef *hhcd, uint8_t chnu
     if(hhcd->hc[chnum].state == HC_XFRC)
     {
       hhcd->hc[chnum].urb_state  = URB_DONE;
+      HCD_HC_URBDone(hhcd, chnum);
       if (hhcd->hc[chnum].ep_type == EP_TYPE_BULK)
       {
         hhcd->hc[chnum].toggle_out ^= 1; 
@@ -1200,6 +1289,8 @@ static inline void HCD_RXQLVL_IRQHandler  (HCD_HandleTypeDef *hhcd)
   channelnum = temp &  USB_OTG_GRXSTSP_EPNUM;  
   pktsts = (temp &  USB_OTG_GRXSTSP_PKTSTS) >> 17;
   pktcnt = (temp &  USB_OTG_GRXSTSP_BCNT) >> 4;
+  
+  __HCD_STATS_INC(hhcd, channelnum, rxflvl);
     
   switch (pktsts)
   {
@@ -1160,7 +1160,17 @@ HAL_StatusTypeDef USB_HostInit (USB_OTG_GlobalTypeDef *USBx, USB_OTG_CfgTypeDef
   USBx->GINTSTS = 0xFFFFFFFF;
 
   
-  if(USBx == USB_OTG_FS)
+  if (cfg.Host_rx_fifo_size && cfg.Host_nptx_fifo_size && cfg.Host_ptx_fifo_size)
+  {
+    /* caller supplied partition, validated against the FIFO RAM size */
+    USBx->GRXFSIZ  = cfg.Host_rx_fifo_size;
+    USBx->DIEPTXF0_HNPTXFSIZ = (uint32_t )(((cfg.Host_nptx_fifo_size << 16)& USB_OTG_NPTXFD) |
+                                           cfg.Host_rx_fifo_size);
+    USBx->HPTXFSIZ = (uint32_t )(((cfg.Host_ptx_fifo_size << 16)& USB_OTG_HPTXFSIZ_PTXFD) |
+                                 (cfg.Host_rx_fifo_size + cfg.Host_nptx_fifo_size));
+  }
+  
+  else if(USBx == USB_OTG_FS)
   {
     /* set Rx FIFO size */
     USBx->GRXFSIZ  = (uint32_t )0x80; 
@@ -1550,6 +1560,56 @@ HAL_StatusTypeDef USB_HC_StartXfer(USB_OTG_GlobalTypeDef *USBx, USB_OTG_HCTypeDe
   return HAL_OK;
 }
 
+/**
+  * @brief  Re-arm an IN host channel for a new transfer
+  * @note   HCCHAR (address, endpoint, type, mps) is kept as programmed by
+  *         USB_HC_Init, only the transfer size, packet count, PID and DMA
+  *         address are reloaded before the channel is enabled again.
+  * @param  USBx : Selected device
+  * @param  hc : pointer to host channel structure
+  * @param  dma: USB dma enabled or disabled 
+  *          This parameter can be one of the these values:
+  *           0 : DMA feature not used 
+  *           1 : DMA feature used  
+  * @retval HAL state
+  */
+HAL_StatusTypeDef USB_HC_Rearm(USB_OTG_GlobalTypeDef *USBx, USB_OTG_HCTypeDef *hc, uint8_t dma)
+{
+  uint32_t num_packets = 1;
+  uint32_t hcchar;
+  
+  if (hc->xfer_len > 0)
+  {
+    num_packets = (hc->xfer_len + hc->max_packet - 1) / hc->max_packet;
+    
+    if (num_packets > 256)
+    {
+      num_packets = 256;
+    }
+  }
+  hc->xfer_len = num_packets * hc->max_packet;
+  
+  USBx_HC(hc->ch_num)->HCTSIZ = (((hc->xfer_len) & USB_OTG_HCTSIZ_XFRSIZ)) |\
+    ((num_packets << 19) & USB_OTG_HCTSIZ_PKTCNT) |\
+      (((hc->data_pid) << 29) & USB_OTG_HCTSIZ_DPID);
+  
+  if (dma)
+  {
+    /* xfer_buff MUST be 32-bits aligned */
+    USBx_HC(hc->ch_num)->HCDMA = (uint32_t)hc->xfer_buff;
+  }
+  
+  /* odd frame selection and channel enable in a single write */
+  hcchar = USBx_HC(hc->ch_num)->HCCHAR & ~(USB_OTG_HCCHAR_ODDFRM | USB_OTG_HCCHAR_CHDIS);
+  if ((USBx_HOST->HFNUM & 0x01) == 0)
+  {
+    hcchar |= USB_OTG_HCCHAR_ODDFRM;
+  }
+  USBx_HC(hc->ch_num)->HCCHAR = hcchar | USB_OTG_HCCHAR_CHENA;
+  
+  return HAL_OK;
+}
+
 /**
   * @brief Read all host channel interrupts status
   * @param  USBx : Selected device
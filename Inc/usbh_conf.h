@@ -74,9 +74,82 @@
 /*----------   -----------*/
 #define USBH_DEBUG_LEVEL      3
  
+/*----------   -----------*/
+/* ms between host channel statistics printed by the application, 0 only prints them at port down */
+#define USBH_STATS_INTERVAL      0
+ 
 /*----------   -----------*/
 #define USBH_USE_OS      0 
  
+/*----------   -----------*/
+#define USBH_FIFO_PROFILE      USBH_FIFO_PROFILE_BALANCED
+ 
+/* OTG FIFO partition profiles applied by USBH_LL_Init */
+#define USBH_FIFO_PROFILE_BALANCED      0
+#define USBH_FIFO_PROFILE_HID_HEAVY     1
+#define USBH_FIFO_PROFILE_BULK_HEAVY    2
+ 
+/*----------   -----------*/
+/* HID interfaces of one device served at the same time */
+#define USBH_HID_MAX_INTERFACES      4
+ 
+/*----------   -----------*/
+/* ms an interface keeps polling at its bInterval after a changed report, 0 always polls slow */
+#define USBH_HID_BURST_HOLD      500
+/* SET_IDLE duration in 4 ms units, 0 reports only on change so idle polls are NAKed */
+#define USBH_HID_IDLE_RATE      0
+ 
+/*----------   -----------*/
+/* interrupt IN buffers per interface, one is filled while the others wait for decode */
+#define USBH_HID_IN_SLOTS      4
+ 
+/*----------   -----------*/
+/* output and feature reports waiting per interface, one entry per report ID */
+#define USBH_HID_OUT_QUEUE      4
+ 
+/*----------   -----------*/
+/* static region for the parsed HID device, 0 sizes a heap arena per device */
+#define USBH_HID_ARENA_SIZE      0
+ 
+/*----------   -----------*/
+/* decode input reports through the compiled program, 0 walks the fields */
+#define USBH_HID_COMPILED_DECODE      1
+ 
+/*----------   -----------*/
+/* events queued per input device until EV_SYN hands them to the handlers */
+#define USBH_HID_EVENT_RING      32
+ 
+/*----------   -----------*/
+/* register a handler that logs the held keys after every input batch */
+#define USBH_HID_INPUT_DEBUG      0
+ 
+/*----------   -----------*/
+/* collect keyboard-emulation scans into records, see usbh_hid_scan.c */
+#define USBH_HID_SCAN_ASSEMBLER      1
+#define USBH_HID_SCAN_MAX_LEN      128
+#define USBH_HID_SCAN_TIMEOUT      100  /* ms without a character ends a record */
+#define USBH_HID_SCAN_TERMINATORS      (HID_SCAN_TERM_CR | HID_SCAN_TERM_LF)
+#define USBH_HID_KEYMAP_LAYOUT      HID_KEYMAP_US
+ 
+/*----------   -----------*/
+/* ms between merged pointer motion reports, see usbh_hid_motion.c, 0 disables the stage */
+#define USBH_HID_MOTION_INTERVAL      0
+ 
+/*----------   -----------*/
+/* input report IDs whose unchanged repeats are dropped before decode, 0 disables */
+#define USBH_HID_DEDUP_IDS      4
+#define USBH_HID_DEDUP_LEN      64   /* longest report compared, one full speed packet */
+ 
+/*----------   -----------*/
+/* RAM keeping parsed descriptors across attaches, see usbh_hid_cache.c, 0 parses every attach */
+/* a boot keyboard takes under 4 KB, a mouse under 2 KB, a device too big is logged with its size */
+#define USBH_HID_CACHE_SIZE      0
+/* also keep them in a flash sector left out of the linker script, survives a reset, needs the RAM pool */
+#define USBH_HID_CACHE_FLASH      0
+#define USBH_HID_CACHE_FLASH_SECTOR      FLASH_SECTOR_7
+#define USBH_HID_CACHE_FLASH_ADDR      0x08060000
+#define USBH_HID_CACHE_FLASH_SIZE      0x20000
+ 
 
 /****************************************/
 /* #define for FS and HS identification */
@@ -268,8 +268,8 @@ static USBH_StatusTypeDef USBH_AOA_InterfaceInit(USBH_HandleTypeDef * phost)
     phost->pActiveClass->pData = &ADK_Machine;
     ADK_Machine.inSize = 0;
     ADK_Machine.outSize = 0;
-    USBH_AOA_ConfigEndpoints(phost);    // this function configure in/out pipes.
-    return USBH_OK;
+    // this function configure in/out pipes.
+    return USBH_AOA_ConfigEndpoints(phost);
   }
   else {
     USBH_UsrLog("AOA: Vendor id or Product id mismatch.");
@@ -388,7 +388,7 @@ static USBH_StatusTypeDef USBH_ADK_Handle(USBH_HandleTypeDef *phost)
 
     case ADK_GET_DATA:
 
-    USBH_BulkReceiveData(phost, ADK_Machine.inbuff, USBH_ADK_DATA_SIZE, ADK_Machine.hc_num_in);
+    USBH_RearmReceiveData(phost, ADK_Machine.inbuff, USBH_ADK_DATA_SIZE, ADK_Machine.hc_num_in);
     ADK_Machine.state = ADK_IDLE;
     break;
 
@@ -482,38 +482,27 @@ static USBH_StatusTypeDef USBH_AOA_Switch(USBH_HandleTypeDef *phost)
  */
 static USBH_StatusTypeDef USBH_AOA_ConfigEndpoints(USBH_HandleTypeDef * phost)
 {
+  USBH_EpDescTypeDef *ep_in, *ep_out;
+
   USBH_UsrLog("AOA: Configure bulk endpoint.");
 
-  if (phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[0].bEndpointAddress & 0x80)
+  /* do not assume the accessory is interface 0, use the one selected by
+   * USBH_AOA_InterfaceInit */
+  ep_in = USBH_FindEndpoint(phost, phost->device.current_interface,
+      USB_EP_TYPE_BULK, USB_EP_DIR_IN);
+  ep_out = USBH_FindEndpoint(phost, phost->device.current_interface,
+      USB_EP_TYPE_BULK, USB_EP_DIR_OUT);
+  if (ep_in == NULL || ep_out == NULL)
   {
-    ADK_Machine.BulkInEp =
-        (phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[0].bEndpointAddress);
-    ADK_Machine.BulkInEpSize =
-        phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[0].wMaxPacketSize;
-
-  }
-  else
-  {
-    ADK_Machine.BulkOutEp =
-        (phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[0].bEndpointAddress);
-    ADK_Machine.BulkOutEpSize =
-        phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[0].wMaxPacketSize;
+    USBH_UsrLog("AOA: Interface #%d has no bulk IN/OUT endpoint pair.",
+        phost->device.current_interface);
+    return USBH_FAIL;
   }
 
-  if (phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[1].bEndpointAddress & 0x80)
-  {
-    ADK_Machine.BulkInEp =
-        (phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[1].bEndpointAddress);
-    ADK_Machine.BulkInEpSize =
-        phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[1].wMaxPacketSize;
-  }
-  else
-  {
-    ADK_Machine.BulkOutEp =
-        (phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[1].bEndpointAddress);
-    ADK_Machine.BulkOutEpSize =
-        phost->device.CfgDesc.Itf_Desc[0].Ep_Desc[1].wMaxPacketSize;
-  }
+  ADK_Machine.BulkInEp = ep_in->bEndpointAddress;
+  ADK_Machine.BulkInEpSize = ep_in->wMaxPacketSize;
+  ADK_Machine.BulkOutEp = ep_out->bEndpointAddress;
+  ADK_Machine.BulkOutEpSize = ep_out->wMaxPacketSize;
 
   ADK_Machine.hc_num_out = USBH_AllocPipe(phost, ADK_Machine.BulkOutEp);
   ADK_Machine.hc_num_in = USBH_AllocPipe(phost, ADK_Machine.BulkInEp);
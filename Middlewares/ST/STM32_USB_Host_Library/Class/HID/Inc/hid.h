@@ -26,6 +26,7 @@
 #define __HID_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include "non-atomic.h"
 #include "list.h"
@@ -196,6 +197,7 @@ struct hid_item
 #define HID_UP_CUSTOM		0x00ff0000
 #define HID_UP_LOGIVENDOR	0xffbc0000
 #define HID_UP_SENSOR		0x00200000
+#define HID_UP_BARCODE		0x008c0000
 
 #define HID_USAGE		    0x0000ffff
 
@@ -236,6 +238,15 @@ struct hid_item
 
 #define HID_DC_BATTERYSTRENGTH	    0x00060020
 
+#define HID_BS_SCANNER		        0x008c0002
+#define HID_BS_SCANNEDDATA	        0x008c0012
+#define HID_BS_TRIGGERREPORT	    0x008c0014
+#define HID_BS_SYMBOLOGYID1	        0x008c00fb
+#define HID_BS_SYMBOLOGYID2	        0x008c00fc
+#define HID_BS_SYMBOLOGYID3	        0x008c00fd
+#define HID_BS_DECODEDDATA	        0x008c00fe
+#define HID_BS_DATACONTINUED	    0x008c00ff
+
 #define HID_DG_DIGITIZER	        0x000d0001
 #define HID_DG_PEN		            0x000d0002
 #define HID_DG_LIGHTPEN		        0x000d0003
@@ -315,6 +326,7 @@ struct hid_item
 #define HID_QUIRK_NO_EMPTY_INPUT		0x00000100
 #define HID_QUIRK_NO_INIT_INPUT_REPORTS	0x00000200
 #define HID_QUIRK_ALWAYS_POLL			0x00000400
+#define HID_QUIRK_IGNORE_MOUSE			0x00000800
 #define HID_QUIRK_SKIP_OUTPUT_REPORTS	0x00010000
 #define HID_QUIRK_FULLSPEED_INTERVAL	0x10000000
 #define HID_QUIRK_NO_INIT_REPORTS		0x20000000
@@ -370,8 +382,9 @@ struct hid_global
 
 struct hid_local
 {
-  unsigned usage[HID_MAX_USAGES]; /* usage array */
-  unsigned collection_index[HID_MAX_USAGES]; /* collection index array */
+  unsigned *usage; /* usage array */
+  unsigned *collection_index; /* collection index array */
+  unsigned usage_size; /* entries in both, at most HID_MAX_USAGES */
   unsigned usage_index;
   unsigned usage_minimum;
   unsigned delimiter_depth;
@@ -413,8 +426,18 @@ struct hid_usage
   int8_t hat_min; /* hat switch fun */
   int8_t hat_max; /* ditto */
   int8_t hat_dir; /* ditto */
+  uint8_t special; /* HID_SPECIAL_*, set with the mapping */
 };
 
+/* hid_usage.special, the value independent checks of hidinput_hid_event() */
+#define HID_SPECIAL_NONE        0   /* plain input_event() */
+#define HID_SPECIAL_HAT         1   /* hat switch or d-pad, two axis events */
+#define HID_SPECIAL_INVERT      2   /* digitizer Invert, HID_QUIRK_INVERT */
+#define HID_SPECIAL_INRANGE     3   /* digitizer InRange, tool keys */
+#define HID_SPECIAL_PRESSURE    4   /* digitizer TipPressure, BTN_TOUCH on HID_QUIRK_NOTOUCH */
+#define HID_SPECIAL_SKIP        5   /* nothing to report */
+#define HID_SPECIAL_VOLUME      6   /* relative volume, key presses */
+
 struct hid_input;
 
 //struct hid_field {
@@ -455,6 +478,8 @@ struct hid_field
   unsigned report_count; /* number of this field in the report */
   unsigned report_type; /* (input,output,feature) */
   int32_t *value; /* last known value(s) */
+  int32_t *new_value; /* decode scratch, input fields only */
+  uint32_t *present; /* input arrays: usage bitmap, then its scratch copy */
   int32_t logical_minimum;
   int32_t logical_maximum;
   int32_t physical_minimum;
@@ -470,15 +495,53 @@ struct hid_field
 
 #define HID_MAX_FIELDS 256
 
+/* 32-bit words of a bitmap with one bit per usage */
+#define HID_USAGE_WORDS(usages)   (((usages) + 31) / 32)
+
+/*
+ * compiled decode program, built by hid_compile_reports() once the usages
+ * are mapped. one op per value of a variable field, one per array field.
+ */
+#define HID_OP_RAW              0   /* store the value only */
+#define HID_OP_EMIT             1   /* store, then input_event(type, code) */
+#define HID_OP_EVENT            2   /* store, then hidinput_hid_event() */
+#define HID_OP_FIELD            3   /* hand the whole field to hid_input_field() */
+
+#define HID_OP_SIGNED           0x01
+#define HID_OP_RANGE            0x02    /* drop values outside the logical range */
+#define HID_OP_RELEASE          0x04    /* relative key, emit the release too */
+
+struct hid_decode_op
+{
+  uint16_t byte; /* first report byte of the value */
+  uint8_t shift; /* bit position in that byte */
+  uint8_t size; /* value width in bits */
+  uint8_t kind; /* HID_OP_* */
+  uint8_t flags; /* HID_OP_SIGNED, ... */
+  uint16_t code; /* input event code */
+  uint8_t type; /* input event type */
+  uint32_t mask; /* (1 << size) - 1 */
+  int32_t *slot; /* field->value[n] */
+  struct hid_field *field;
+  struct hid_usage *usage;
+};
+
+#define HID_LAYOUT_GENERIC      0
+#define HID_LAYOUT_BOOT_KBD     1   /* 8 modifier bits, pad byte, 6 keycodes */
+
 struct hid_report
 {
   struct list_head list;
   unsigned id; /* id of this report */
   unsigned type; /* report type */
-  struct hid_field *field[HID_MAX_FIELDS]; /* fields of the report */
+  struct hid_field **field; /* fields of the report */
+  unsigned field_size; /* entries in field[], from the descriptor scan */
   unsigned maxfield; /* maximum valid field index */
   unsigned size; /* size of the report (bits) */
   struct hid_device *device; /* associated device */
+  struct hid_decode_op *prog; /* compiled decode program, NULL walks the fields */
+  unsigned prog_len;
+  unsigned layout; /* HID_LAYOUT_* */
 };
 
 #define HID_MAX_IDS 256
@@ -487,7 +550,8 @@ struct hid_report_enum
 {
   unsigned numbered;
   struct list_head report_list;
-  struct hid_report *report_id_hash[HID_MAX_IDS];
+  struct hid_report **report_id_map; /* indexed by report id */
+  unsigned id_slots; /* highest declared report id + 1 */
 };
 
 #define HID_MIN_BUFFER_SIZE	    64		/* make sure there is at least a packet size of space */
@@ -611,6 +675,35 @@ struct hid_device {                         /* device report descriptor */
 };
 #endif
 
+/**
+ * per-device bump allocator
+ *
+ * reports, fields, collections, the descriptor copy and the hid inputs are
+ * carved from the bottom and are only released together by
+ * hid_close_report(). the parser scratch is taken from the top and handed
+ * back as soon as hid_open_report() is done with it.
+ */
+struct hid_arena
+{
+  uint8_t *base;
+  size_t size;
+  size_t used;            /* bottom, lives until hid_close_report() */
+  size_t top;             /* start of the temporary area */
+  size_t peak;            /* high water mark of both ends */
+  uint8_t owned;          /* base came from malloc */
+};
+
+/*
+ * what one pass over the report descriptor found, filled by
+ * hid_arena_estimate() and used to size the parsed structures exactly
+ */
+struct hid_desc_scan
+{
+  unsigned collections;
+  unsigned max_usages;                  /* most local usages ahead of one main item */
+  unsigned id_slots[HID_REPORT_TYPES];  /* highest report id + 1, 0 if the type is unused */
+};
+
 /**
  * simplified version of linux struct hid_device
  */
@@ -633,6 +726,10 @@ struct hid_device
   unsigned quirks;
 
   struct list_head inputs;					/* The list of inputs */
+
+  struct hid_arena arena;
+  struct hid_desc_scan scan;
+  uint8_t in_region;                /* hid_device itself lives in a caller region */
 };
 
 //static inline void *hid_get_drvdata(struct hid_device *hdev)
@@ -660,6 +757,7 @@ struct hid_parser
   unsigned collection_stack_ptr;
   struct hid_device *device;
   unsigned scan_flags;
+  uint16_t *field_counts[HID_REPORT_TYPES]; /* fields per report id, from the scan */
 };
 
 //struct hid_class_descriptor {
@@ -888,9 +986,13 @@ extern void hidinput_hid_event(struct hid_device *, struct hid_field *, struct h
 extern void hidinput_report_event(struct hid_device *hid, struct hid_report *report);
 extern int hidinput_connect(struct hid_device *hid, unsigned int force);
 extern void hidinput_disconnect(struct hid_device *);
+extern void hidinput_restore(struct hid_device *hid);
+extern int hidinput_usage_kind(struct hid_field *field, struct hid_usage *usage);
+extern unsigned int hidinput_keyboard_code(unsigned int usage);
+
+int hid_set_field(struct hid_field *, unsigned, int32_t);
 
 #if 0
-int hid_set_field(struct hid_field *, unsigned, __s32);
 int hid_input_report(struct hid_device *, int type, u8 *, int, int);
 int hidinput_find_field(struct hid_device *hid, unsigned int type, unsigned int code, struct hid_field **field);
 struct hid_field *hidinput_get_led_field(struct hid_device *hid);
@@ -900,12 +1002,17 @@ unsigned int hidinput_count_leds(struct hid_device *hid);
 // __s32 hidinput_calc_abs_res(const struct hid_field *field, __u16 code);
 int32_t hidinput_calc_abs_res(const struct hid_field *field, uint16_t code);
 
-#if 0
-void hid_output_report(struct hid_report *report, __u8 *data);
-u8 *hid_alloc_report_buf(struct hid_report *report, gfp_t flags);
-#endif
+void hid_output_report(struct hid_report *report, uint8_t *data);
+unsigned hid_report_len(struct hid_report *report);
 
 struct hid_device *hid_allocate_device(void);
+struct hid_device *hid_allocate_device_in(void *region, size_t size);
+size_t hid_arena_estimate(uint8_t *rdesc, unsigned rsize, struct hid_desc_scan *scan);
+void *hid_arena_alloc(struct hid_device *hdev, size_t size);
+int hid_compile_reports(struct hid_device *hid);
+uint32_t usbhid_lookup_quirk(const uint16_t idVendor, const uint16_t idProduct);
+size_t hid_save_device(struct hid_device *hdev, void *buf, size_t size);
+struct hid_device *hid_load_device(const void *buf, size_t len, void *region, size_t size);
 
 #if 0
 struct hid_report *hid_register_report(struct hid_device *device, unsigned type, unsigned id);
@@ -2,7 +2,9 @@
 #define __KERNEL_INPUT_H
 
 #include "non-atomic.h"
+#include "list.h"
 #include "uinput.h"
+#include "usbh_conf.h"
 
 struct hid_device;
 
@@ -24,11 +26,48 @@ struct input_dev
 
   unsigned int hint_events_per_packet;
 
+  unsigned long key[BITS_TO_LONGS(KEY_CNT)];  /* keys currently held */
+
   struct input_absinfo *absinfo;
 
   struct hid_device *hiddev;
+
+  /* events of the report being decoded, up to and including its EV_SYN */
+  unsigned int num_vals;
+  struct input_event vals[USBH_HID_EVENT_RING];
+};
+
+/*
+ * A consumer of input events. Handlers are called once per EV_SYN with the
+ * events that changed state since the previous one, the closing SYN_REPORT
+ * included; the batch is only valid for the duration of the call.
+ */
+struct input_handler
+{
+  const char *name;
+  void (*events)(struct input_handler *handler, struct input_dev *dev,
+      const struct input_event *vals, unsigned int count);
+  void *private;
+
+  struct list_head node;
 };
 
+int input_register_handler(struct input_handler *handler);
+void input_unregister_handler(struct input_handler *handler);
+
+void input_event(struct input_dev *dev, unsigned int type, unsigned int code,
+    int value);
+
+static inline void input_sync(struct input_dev *dev)
+{
+  input_event(dev, EV_SYN, SYN_REPORT, 0);
+}
+
+static inline int input_key_pressed(struct input_dev *dev, unsigned int code)
+{
+  return code < KEY_CNT && test_bit(code, dev->key);
+}
+
 
 /**
  * input_set_events_per_packet - tell handlers about the driver event rate
@@ -29,10 +29,10 @@
 //};
 struct input_event
 {
-  // struct timeval time; // TODO
+  uint32_t time;        /* HAL tick (ms) the event was queued at */
   uint16_t type;
   uint16_t code;
-  uint32_t value;
+  int32_t value;
 };
 /*
  * Protocol version.
@@ -62,7 +62,9 @@
 #define HID_REPORT_SIZE             16    
 #define HID_MAX_USAGE               10
 #define HID_MAX_NBR_REPORT_FMT      10 
-#define HID_QUEUE_SIZE              10    
+#define HID_QUEUE_SIZE              4     /* reports, see USBH_HID_GetKeybdInfo() */
+#define HID_PACKET_SIZE             64    /* largest full speed interrupt packet */
+#define HID_OUT_NAK_RETRIES         4     /* NAKed OUT reports resent, then SET_REPORT */
     
 #define  HID_ITEM_LONG                              0xFE
 
@@ -138,6 +140,15 @@ typedef enum
 }
 HID_CtlStateTypeDef;
 
+/* States of the output report engine */
+typedef enum
+{
+  HID_OUT_IDLE = 0,
+  HID_OUT_PIPE,                 /* on the interrupt OUT pipe */
+  HID_OUT_CONTROL,              /* SET_REPORT on the control pipe */
+}
+HID_OutStateTypeDef;
+
 typedef enum
 {
   HID_MOUSE    = 0x01,
@@ -206,15 +217,35 @@ typedef struct _HIDDescriptor
 HID_DescTypeDef;
 
 
-typedef struct 
+/* one report, see USBH_HID_QueueInit() */
+typedef struct
 {
-     uint8_t  *buf;
-     uint16_t  head;
-     uint16_t tail;
-     uint16_t size;
-     uint8_t  lock;
-} FIFO_TypeDef;
+  uint32_t time;                /* phost->Timer at URB completion */
+  uint16_t length;
+  uint8_t  id;                  /* report ID, 0 if the device numbers none */
+  uint8_t  data[HID_PACKET_SIZE];
+}
+HID_RecordTypeDef;
 
+/* single producer, single consumer queue of reports, safe between ISR and main loop */
+typedef struct
+{
+  HID_RecordTypeDef *slot;
+  uint8_t size;
+  volatile uint8_t head;        /* written by the producer only */
+  volatile uint8_t tail;        /* written by the consumer only */
+}
+HID_QueueTypeDef;
+
+/* last report of one input report ID, see USBH_HID_ReportChanged() */
+typedef struct
+{
+  uint8_t  id;
+  uint16_t length;              /* 0 until the first report */
+  uint32_t data[(USBH_HID_DEDUP_LEN + 3) / 4];
+  uint32_t relative[(USBH_HID_DEDUP_LEN + 3) / 4];  /* bits of relative fields */
+}
+HID_LastReportTypeDef;
 
 /* Structure for HID process */
 /*
@@ -228,20 +259,91 @@ typedef struct _HID_Process
   uint8_t OutEp;
   uint8_t InEp;
   HID_CtlStateTypeDef ctl_state;
-  FIFO_TypeDef fifo;
   uint8_t *pData;
   uint16_t length;
+  uint16_t OutLength;         /* OUT endpoint wMaxPacketSize */
+  uint8_t OutPoll;            /* OUT endpoint bInterval, ms between resends */
   uint8_t ep_addr;
   uint16_t poll;
-  uint16_t timer;
+  uint32_t timer;
   uint8_t DataReady;
   HID_DescTypeDef HID_Desc;
   USBH_StatusTypeDef (*Init)(USBH_HandleTypeDef *phost);
+  uint8_t interface;          /* index in phost->device.CfgDesc.Itf_Desc */
 
   /* embed a linux hid_device inside st hid handle */
   struct hid_device *hiddev;
+
+  /* report decode statistics, in DWT cycles */
+  uint32_t decode_count;
+  uint32_t decode_cycles;
+  uint32_t decode_max;
+  uint32_t decode_start;      /* phost->Timer at interface init */
+
+  /* class request to first decoded report */
+  uint32_t attach_tick;       /* HAL_GetTick() at HID_REQ_INIT */
+  uint32_t attach_cycles;     /* DWT->CYCCNT at HID_REQ_INIT */
+  uint8_t  attach_cached;     /* the parsed descriptor came from the cache */
+  uint8_t  attach_done;       /* first report decoded */
+
+  /* interrupt IN reports, the pipe fills USBH_HID_QueueBack(&in) */
+  HID_RecordTypeDef in_slot[USBH_HID_IN_SLOTS];
+  HID_QueueTypeDef in;
+  uint32_t in_overrun;        /* reports lost to a full queue */
+  uint8_t  in_flight;         /* an IN is submitted on InPipe and not completed */
+
+  /* reports for USBH_HID_GetKeybdInfo() and USBH_HID_GetMouseInfo(), boot
+     interfaces only: the GET_REPORT at start, then every changed IN report.
+     New reports are dropped while it is full */
+  HID_RecordTypeDef fifo_slot[HID_QUEUE_SIZE];
+  HID_QueueTypeDef fifo;
+
+  /* unchanged report suppression */
+#if (USBH_HID_DEDUP_IDS > 0)
+  HID_LastReportTypeDef last[USBH_HID_DEDUP_IDS];
+#endif
+  uint8_t  last_count;
+  uint8_t  last_numbered;
+  uint32_t dup_count;         /* reports dropped as unchanged */
+  uint32_t short_count;       /* short reports longer than a packet, dropped */
+  uint32_t unknown_count;     /* reports with an undeclared report ID, dropped */
+
+  /* adaptive polling, see USBH_HID_BURST_HOLD */
+  uint16_t poll_idle;         /* interval while the device is quiet */
+  uint16_t poll_burst;        /* endpoint bInterval, while reports flow */
+  uint32_t last_data;         /* phost->Timer of the last changed report */
+  uint32_t poll_prev;         /* phost->Timer of the previous IN request */
+  uint32_t mode_start;        /* phost->Timer of the last mode switch */
+  uint32_t mode_ms[2];        /* time spent idle, in burst */
+  uint32_t mode_polls[2];     /* IN requests issued idle, in burst */
+  uint32_t burst_count;
+  uint32_t first_sum;         /* wait bound of each burst's first report, ms */
+  uint32_t first_max;
+
+  /* output and feature reports to send, built from their field values when sent */
+  struct hid_report *out_queue[USBH_HID_OUT_QUEUE];
+  uint8_t  out_count;
 } HID_HandleTypeDef;
 
+/* every HID interface of the device, phost->pActiveClass->pData */
+typedef struct
+{
+  HID_HandleTypeDef *itf[USBH_HID_MAX_INTERFACES];
+  uint8_t count;
+  uint8_t current;            /* handle the class functions work on */
+  uint32_t quirks;            /* HID_QUIRK_* of the device, by USB id */
+
+  /* the one report in flight, see USBH_HID_SetUsage() */
+  HID_OutStateTypeDef out_state;
+  uint8_t out_itf;
+  uint8_t out_type;
+  uint8_t out_id;
+  uint8_t out_len;
+  uint8_t out_retry;          /* resends after a NAK */
+  uint32_t out_timer;         /* phost->Timer of the last send */
+  uint8_t out[HID_PACKET_SIZE];
+} HID_InterfacesTypeDef;
+
 /**
   * @}
   */ 
@@ -320,15 +422,29 @@ USBH_StatusTypeDef USBH_HID_SetProtocol (USBH_HandleTypeDef *phost,
 
 void USBH_HID_EventCallback(USBH_HandleTypeDef *phost);
 
+HID_HandleTypeDef *USBH_HID_GetHandle(USBH_HandleTypeDef *phost);
+
+USBH_StatusTypeDef USBH_HID_SetUsage(USBH_HandleTypeDef *phost, uint8_t type,
+                                     uint32_t usage, int32_t value);
+
 HID_TypeTypeDef USBH_HID_GetDeviceType(USBH_HandleTypeDef *phost);
 
 uint8_t USBH_HID_GetPollInterval(USBH_HandleTypeDef *phost);
 
-void fifo_init(FIFO_TypeDef * f, uint8_t * buf, uint16_t size);
+void USBH_HID_QueueInit(HID_QueueTypeDef *q, HID_RecordTypeDef *slot, uint8_t size);
+
+HID_RecordTypeDef *USBH_HID_QueueBack(HID_QueueTypeDef *q);
+
+uint8_t USBH_HID_QueuePush(HID_QueueTypeDef *q);
+
+HID_RecordTypeDef *USBH_HID_QueueFront(HID_QueueTypeDef *q);
+
+void USBH_HID_QueuePop(HID_QueueTypeDef *q);
 
-uint16_t  fifo_read(FIFO_TypeDef * f, void * buf, uint16_t  nbytes);
+uint16_t USBH_HID_QueueWrite(HID_QueueTypeDef *q, uint8_t id, uint32_t time,
+                             const void *data, uint16_t length);
 
-uint16_t  fifo_write(FIFO_TypeDef * f, const void * buf, uint16_t  nbytes);
+uint16_t USBH_HID_QueueRead(HID_QueueTypeDef *q, void *buf, uint16_t size);
 
 /**
   * @}
@@ -0,0 +1,84 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_cache.h
+  * @brief   This file contains all the prototypes for the usbh_hid_cache.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive -----------------------------------------------*/
+#ifndef __USBH_HID_CACHE_H
+#define __USBH_HID_CACHE_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "usbh_core.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_HID_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_HID_CACHE
+  * @brief This file is the Header file for USBH_HID_CACHE.c
+  * @{
+  */
+
+
+/** @defgroup USBH_HID_CACHE_Exported_Types
+  * @{
+  */
+
+/* a device parses the same way while all of this is unchanged */
+typedef struct
+{
+  uint16_t vid;
+  uint16_t pid;
+  uint16_t bcd;                 /* bcdDevice */
+  uint16_t rsize;               /* report descriptor bytes */
+  uint32_t crc;                 /* of the report descriptor */
+}
+HID_CACHE_KeyTypeDef;
+
+/**
+  * @}
+  */
+
+/** @defgroup USBH_HID_CACHE_Exported_FunctionsPrototype
+  * @{
+  */
+
+struct hid_device;
+
+void               USBH_HID_CacheKey(USBH_HandleTypeDef *phost, const uint8_t *rdesc, uint16_t rsize,
+                                     HID_CACHE_KeyTypeDef *key);
+struct hid_device *USBH_HID_CacheLoad(const HID_CACHE_KeyTypeDef *key, void *region, size_t size);
+void               USBH_HID_CacheStore(const HID_CACHE_KeyTypeDef *key, struct hid_device *hiddev);
+
+/**
+  * @}
+  */
+
+#endif /* __USBH_HID_CACHE_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,100 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_keymap.h
+  * @brief   This file contains all the prototypes for the usbh_hid_keymap.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive -----------------------------------------------*/
+#ifndef __USBH_HID_KEYMAP_H
+#define __USBH_HID_KEYMAP_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_HID_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_HID_KEYMAP
+  * @brief This file is the Header file for USBH_HID_KEYMAP.c
+  * @{
+  */
+
+
+/** @defgroup USBH_HID_KEYMAP_Exported_Types
+  * @{
+  */
+
+/* largest output of one key: a pending dead key plus the key itself */
+#define HID_KEYMAP_UTF8_MAX                    8
+
+/* modifier bits, same layout as the boot keyboard report byte 0 */
+#define HID_KEYMAP_MOD_LCTRL                   0x01
+#define HID_KEYMAP_MOD_LSHIFT                  0x02
+#define HID_KEYMAP_MOD_LALT                    0x04
+#define HID_KEYMAP_MOD_LGUI                    0x08
+#define HID_KEYMAP_MOD_RCTRL                   0x10
+#define HID_KEYMAP_MOD_RSHIFT                  0x20
+#define HID_KEYMAP_MOD_RALT                    0x40
+#define HID_KEYMAP_MOD_RGUI                    0x80
+
+typedef enum
+{
+  HID_KEYMAP_US = 0,
+  HID_KEYMAP_UK,
+  HID_KEYMAP_DE,
+  HID_KEYMAP_FR,
+  HID_KEYMAP_NUM,
+}
+HID_KEYMAP_LayoutTypeDef;
+
+typedef struct
+{
+  const uint16_t (*keys)[3];    /* plain, shift and AltGr symbol per keycode */
+  uint8_t  altgr;               /* right Alt selects the third column */
+  uint8_t  mods;                /* HID_KEYMAP_MOD_* currently held */
+  uint8_t  capslock;
+  uint8_t  boot_keys[6];        /* previous boot report key array */
+  uint16_t dead;                /* pending dead key, 0 if none */
+}
+HID_KEYMAP_StateTypeDef;
+
+struct input_event;
+
+void     USBH_HID_KeymapInit(HID_KEYMAP_StateTypeDef *km, HID_KEYMAP_LayoutTypeDef layout);
+uint32_t USBH_HID_KeymapKey(HID_KEYMAP_StateTypeDef *km, uint16_t code, int32_t value, uint8_t *out);
+uint32_t USBH_HID_KeymapEvents(HID_KEYMAP_StateTypeDef *km, const struct input_event *vals,
+                               uint32_t count, uint8_t *out, uint32_t size);
+uint32_t USBH_HID_KeymapBootReport(HID_KEYMAP_StateTypeDef *km, const uint8_t *report,
+                                   uint8_t *out, uint32_t size);
+
+/**
+  * @}
+  */
+
+#endif /* __USBH_HID_KEYMAP_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_motion.h
+  * @brief   This file contains all the prototypes for the usbh_hid_motion.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive -----------------------------------------------*/
+#ifndef __USBH_HID_MOTION_H
+#define __USBH_HID_MOTION_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbh_conf.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_HID_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_HID_MOTION
+  * @brief This file is the Header file for USBH_HID_MOTION.c
+  * @{
+  */
+
+
+/** @defgroup USBH_HID_MOTION_Exported_Types
+  * @{
+  */
+
+typedef struct
+{
+  uint32_t time;                /* HAL tick of the flush */
+  int8_t   x;                   /* REL_X since the previous report, saturated */
+  int8_t   y;                   /* REL_Y */
+  int8_t   wheel;               /* REL_WHEEL */
+  uint8_t  buttons;             /* bit n is BTN_MOUSE + n, held now */
+  uint16_t merged;              /* input reports folded into this one */
+}
+HID_MOTION_ReportTypeDef;
+
+void USBH_HID_MotionStart(void);
+void USBH_HID_MotionStop(void);
+void USBH_HID_MotionPoll(void);
+void USBH_HID_MotionCallback(const HID_MOTION_ReportTypeDef *report);
+
+/**
+  * @}
+  */
+
+#endif /* __USBH_HID_MOTION_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
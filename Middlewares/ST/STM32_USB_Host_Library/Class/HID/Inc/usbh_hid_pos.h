@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_pos.h
+  * @brief   This file contains all the prototypes for the usbh_hid_pos.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive -----------------------------------------------*/
+#ifndef __USBH_HID_POS_H
+#define __USBH_HID_POS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_core.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_HID_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_HID_POS
+  * @brief This file is the Header file for USBH_HID_POS.c
+  * @{
+  */
+
+
+/** @defgroup USBH_HID_POS_Exported_FunctionsPrototype
+  * @{
+  */
+
+struct hid_device;
+
+USBH_StatusTypeDef USBH_HID_PosConnect(struct hid_device *hiddev);
+void               USBH_HID_PosDisconnect(struct hid_device *hiddev);
+USBH_StatusTypeDef USBH_HID_PosDecode(struct hid_device *hiddev, uint8_t *data, uint32_t length);
+USBH_StatusTypeDef USBH_HID_PosTrigger(USBH_HandleTypeDef *phost, uint8_t on);
+
+/**
+  * @}
+  */
+
+#endif /* __USBH_HID_POS_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_scan.h
+  * @brief   This file contains all the prototypes for the usbh_hid_scan.c
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive -----------------------------------------------*/
+#ifndef __USBH_HID_SCAN_H
+#define __USBH_HID_SCAN_H
+
+/* Includes ------------------------------------------------------------------*/
+#include <stdint.h>
+#include "usbh_conf.h"
+#include "usbh_hid_keymap.h"
+
+/** @addtogroup USBH_LIB
+  * @{
+  */
+
+/** @addtogroup USBH_CLASS
+  * @{
+  */
+
+/** @addtogroup USBH_HID_CLASS
+  * @{
+  */
+
+/** @defgroup USBH_HID_SCAN
+  * @brief This file is the Header file for USBH_HID_SCAN.c
+  * @{
+  */
+
+
+/** @defgroup USBH_HID_SCAN_Exported_Types
+  * @{
+  */
+
+/* characters that may end a record, see USBH_HID_ScanSetup() */
+#define HID_SCAN_TERM_CR                       0x01
+#define HID_SCAN_TERM_LF                       0x02
+#define HID_SCAN_TERM_TAB                      0x04
+
+typedef struct
+{
+  uint32_t start;               /* HAL tick of the first character */
+  uint32_t end;                 /* HAL tick of the last character */
+  uint16_t length;              /* UTF-8 bytes in data, terminator excluded */
+  uint8_t  terminator;          /* character that ended the record, 0 on timeout */
+  uint8_t  symbology[3];        /* HID POS symbology identifiers, 0 in keyboard mode */
+  uint8_t  data[USBH_HID_SCAN_MAX_LEN];
+}
+HID_SCAN_RecordTypeDef;
+
+void USBH_HID_ScanSetup(HID_KEYMAP_LayoutTypeDef layout, uint8_t terminators, uint32_t timeout);
+void USBH_HID_ScanStart(void);
+void USBH_HID_ScanStop(void);
+void USBH_HID_ScanPoll(void);
+void USBH_HID_ScanCallback(const HID_SCAN_RecordTypeDef *record);
+
+/**
+  * @}
+  */
+
+#endif /* __USBH_HID_SCAN_H */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
+
+/**
+  * @}
+  */
@@ -16,7 +16,10 @@
  */
 #include <errno.h>
 
+#include "uinput.h"
+#include "kinput.h"
 #include "hid.h"
+#include "hid-ids.h"
 #include "usbh_def.h"
 #include "usbh_conf.h"
 
@@ -81,6 +84,69 @@ static const char *hid_gpd_strings[] =
 { "Undefined", "Pointer", "Mouse", "Reserved", "Joystick", "Gamepad", "Keyboard",
     "Keypad", "Multi-Axis Controller" };
 
+/*
+ * Arena allocator. Everything a parsed device owns is taken from one block
+ * sized by hid_arena_estimate(), so parsing never fragments the heap and
+ * hid_close_report() drops it all at once.
+ */
+
+#define HID_ARENA_ALIGN         8
+#define HID_ARENA_ROUND(n)      (((n) + HID_ARENA_ALIGN - 1) & ~(size_t)(HID_ARENA_ALIGN - 1))
+
+static void hid_arena_track(struct hid_arena *arena)
+{
+  size_t in_use = arena->used + (arena->size - arena->top);
+
+  if (in_use > arena->peak)
+    arena->peak = in_use;
+}
+
+/*
+ * Zeroed allocation from the bottom of the device arena.
+ */
+void *hid_arena_alloc(struct hid_device *hdev, size_t size)
+{
+  struct hid_arena *arena = &hdev->arena;
+  void *p;
+
+  size = HID_ARENA_ROUND(size);
+  if (arena->base == NULL || size > arena->top - arena->used)
+  {
+    USBH_ErrLog("HID: arena exhausted, %u of %u bytes used, %u requested",
+        (unsigned)arena->used, (unsigned)arena->size, (unsigned)size);
+    return NULL;
+  }
+
+  p = arena->base + arena->used;
+  arena->used += size;
+  hid_arena_track(arena);
+  memset(p, 0, size);
+  return p;
+}
+
+/*
+ * Zeroed allocation from the top of the device arena, released in one go
+ * by hid_arena_release_temp().
+ */
+static void *hid_arena_alloc_temp(struct hid_device *hdev, size_t size)
+{
+  struct hid_arena *arena = &hdev->arena;
+
+  size = HID_ARENA_ROUND(size);
+  if (arena->base == NULL || size > arena->top - arena->used)
+    return NULL;
+
+  arena->top -= size;
+  hid_arena_track(arena);
+  memset(arena->base + arena->top, 0, size);
+  return arena->base + arena->top;
+}
+
+static void hid_arena_release_temp(struct hid_device *hdev)
+{
+  hdev->arena.top = hdev->arena.size;
+}
+
 /*
  * Register a new report for a device.
  */
@@ -92,18 +158,17 @@ struct hid_report *hid_register_report(struct hid_device *device, unsigned type,
 
   // USBH_UsrLog("hid_register_report, type: %d, id: %d", type, id);
 
-  if (id >= HID_MAX_IDS)
+  /* the map is sized by hid_open_report() to the ids the descriptor declares */
+  if (id >= report_enum->id_slots)
     return NULL ;
-  if (report_enum->report_id_hash[id])
-    return report_enum->report_id_hash[id];
+  if (report_enum->report_id_map[id])
+    return report_enum->report_id_map[id];
 
   // report = kzalloc(sizeof(struct hid_report), GFP_KERNEL);
-  report = malloc(sizeof(struct hid_report));
+  report = hid_arena_alloc(device, sizeof(struct hid_report));
   if (!report)
     return NULL ;
 
-  memset(report, 0, sizeof(struct hid_report));
-
   if (id != 0)
     report_enum->numbered = 1;
 
@@ -111,7 +176,7 @@ struct hid_report *hid_register_report(struct hid_device *device, unsigned type,
   report->type = type;
   report->size = 0;
   report->device = device;
-  report_enum->report_id_hash[id] = report;
+  report_enum->report_id_map[id] = report;
 
   list_add_tail(&report->list, &report_enum->report_list);
 
@@ -125,12 +190,15 @@ struct hid_report *hid_register_report(struct hid_device *device, unsigned type,
  * Register a new field for this report.
  */
 
-static struct hid_field *hid_register_field(struct hid_report *report, unsigned usages, unsigned values)
+static struct hid_field *hid_register_field(struct hid_report *report, unsigned usages,
+    unsigned values, unsigned flags)
 {
 	struct hid_field *field;
 	size_t size;
+	unsigned scratch;
+	unsigned words;
 
-	if (report->maxfield == HID_MAX_FIELDS) {
+	if (report->maxfield == report->field_size) {
 		hid_err(report->device, "too many fields in report\n");
 		return NULL;
 	}
@@ -139,19 +207,31 @@ static struct hid_field *hid_register_field(struct hid_report *report, unsigned
 //			 usages * sizeof(struct hid_usage) +
 //			 values * sizeof(unsigned)), GFP_KERNEL);
 
+	/*
+	 * input fields also get the scratch array hid_input_field() decodes
+	 * into, so the report path never touches the heap
+	 */
+	scratch = (report->type == HID_INPUT_REPORT) ? values : 0;
+
+	/* input arrays diff pressed usages as bitmaps, one bit per usage */
+	words = (scratch && !(flags & HID_MAIN_ITEM_VARIABLE)) ?
+	    HID_USAGE_WORDS(usages) : 0;
+
 	size = (sizeof(struct hid_field) +
         usages * sizeof(struct hid_usage) +
-        values * sizeof(unsigned));
-    field = malloc(size);
+        (values + scratch) * sizeof(int32_t) +
+        2 * words * sizeof(uint32_t));
+	field = hid_arena_alloc(report->device, size);
 	if (!field)
 		return NULL;
-	memset(field, 0, size);
 
 	field->index = report->maxfield++;
 	report->field[field->index] = field;
 	field->usage = (struct hid_usage *)(field + 1);
 	// field->value = (s32 *)(field->usage + usages);
 	field->value = (int32_t *)(field->usage + usages);
+	field->new_value = scratch ? field->value + values : NULL;
+	field->present = words ? (uint32_t *)(field->value + values + scratch) : NULL;
 	field->report = report;
 
 	return field;
@@ -168,7 +248,7 @@ static int open_collection(struct hid_parser *parser, unsigned type)
 
   // USBH_UsrLog("open collection");
 
-  usage = parser->local.usage[0];
+  usage = parser->local.usage_index ? parser->local.usage[0] : 0;
 
   if (parser->collection_stack_ptr == HID_COLLECTION_STACK_SIZE)
   {
@@ -180,7 +260,8 @@ static int open_collection(struct hid_parser *parser, unsigned type)
   {
     // collection = kmalloc(sizeof(struct hid_collection) *
     //		parser->device->collection_size * 2, GFP_KERNEL);
-    collection = malloc(
+    /* only reached if the estimate was off, the old array stays in the arena */
+    collection = hid_arena_alloc(parser->device,
         sizeof(struct hid_collection) * parser->device->collection_size * 2);
 
     if (collection == NULL)
@@ -190,9 +271,6 @@ static int open_collection(struct hid_parser *parser, unsigned type)
     }
     memcpy(collection, parser->device->collection,
         sizeof(struct hid_collection) * parser->device->collection_size);
-    memset(collection + parser->device->collection_size, 0,
-        sizeof(struct hid_collection) * parser->device->collection_size);
-    free(parser->device->collection);
     parser->device->collection = collection;
     parser->device->collection_size *= 2;
   }
@@ -251,7 +329,7 @@ static unsigned hid_lookup_collection(struct hid_parser *parser, unsigned type)
 
 static int hid_add_usage(struct hid_parser *parser, unsigned usage)
 {
-  if (parser->local.usage_index >= HID_MAX_USAGES)
+  if (parser->local.usage_index >= parser->local.usage_size)
   {
     hid_err(parser->device, "usage index exceeded\n");
     return -1;
@@ -287,6 +365,15 @@ static int hid_add_field(struct hid_parser *parser, unsigned report_type, unsign
 		return -1;
 	}
 
+	/* first field of a new report, size its field array from the scan */
+	if (!report->field) {
+		report->field_size = parser->field_counts[report_type][report->id];
+		report->field = hid_arena_alloc(parser->device,
+		    report->field_size * sizeof(struct hid_field *));
+		if (!report->field)
+			return -1;
+	}
+
 	/* Handle both signed and unsigned cases properly */
 	if ((parser->global.logical_minimum < 0 &&
 		parser->global.logical_maximum <
@@ -310,7 +397,7 @@ static int hid_add_field(struct hid_parser *parser, unsigned report_type, unsign
 	usages = max_t(unsigned, parser->local.usage_index,
 				 parser->global.report_count);
 
-	field = hid_register_field(report, usages, parser->global.report_count);
+	field = hid_register_field(report, usages, parser->global.report_count, flags);
 	if (!field)
 		return 0;
 
@@ -625,7 +712,11 @@ static int hid_parser_main(struct hid_parser *parser, struct hid_item *item)
 		ret = 0;
 	}
 
-	memset(&parser->local, 0, sizeof(parser->local));	/* Reset the local parser environment */
+	/* Reset the local parser environment, the usage tables stay allocated */
+	parser->local.usage_index = 0;
+	parser->local.usage_minimum = 0;
+	parser->local.delimiter_depth = 0;
+	parser->local.delimiter_branch = 0;
 
 	return ret;
 }
@@ -641,40 +732,19 @@ static int hid_parser_reserved(struct hid_parser *parser, struct hid_item *item)
 }
 
 
-/*
- * Free a report and all registered fields. The field->usage and
- * field->value table's are allocated behind the field, so we need
- * only to free(field) itself.
- */
-
-static void hid_free_report(struct hid_report *report)
-{
-	unsigned n;
-
-	for (n = 0; n < report->maxfield; n++)
-		free(report->field[n]);
-	free(report);
-}
-
-
 /*
  * Close report. This function returns the device
  * state to the point prior to hid_open_report().
  */
 void hid_close_report(struct hid_device *device)
 {
-  unsigned i, j;
+  unsigned i;
 
+  /* reports, fields, collections and the descriptor copy all live in the arena */
   for (i = 0; i < HID_REPORT_TYPES; i++)
   {
     struct hid_report_enum *report_enum = device->report_enum + i;
 
-    for (j = 0; j < HID_MAX_IDS; j++)
-    {
-      struct hid_report *report = report_enum->report_id_hash[j];
-      if (report)
-        hid_free_report(report);
-    }
     memset(report_enum, 0, sizeof(*report_enum));
     INIT_LIST_HEAD(&report_enum->report_list);
   }
@@ -690,22 +760,19 @@ void hid_close_report(struct hid_device *device)
 //  device->rdesc = NULL;
 //  device->rsize = 0;
 
-  if (device->dev_rdesc) {
-    free(device->dev_rdesc);
-    device->dev_rdesc = NULL;
-  }
+  device->dev_rdesc = NULL;
   device->dev_rsize = 0;
 
   // kfree(device->collection);
-  if (device->collection)
-    free(device->collection);
-
   device->collection = NULL;
   device->collection_size = 0;
   device->maxcollection = 0;
   device->maxapplication = 0;
 
   device->status &= ~HID_STAT_PARSED;
+
+  device->arena.used = 0;
+  device->arena.top = device->arena.size;
 }
 
 #if 0
@@ -1001,19 +1068,269 @@ EXPORT_SYMBOL_GPL(hid_validate_values);
 
 #endif
 
+/*
+ * Walk the descriptor items the way hid_open_report() will. Fills @scan
+ * and, when @fields is given, the number of fields of every report,
+ * indexed by type and report id. Returns the bytes the parsed reports
+ * and fields take in the arena.
+ */
+static size_t hid_scan_descriptor(uint8_t *rdesc, unsigned rsize,
+    struct hid_desc_scan *scan, uint16_t **fields, unsigned *nr_reports, int *absolute)
+{
+  uint32_t seen[HID_REPORT_TYPES][HID_MAX_IDS / 32];
+  unsigned page_stack[HID_GLOBAL_STACK_SIZE];
+  unsigned count_stack[HID_GLOBAL_STACK_SIZE];
+  unsigned size_stack[HID_GLOBAL_STACK_SIZE];
+  unsigned id_stack[HID_GLOBAL_STACK_SIZE];
+  unsigned sp = 0;
+  unsigned usage_page = 0, report_count = 0, report_size = 0, report_id = 0;
+  unsigned usages = 0, usage_min = 0;
+  unsigned type, values, n;
+  uint32_t data;
+  size_t need = 0;
+  struct hid_item item;
+  uint8_t *start = rdesc;
+  uint8_t *end = rdesc + rsize;
+
+  memset(seen, 0, sizeof(seen));
+  memset(scan, 0, sizeof(*scan));
+  *nr_reports = 0;
+  *absolute = 0;
+
+  while ((start = fetch_item(start, end, &item)) != NULL)
+  {
+    /* long items make hid_open_report() bail out, nothing to size */
+    if (item.format != HID_ITEM_FORMAT_SHORT)
+      continue;
+
+    data = item_udata(&item);
+
+    switch (item.type)
+    {
+      case HID_ITEM_TYPE_GLOBAL:
+        switch (item.tag)
+        {
+          case HID_GLOBAL_ITEM_TAG_USAGE_PAGE:
+            usage_page = data;
+            break;
+          case HID_GLOBAL_ITEM_TAG_REPORT_COUNT:
+            report_count = data;
+            break;
+          case HID_GLOBAL_ITEM_TAG_REPORT_SIZE:
+            report_size = data;
+            break;
+          case HID_GLOBAL_ITEM_TAG_REPORT_ID:
+            report_id = data;
+            break;
+          case HID_GLOBAL_ITEM_TAG_PUSH:
+            if (sp < HID_GLOBAL_STACK_SIZE)
+            {
+              page_stack[sp] = usage_page;
+              count_stack[sp] = report_count;
+              size_stack[sp] = report_size;
+              id_stack[sp] = report_id;
+              sp++;
+            }
+            break;
+          case HID_GLOBAL_ITEM_TAG_POP:
+            if (sp)
+            {
+              sp--;
+              usage_page = page_stack[sp];
+              report_count = count_stack[sp];
+              report_size = size_stack[sp];
+              report_id = id_stack[sp];
+            }
+            break;
+        }
+        break;
+
+      case HID_ITEM_TYPE_LOCAL:
+        /* same usage page composition as hid_parser_local() */
+        if (item.size <= 2)
+          data = (usage_page << 16) + data;
+
+        switch (item.tag)
+        {
+          case HID_LOCAL_ITEM_TAG_USAGE:
+            usages++;
+            break;
+          case HID_LOCAL_ITEM_TAG_USAGE_MINIMUM:
+            usage_min = data;
+            break;
+          case HID_LOCAL_ITEM_TAG_USAGE_MAXIMUM:
+            if (data >= usage_min)
+              usages += (data - usage_min >= HID_MAX_USAGES) ?
+                  HID_MAX_USAGES : data - usage_min + 1;
+            break;
+        }
+        if (usages > HID_MAX_USAGES)
+          usages = HID_MAX_USAGES;
+        if (usages > scan->max_usages)
+          scan->max_usages = usages;
+        break;
+
+      case HID_ITEM_TYPE_MAIN:
+        switch (item.tag)
+        {
+          case HID_MAIN_ITEM_TAG_BEGIN_COLLECTION:
+            scan->collections++;
+            break;
+          case HID_MAIN_ITEM_TAG_INPUT:
+          case HID_MAIN_ITEM_TAG_OUTPUT:
+          case HID_MAIN_ITEM_TAG_FEATURE:
+            if (report_id >= HID_MAX_IDS)
+              break;
+
+            type = (item.tag == HID_MAIN_ITEM_TAG_INPUT) ? HID_INPUT_REPORT :
+                   (item.tag == HID_MAIN_ITEM_TAG_OUTPUT) ? HID_OUTPUT_REPORT :
+                   HID_FEATURE_REPORT;
+
+            if (!(seen[type][report_id / 32] & (1UL << (report_id % 32))))
+            {
+              seen[type][report_id / 32] |= 1UL << (report_id % 32);
+              need += HID_ARENA_ROUND(sizeof(struct hid_report));
+              (*nr_reports)++;
+            }
+            if (report_id >= scan->id_slots[type])
+              scan->id_slots[type] = report_id + 1;
+
+            /* no usages is padding, hid_add_field() makes no field of it */
+            if (usages)
+            {
+              if (fields)
+                fields[type][report_id]++;
+
+              n = max_t(unsigned, usages, report_count);
+              values = (type == HID_INPUT_REPORT) ? 2 * report_count : report_count;
+              if (type == HID_INPUT_REPORT && !(data & HID_MAIN_ITEM_VARIABLE))
+                values += 2 * HID_USAGE_WORDS(n);
+              need += HID_ARENA_ROUND(sizeof(struct hid_field) +
+                  n * sizeof(struct hid_usage) + values * sizeof(int32_t));
+              need += sizeof(struct hid_field *);
+
+              /* hid_compile_reports() ops, one per value at most */
+              if (type == HID_INPUT_REPORT)
+                need += HID_ARENA_ROUND((report_count ? report_count : 1) *
+                    sizeof(struct hid_decode_op));
+            }
+
+            /* multi-bit absolute data is what hidinput maps onto EV_ABS */
+            if (type == HID_INPUT_REPORT && report_size > 1 &&
+                (data & (HID_MAIN_ITEM_CONSTANT | HID_MAIN_ITEM_VARIABLE |
+                    HID_MAIN_ITEM_RELATIVE)) == HID_MAIN_ITEM_VARIABLE)
+              *absolute = 1;
+            break;
+        }
+        /* every main item resets the local state */
+        usages = 0;
+        usage_min = 0;
+        break;
+    }
+  }
+
+  return need;
+}
+
+/*
+ * Scratch hid_open_report() takes from the top of the arena: the parser,
+ * its usage tables and the per report field counts.
+ */
+static size_t hid_parser_scratch(const struct hid_desc_scan *scan)
+{
+  size_t size;
+  unsigned i;
+
+  size = HID_ARENA_ROUND(sizeof(struct hid_parser));
+  size += 2 * HID_ARENA_ROUND(scan->max_usages * sizeof(unsigned));
+  for (i = 0; i < HID_REPORT_TYPES; i++)
+    size += HID_ARENA_ROUND(scan->id_slots[i] * sizeof(uint16_t));
+
+  return size;
+}
+
 /**
- * hid_set_report_descriptor
+ * hid_arena_estimate - upper bound of the arena a descriptor needs
  *
+ * @rdesc: report descriptor
+ * @rsize: descriptor length
+ * @scan: returns what the descriptor declares
  *
+ * Adds up the reports (one per distinct type/id) with their field arrays,
+ * the fields with their usage and value tables, the input decode programs,
+ * the report id maps, the collection array and the descriptor copy, plus
+ * the larger of the parser scratch and the single hid_input
+ * hidinput_connect() creates.
+ */
+size_t hid_arena_estimate(uint8_t *rdesc, unsigned rsize, struct hid_desc_scan *scan)
+{
+  size_t need, inputs;
+  unsigned nr_reports, i;
+  int absolute;
+
+  need = hid_scan_descriptor(rdesc, rsize, scan, NULL, &nr_reports, &absolute);
+
+  /* field arrays are counted per field above, this covers their rounding */
+  need += nr_reports * (HID_ARENA_ALIGN - 1);
+  for (i = 0; i < HID_REPORT_TYPES; i++)
+    need += HID_ARENA_ROUND(scan->id_slots[i] * sizeof(struct hid_report *));
+
+  need += HID_ARENA_ROUND(rsize);
+  need += HID_ARENA_ROUND((scan->collections ? scan->collections : 1) *
+      sizeof(struct hid_collection));
+
+  /* the parser is gone by the time hidinput_connect() allocates */
+  inputs = HID_ARENA_ROUND(sizeof(struct hid_input)) +
+      HID_ARENA_ROUND(sizeof(struct input_dev));
+  if (absolute)
+    inputs += HID_ARENA_ROUND(ABS_CNT * sizeof(struct input_absinfo));
+
+  need += max_t(size_t, inputs, hid_parser_scratch(scan));
+
+  /* keep the top of the arena aligned for hid_arena_alloc_temp() */
+  return HID_ARENA_ROUND(need);
+}
+
+/**
+ * hid_set_report_descriptor
+ *
+ * Sizes the arena for this descriptor and copies the descriptor into it.
+ * A device from hid_allocate_device() gets an arena of exactly that size
+ * from the heap, one from hid_allocate_device_in() must already have room.
  */
 int hid_set_report_descriptor(struct hid_device *hiddev, uint8_t* rdesc, uint16_t rsize)
 {
+  struct hid_arena *arena;
+  size_t need;
+
   if (hiddev == NULL || rdesc == NULL || rsize == 0 || rsize > 1024) {
     // TODO log error
     return -1;
   }
 
-  hiddev->dev_rdesc = (uint8_t *)malloc(rsize);
+  arena = &hiddev->arena;
+  need = hid_arena_estimate(rdesc, rsize, &hiddev->scan);
+
+  if (arena->base == NULL)
+  {
+    arena->base = malloc(need);
+    if (arena->base == NULL)
+    {
+      USBH_ErrLog("HID: no memory for a %u byte arena", (unsigned)need);
+      return -1;
+    }
+    arena->size = need;
+    arena->owned = 1;
+  }
+  else if (need > arena->size - arena->used)
+  {
+    USBH_ErrLog("HID: descriptor needs %u arena bytes, %u available",
+        (unsigned)need, (unsigned)(arena->size - arena->used));
+    return -1;
+  }
+  arena->top = arena->size;
+
+  hiddev->dev_rdesc = hid_arena_alloc(hiddev, rsize);
   if (!hiddev->dev_rdesc)
   {
     // TODO log err
@@ -1045,11 +1362,14 @@ int hid_set_report_descriptor(struct hid_device *hiddev, uint8_t* rdesc, uint16_
 int hid_open_report(struct hid_device *device)
 {
 	struct hid_parser *parser = 0;
+	struct hid_desc_scan scan;
 	struct hid_item item;
 	unsigned int size;
+	unsigned int i, nr_reports;
 	uint8_t *start;
 //	uint8_t *buf;
 	uint8_t *end;
+	int absolute;
 	int ret;
 	static int (*dispatch_type[])(struct hid_parser *parser,
 				      struct hid_item *item) = {
@@ -1090,25 +1410,55 @@ int hid_open_report(struct hid_device *device)
 
 //	parser = vzalloc(sizeof(struct hid_parser));
 
-    parser = malloc(sizeof(struct hid_parser));
+	/* the parser is scratch, it goes on top of the arena and is dropped after */
+	parser = hid_arena_alloc_temp(device, sizeof(struct hid_parser));
 	if (!parser) {
 		ret = -ENOMEM;
 		goto err;
 	}
 
-	memset(parser, 0, sizeof(struct hid_parser));
 	parser->device = device;
 
+	/* usage tables only as deep as the descriptor needs them */
+	parser->local.usage_size = device->scan.max_usages;
+	parser->local.usage = hid_arena_alloc_temp(device,
+	    parser->local.usage_size * sizeof(unsigned));
+	parser->local.collection_index = hid_arena_alloc_temp(device,
+	    parser->local.usage_size * sizeof(unsigned));
+	if (!parser->local.usage || !parser->local.collection_index) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
+	/* report id maps sized to the ids declared, field counts for the parse */
+	for (i = 0; i < HID_REPORT_TYPES; i++) {
+		struct hid_report_enum *report_enum = device->report_enum + i;
+
+		report_enum->id_slots = device->scan.id_slots[i];
+		report_enum->report_id_map = hid_arena_alloc(device,
+		    report_enum->id_slots * sizeof(struct hid_report *));
+		parser->field_counts[i] = hid_arena_alloc_temp(device,
+		    report_enum->id_slots * sizeof(uint16_t));
+		if (!report_enum->report_id_map || !parser->field_counts[i]) {
+			ret = -ENOMEM;
+			goto err;
+		}
+	}
+	hid_scan_descriptor(start, size, &scan, parser->field_counts, &nr_reports, &absolute);
+
 	end = start + size;
 
 //	device->collection = kcalloc(HID_DEFAULT_NUM_COLLECTIONS,
 //				     sizeof(struct hid_collection), GFP_KERNEL);
-	device->collection = malloc(HID_DEFAULT_NUM_COLLECTIONS * sizeof(struct hid_collection));
+	/* hid_arena_estimate() already counted them, size the array once */
+	device->collection_size = device->scan.collections ?
+	    device->scan.collections : 1;
+	device->collection = hid_arena_alloc(device,
+	    device->collection_size * sizeof(struct hid_collection));
 	if (!device->collection) {
 		ret = -ENOMEM;
 		goto err;
 	}
-	device->collection_size = HID_DEFAULT_NUM_COLLECTIONS;
 
 	ret = -EINVAL;
 	while ((start = fetch_item(start, end, &item)) != NULL) {
@@ -1135,7 +1485,7 @@ int hid_open_report(struct hid_device *device)
 				goto err;
 			}
 			// vfree(parser);
-			free(parser);
+			hid_arena_release_temp(device);
 			device->status |= HID_STAT_PARSED;
 			return 0;
 		}
@@ -1144,7 +1494,7 @@ int hid_open_report(struct hid_device *device)
 	hid_err(device, "item fetching failed at offset %d\n", (int)(end - start));
 err:
 	// vfree(parser);
-    free(parser);
+	hid_arena_release_temp(device);
 	hid_close_report(device);
 	return ret;
 }
@@ -1201,13 +1551,13 @@ int32_t hid_snto32(uint32_t value, unsigned n)
 //	return value & ((1 << n) - 1);
 //}
 
-//static uint32_t s32ton(int32_t value, unsigned n)
-//{
-//    int32_t a = value >> (n - 1);
-//    if (a && a != -1)
-//        return value < 0 ? 1 << (n - 1) : (1 << (n - 1)) - 1;
-//    return value & ((1 << n) - 1);
-//}
+static uint32_t s32ton(int32_t value, unsigned n)
+{
+    int32_t a = value >> (n - 1);
+    if (a && a != -1)
+        return value < 0 ? 1U << (n - 1) : (1U << (n - 1)) - 1;
+    return n < 32 ? value & ((1U << n) - 1) : (uint32_t)value;
+}
 
 /*
  * Extract/implement a data field from/to a little endian report (bit array).
@@ -1254,8 +1604,6 @@ static uint32_t extract(const struct hid_device *hid, uint8_t *report,
     return (uint32_t) x;
 }
 
-#if 0
-
 /*
  * "implement" : set bits in a little endian bit stream.
  * Same concepts as "extract" (see comments above).
@@ -1263,36 +1611,36 @@ static uint32_t extract(const struct hid_device *hid, uint8_t *report,
  * order the whole time. It make more sense to talk about
  * endianness of register values by considering a register
  * a "cached" copy of the little endiad bit stream.
+ *
+ * Only the bytes the field covers are touched, the report buffer
+ * needs no slack behind it.
  */
-static void implement(const struct hid_device *hid, __u8 *report,
-		      unsigned offset, unsigned n, __u32 value)
+static void implement(const struct hid_device *hid, uint8_t *report,
+		      unsigned offset, unsigned n, uint32_t value)
 {
-	u64 x;
-	u64 m = (1ULL << n) - 1;
+	uint32_t m = n < 32 ? (1U << n) - 1 : 0xffffffffU;
+	unsigned bits;
 
-	if (n > 32)
-		hid_warn(hid, "%s() called with n (%d) > 32! (%s)\n",
-			 __func__, n, current->comm);
-
-	if (value > m)
-		hid_warn(hid, "%s() called with too large value %d! (%s)\n",
-			 __func__, value, current->comm);
-	WARN_ON(value > m);
 	value &= m;
 
 	report += offset >> 3;
 	offset &= 7;
 
-	x = get_unaligned_le64(report);
-	x &= ~(m << offset);
-	x |= ((u64)value) << offset;
-	put_unaligned_le64(x, report);
+	while (n) {
+		bits = min_t(unsigned, n, 8 - offset);
+		m = ((1U << bits) - 1) << offset;
+		*report = (*report & ~m) | ((value << offset) & m);
+		value >>= bits;
+		n -= bits;
+		offset = 0;
+		report++;
+	}
 }
 
-#endif
-
 /*
  * Search an array for a value.
+ *
+ * Not used, hid_input_field() diffs array fields as usage bitmaps.
  */
 //static int search(__s32 *array, __s32 value, unsigned n)
 //{
@@ -1303,15 +1651,6 @@ static void implement(const struct hid_device *hid, __u8 *report,
 //  }
 //  return -1;
 //}
-static int search(int32_t *array, int32_t value, unsigned n)
-{
-  while (n--)
-  {
-    if (*array++ == value)
-      return 0;
-  }
-  return -1;
-}
 
 #if 0
 
@@ -1475,6 +1814,53 @@ exit:
 
 #endif
 
+/*
+ * Report the usages that appeared or disappeared in an array field.
+ *
+ * Linux searches the old values for every new one and vice versa, which
+ * is O(n^2) in report_count. Here both states are bitmaps over the usage
+ * index, the XOR of the two is the set of changes and a press or release
+ * is sent for each set bit, O(report_count + usages / 32).
+ */
+static void hid_input_array(struct hid_device *hid, struct hid_field *field,
+    int32_t *value)
+{
+  unsigned words = HID_USAGE_WORDS(field->maxusage);
+  uint32_t *present = field->present;
+  uint32_t *next = present + words;
+  uint32_t changed;
+  unsigned n, idx, bit;
+
+  memset(next, 0, words * sizeof(uint32_t));
+
+  for (n = 0; n < field->report_count; n++)
+  {
+    if (value[n] < field->logical_minimum || value[n] > field->logical_maximum)
+      continue;
+
+    idx = value[n] - field->logical_minimum;
+    if (idx < field->maxusage && field->usage[idx].hid)
+      next[idx / 32] |= 1UL << (idx % 32);
+  }
+
+  for (n = 0; n < words; n++)
+  {
+    changed = present[n] ^ next[n];
+
+    while (changed)
+    {
+      bit = __builtin_ctz(changed);
+      changed &= changed - 1;
+
+      // hid_process_event(hid, field, &field->usage[n * 32 + bit], ..., interrupt);
+      hidinput_hid_event(hid, field, &field->usage[n * 32 + bit],
+          (next[n] >> bit) & 1);
+    }
+
+    present[n] = next[n];
+  }
+}
+
 /*
  * Analyse a received field, and fetch the data from it. The field
  * content is stored for next report processing (we do differential
@@ -1493,10 +1879,8 @@ static void hid_input_field(struct hid_device *hid, struct hid_field *field, uin
 //  USBH_UsrLog(
 //      "    hid_input_field, count: %d, size: %d, offset: %d, lmin: %d, lmax: %d",
 //      count, size, offset, (int )min, (int )max);
-//	value = kmalloc(sizeof(__s32) * count, GFP_ATOMIC);
-//	if (!value)
-//		return;
-  value = malloc(sizeof(int32_t) * count);
+  /* preallocated by hid_register_field(), see there */
+  value = field->new_value;
   if (!value)
     return;
 
@@ -1511,55 +1895,254 @@ static void hid_input_field(struct hid_device *hid, struct hid_field *field, uin
 
     /* Ignore report if ErrorRollOver */
     if (!(field->flags & HID_MAIN_ITEM_VARIABLE) && value[n] >= min
-        && value[n] <= max
+        && value[n] <= max && (unsigned)(value[n] - min) < field->maxusage
         && field->usage[value[n] - min].hid == HID_UP_KEYBOARD + 1)
       goto exit;
   }
 
-  for (n = 0; n < count; n++)
+  if (HID_MAIN_ITEM_VARIABLE & field->flags)
   {
-    if (HID_MAIN_ITEM_VARIABLE & field->flags)
+    for (n = 0; n < count; n++)
     {
       // hid_process_event(hid, field, &field->usage[n], value[n], interrupt);
       hidinput_hid_event(hid, field, &field->usage[n], value[n]);
+    }
+  }
+  else if (field->present)
+  {
+    hid_input_array(hid, field, value);
+  }
+
+  memcpy(field->value, value, count * sizeof(int32_t));
+exit:
+  return;
+}
+
+/*
+ * Compiled decoding. hid_compile_reports() flattens every input report into
+ * one op per value, with the bit position, mask, sign and input target
+ * resolved up front, so hid_run_program() is a single loop over the report.
+ */
+
+static void hid_compile_field_op(struct hid_decode_op *op, struct hid_field *field,
+    unsigned n)
+{
+  unsigned offset = field->report_offset + n * field->report_size;
+
+  op->field = field;
+  op->byte = offset >> 3;
+  op->shift = offset & 7;
+  op->size = field->report_size;
+  op->mask = (op->size < 32) ? (1UL << op->size) - 1 : 0xffffffffUL;
+}
+
+static int hid_compile_report(struct hid_device *hid, struct hid_report *report)
+{
+  struct hid_decode_op *op;
+  struct hid_field *field;
+  struct hid_usage *usage;
+  unsigned i, n, len = 0;
+
+  for (i = 0; i < report->maxfield; i++)
+  {
+    field = report->field[i];
+    if ((field->flags & HID_MAIN_ITEM_VARIABLE) &&
+        field->report_size && field->report_size <= 32)
+      len += field->report_count;
+    else
+      len++;
+  }
+
+  op = hid_arena_alloc(hid, len * sizeof(*op));
+  if (!op)
+    return -ENOMEM;
+
+  report->prog = op;
+  report->prog_len = len;
+
+  for (i = 0; i < report->maxfield; i++)
+  {
+    field = report->field[i];
+
+    if (!(field->flags & HID_MAIN_ITEM_VARIABLE) ||
+        !field->report_size || field->report_size > 32)
+    {
+      /* arrays need the old/new diff, keep them on the generic path */
+      op->kind = HID_OP_FIELD;
+      op->field = field;
+      op++;
       continue;
     }
 
-    /* field->value is previously stored states */
-    if (field->value[n] >= min && field->value[n] <= max
-        && field->usage[field->value[n] - min].hid
-        && search(value, field->value[n], count))
+    for (n = 0; n < field->report_count; n++, op++)
+    {
+      usage = &field->usage[n];
+
+      hid_compile_field_op(op, field, n);
+      op->slot = &field->value[n];
+      op->usage = usage;
+      op->kind = hidinput_usage_kind(field, usage);
+      op->type = usage->type;
+      op->code = usage->code;
+
+      if (field->logical_minimum < 0)
+        op->flags |= HID_OP_SIGNED;
+      if (field->logical_minimum < field->logical_maximum)
+        op->flags |= HID_OP_RANGE;
+      if ((field->flags & HID_MAIN_ITEM_RELATIVE) && usage->type == EV_KEY)
+        op->flags |= HID_OP_RELEASE;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * The boot keyboard layout gets its own decoder: modifiers are a byte
+ * compare instead of eight extractions, the keycode array stays generic.
+ */
+static int hid_is_boot_keyboard(struct hid_report *report)
+{
+  struct hid_field *mods, *keys;
+  unsigned n;
+
+  if (report->maxfield != 2 || report->size != 64)
+    return 0;
+
+  mods = report->field[0];
+  keys = report->field[1];
+
+  if (!(mods->flags & HID_MAIN_ITEM_VARIABLE) || mods->report_offset != 0 ||
+      mods->report_size != 1 || mods->report_count != 8 || !mods->hidinput)
+    return 0;
+
+  if ((keys->flags & HID_MAIN_ITEM_VARIABLE) || keys->report_offset != 16 ||
+      keys->report_size != 8 || keys->report_count != 6)
+    return 0;
+
+  for (n = 0; n < 8; n++)
+    if (mods->usage[n].hid != (HID_UP_KEYBOARD | (0xe0 + n)) ||
+        mods->usage[n].type != EV_KEY || !mods->usage[n].code)
+      return 0;
+
+  return 1;
+}
+
+/**
+ * hid_compile_reports - build the decode program of every input report
+ *
+ * @hid: parsed and connected hid device
+ *
+ * Must run after hidinput_connect(), the ops capture the usage mapping.
+ * On failure the reports fall back to the field walk.
+ */
+int hid_compile_reports(struct hid_device *hid)
+{
+  struct hid_report *report;
+  int ret;
+
+  list_for_each_entry(report, &hid->report_enum[HID_INPUT_REPORT].report_list, list)
+  {
+    if (hid_is_boot_keyboard(report))
     {
+      report->layout = HID_LAYOUT_BOOT_KBD;
+      continue;
+    }
+
+    ret = hid_compile_report(hid, report);
+    if (ret)
+      return ret;
+  }
+
+  return 0;
+}
+
+static inline uint32_t hid_op_extract(const uint8_t *data, const struct hid_decode_op *op)
+{
+  const uint8_t *p = data + op->byte;
+  unsigned end = op->shift + op->size;
+  uint32_t x = p[0];
+
+  /* only touch the bytes the value spans */
+  if (end > 8)
+    x |= (uint32_t)p[1] << 8;
+  if (end > 16)
+    x |= (uint32_t)p[2] << 16;
+  if (end > 24)
+    x |= (uint32_t)p[3] << 24;
+  x >>= op->shift;
+  if (end > 32)
+    x |= (uint32_t)p[4] << (32 - op->shift);
+
+  return x & op->mask;
+}
 
-      // USBH_UsrLog("    old field->value[%d] (%d) not found in new value", n, (int)field->value[n]);
-      // hid_process_event(hid, field, &field->usage[field->value[n] - min], 0, interrupt);
-      hidinput_hid_event(hid, field, &field->usage[field->value[n] - min], 0);
+static void hid_run_program(struct hid_device *hid, struct hid_report *report, uint8_t *data)
+{
+  const struct hid_decode_op *op = report->prog;
+  const struct hid_decode_op *end = op + report->prog_len;
+  struct hid_field *field;
+  int32_t value;
+
+  for (; op < end; op++)
+  {
+    field = op->field;
+
+    if (op->kind == HID_OP_FIELD)
+    {
+      hid_input_field(hid, field, data);
+      continue;
     }
 
-    if (value[n] >= min && value[n] <= max && field->usage[value[n] - min].hid
-        && search(field->value, value[n], count))
+    value = hid_op_extract(data, op);
+    if (op->flags & HID_OP_SIGNED)
+      value = snto32(value, op->size);
+    *op->slot = value;
+
+    if (op->kind == HID_OP_EMIT)
     {
+      if ((op->flags & HID_OP_RANGE) &&
+          (value < field->logical_minimum || value > field->logical_maximum))
+        continue;
 
-      // USBH_UsrLog("    new value[%d] (%d) not found in old field->value", n, (int)value[n]);
-      // hid_process_event(hid, field, &field->usage[value[n] - min], 1, interrupt);
-      hidinput_hid_event(hid, field, &field->usage[value[n] - min], 1);
+      input_event(field->hidinput->input, op->type, op->code, value);
+      if (op->flags & HID_OP_RELEASE)
+        input_event(field->hidinput->input, op->type, op->code, 0);
+    }
+    else if (op->kind == HID_OP_EVENT)
+    {
+      hidinput_hid_event(hid, field, op->usage, value);
     }
   }
-
-  memcpy(field->value, value, count * sizeof(int32_t));
-exit:
-  // kfree(value);
-  free(value);
 }
 
-#if 0
+static void hid_run_boot_keyboard(struct hid_device *hid, struct hid_report *report, uint8_t *data)
+{
+  struct hid_field *mods = report->field[0];
+  struct input_dev *input = mods->hidinput->input;
+  unsigned n;
+  int32_t bit;
+
+  /* the input layer drops repeats anyway, only send modifiers that moved */
+  for (n = 0; n < 8; n++)
+  {
+    bit = (data[0] >> n) & 1;
+    if (bit != mods->value[n])
+    {
+      mods->value[n] = bit;
+      input_event(input, EV_KEY, mods->usage[n].code, bit);
+    }
+  }
+
+  hid_input_field(hid, report->field[1], data);
+}
 
 /*
  * Output the field into the report.
  */
 
 static void hid_output_field(const struct hid_device *hid,
-			     struct hid_field *field, __u8 *data)
+			     struct hid_field *field, uint8_t *data)
 {
 	unsigned count = field->report_count;
 	unsigned offset = field->report_offset;
@@ -1577,11 +2160,10 @@ static void hid_output_field(const struct hid_device *hid,
 }
 
 /*
- * Create a report. 'data' has to be allocated using
- * hid_alloc_report_buf() so that it has proper size.
+ * Create a report. 'data' has to hold hid_report_len(report) bytes.
  */
 
-void hid_output_report(struct hid_report *report, __u8 *data)
+void hid_output_report(struct hid_report *report, uint8_t *data)
 {
 	unsigned n;
 
@@ -1592,23 +2174,15 @@ void hid_output_report(struct hid_report *report, __u8 *data)
 	for (n = 0; n < report->maxfield; n++)
 		hid_output_field(report->device, report->field[n], data);
 }
-EXPORT_SYMBOL_GPL(hid_output_report);
+// EXPORT_SYMBOL_GPL(hid_output_report);
 
 /*
- * Allocator for buffer that is going to be passed to hid_output_report()
+ * Bytes on the wire of a report, report ID included.
  */
-u8 *hid_alloc_report_buf(struct hid_report *report, gfp_t flags)
+unsigned hid_report_len(struct hid_report *report)
 {
-	/*
-	 * 7 extra bytes are necessary to achieve proper functionality
-	 * of implement() working on 8 byte chunks
-	 */
-
-	int len = ((report->size - 1) >> 3) + 1 + (report->id > 0) + 7;
-
-	return kmalloc(len, flags);
+	return ((report->size - 1) >> 3) + 1 + (report->id > 0);
 }
-EXPORT_SYMBOL_GPL(hid_alloc_report_buf);
 
 /*
  * Set a field value. The report this field belongs to has to be
@@ -1616,7 +2190,7 @@ EXPORT_SYMBOL_GPL(hid_alloc_report_buf);
  * device.
  */
 
-int hid_set_field(struct hid_field *field, unsigned offset, __s32 value)
+int hid_set_field(struct hid_field *field, unsigned offset, int32_t value)
 {
 	unsigned size;
 
@@ -1625,8 +2199,6 @@ int hid_set_field(struct hid_field *field, unsigned offset, __s32 value)
 
 	size = field->report_size;
 
-	hid_dump_input(field->report->device, field->usage + offset, value);
-
 	if (offset >= field->report_count) {
 		hid_err(field->report->device, "offset (%d) exceeds report_count (%d)\n",
 				offset, field->report_count);
@@ -1641,9 +2213,7 @@ int hid_set_field(struct hid_field *field, unsigned offset, __s32 value)
 	field->value[offset] = value;
 	return 0;
 }
-EXPORT_SYMBOL_GPL(hid_set_field);
-
-#endif
+// EXPORT_SYMBOL_GPL(hid_set_field);
 
 //static struct hid_report *hid_get_report(struct hid_report_enum *report_enum,
 //		const u8 *data)
@@ -1657,10 +2227,9 @@ static struct hid_report *hid_get_report(struct hid_report_enum *report_enum,
 	if (report_enum->numbered)
 		n = *data;
 
-	report = report_enum->report_id_hash[n];
+	report = (n < report_enum->id_slots) ? report_enum->report_id_map[n] : NULL;
 	if (report == NULL) {
 		// dbg_hid("undefined report_id %u received\n", n);
-	  USBH_UsrLog("undefined report_id %u received", n);
 	}
 
 	return report;
@@ -1670,6 +2239,14 @@ static struct hid_report *hid_get_report(struct hid_report_enum *report_enum,
  * This function is
  * int hid_report_raw_event(struct hid_device *hid, int type, u8 *data, int size, int interrupt)
  */
+/*
+ * a short report is zero padded here rather than in place, the data comes
+ * straight from an interrupt IN slot. reports arrive one packet at a time,
+ * so a packet sized buffer holds any report that can be delivered short.
+ * extract() loads 8 bytes at a time, the slack keeps the last field in bounds.
+ */
+static uint8_t hid_pad_buf[HID_MIN_BUFFER_SIZE + 7];
+
 int hid_report_raw_event(struct hid_device *hid, int type, uint8_t *data, int size)
 {
   struct hid_report_enum *report_enum = hid->report_enum + type;
@@ -1690,9 +2267,10 @@ int hid_report_raw_event(struct hid_device *hid, int type, uint8_t *data, int si
 
   /** fetch report **/
   report = hid_get_report(report_enum, data);
+  /* an undeclared report ID, the caller counts it */
   if (!report)
   {
-    USBH_UsrLog("failed to get report.")
+    ret = -ENOENT;
     goto out;
   }
 
@@ -1711,7 +2289,16 @@ int hid_report_raw_event(struct hid_device *hid, int type, uint8_t *data, int si
   if (csize < rsize)
   {
     dbg_hid("report %d is too short, (%d < %d)\n", report->id, csize, rsize);
-    memset(cdata + csize, 0, rsize - csize);
+
+    /* longer than a packet, it cannot have come whole: the caller counts it */
+    if (rsize > HID_MIN_BUFFER_SIZE)
+    {
+      ret = -EMSGSIZE;
+      goto out;
+    }
+    memcpy(hid_pad_buf, cdata, csize);
+    memset(hid_pad_buf + csize, 0, rsize - csize + 7);
+    cdata = hid_pad_buf;
   }
 
 //  bypass hiddev report event
@@ -1734,6 +2321,13 @@ int hid_report_raw_event(struct hid_device *hid, int type, uint8_t *data, int si
 //
 
 //	USBH_UsrLog("  report is ready, has %d fields.", (int)report->maxfield);
+#if (USBH_HID_COMPILED_DECODE == 1)
+  if (report->layout == HID_LAYOUT_BOOT_KBD)
+    hid_run_boot_keyboard(hid, report, cdata);
+  else if (report->prog)
+    hid_run_program(hid, report, cdata);
+  else
+#endif
   for (a = 0; a < report->maxfield; a++)
   {
 //  USBH_UsrLog( "  field index: %d", a);
@@ -2489,325 +3083,6 @@ static struct bus_type hid_bus_type = {
 	.uevent		= hid_uevent,
 };
 
-/* a list of devices that shouldn't be handled by HID core at all */
-static const struct hid_device_id hid_ignore_list[] = {
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ACECAD, USB_DEVICE_ID_ACECAD_FLAIR) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ACECAD, USB_DEVICE_ID_ACECAD_302) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ADS_TECH, USB_DEVICE_ID_ADS_TECH_RADIO_SI470X) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_01) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_10) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_20) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_21) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_22) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_23) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_24) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AIRCABLE, USB_DEVICE_ID_AIRCABLE1) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ALCOR, USB_DEVICE_ID_ALCOR_USBRS232) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ASUSTEK, USB_DEVICE_ID_ASUSTEK_LCM)},
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ASUSTEK, USB_DEVICE_ID_ASUSTEK_LCM2)},
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AVERMEDIA, USB_DEVICE_ID_AVER_FM_MR800) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_AXENTIA, USB_DEVICE_ID_AXENTIA_FM_RADIO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_BERKSHIRE, USB_DEVICE_ID_BERKSHIRE_PCWD) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_CIDC, 0x0103) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_CYGNAL, USB_DEVICE_ID_CYGNAL_RADIO_SI470X) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_CYGNAL, USB_DEVICE_ID_CYGNAL_RADIO_SI4713) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_CMEDIA, USB_DEVICE_ID_CM109) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_CYPRESS, USB_DEVICE_ID_CYPRESS_HIDCOM) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_CYPRESS, USB_DEVICE_ID_CYPRESS_ULTRAMOUSE) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_DEALEXTREAME, USB_DEVICE_ID_DEALEXTREAME_RADIO_SI4701) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_DELORME, USB_DEVICE_ID_DELORME_EARTHMATE) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_DELORME, USB_DEVICE_ID_DELORME_EM_LT20) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_DREAM_CHEEKY, 0x0004) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_DREAM_CHEEKY, 0x000a) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ESSENTIAL_REALITY, USB_DEVICE_ID_ESSENTIAL_REALITY_P5) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ETT, USB_DEVICE_ID_TC5UH) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ETT, USB_DEVICE_ID_TC4UM) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GENERAL_TOUCH, 0x0001) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GENERAL_TOUCH, 0x0002) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GENERAL_TOUCH, 0x0004) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_4_PHIDGETSERVO_30) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_1_PHIDGETSERVO_30) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_0_4_IF_KIT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_16_16_IF_KIT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_8_8_8_IF_KIT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_8_7_IF_KIT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_8_8_IF_KIT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_PHIDGET_MOTORCONTROL) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GOTOP, USB_DEVICE_ID_SUPER_Q2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GOTOP, USB_DEVICE_ID_GOGOPEN) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GOTOP, USB_DEVICE_ID_PENPOWER) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GRETAGMACBETH, USB_DEVICE_ID_GRETAGMACBETH_HUEY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GRIFFIN, USB_DEVICE_ID_POWERMATE) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GRIFFIN, USB_DEVICE_ID_SOUNDKNOB) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GRIFFIN, USB_DEVICE_ID_RADIOSHARK) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_90) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_100) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_101) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_103) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_104) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_105) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_106) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_107) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_108) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_200) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_201) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_202) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_203) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_204) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_205) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_206) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_207) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_300) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_301) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_302) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_303) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_304) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_305) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_306) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_307) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_308) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_309) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_400) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_401) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_402) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_403) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_404) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_405) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_500) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_501) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_502) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_503) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_504) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1000) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1001) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1002) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1003) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1004) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1005) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1006) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1007) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_IMATION, USB_DEVICE_ID_DISC_STAKKA) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_JABRA, USB_DEVICE_ID_JABRA_SPEAK_410) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_JABRA, USB_DEVICE_ID_JABRA_SPEAK_510) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_KBGEAR, USB_DEVICE_ID_KBGEAR_JAMSTUDIO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_KWORLD, USB_DEVICE_ID_KWORLD_RADIO_FM700) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_KYE, USB_DEVICE_ID_KYE_GPEN_560) },
-	{ HID_BLUETOOTH_DEVICE(USB_VENDOR_ID_KYE, 0x0058) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_CASSY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_CASSY2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_POCKETCASSY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_POCKETCASSY2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOBILECASSY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOBILECASSY2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYVOLTAGE) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYCURRENT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYTIME) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYTEMPERATURE) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYPH) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_JWM) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_DMMP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_UMIP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_UMIC) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_UMIB) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_XRAY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_XRAY2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_VIDEOCOM) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOTOR) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_COM3LAB) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_TELEPORT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_NETWORKANALYSER) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_POWERCONTROL) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MACHINETEST) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOSTANALYSER) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOSTANALYSER2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_ABSESP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_AUTODATABUS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MCT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_HYBRID) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_HEATCONTROL) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_MADCATZ, USB_DEVICE_ID_MADCATZ_BEATPAD) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_MCC, USB_DEVICE_ID_MCC_PMD1024LS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_MCC, USB_DEVICE_ID_MCC_PMD1208LS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_MICROCHIP, USB_DEVICE_ID_PICKIT1) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_MICROCHIP, USB_DEVICE_ID_PICKIT2) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_NATIONAL_SEMICONDUCTOR, USB_DEVICE_ID_N_S_HARMONY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 20) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 30) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 100) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 108) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 118) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 200) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 300) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 400) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100 + 500) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_PANJIT, 0x0001) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_PANJIT, 0x0002) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_PANJIT, 0x0003) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_PANJIT, 0x0004) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_PHILIPS, USB_DEVICE_ID_PHILIPS_IEEE802154_DONGLE) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_POWERCOM, USB_DEVICE_ID_POWERCOM_UPS) },
-#if defined(CONFIG_MOUSE_SYNAPTICS_USB) || defined(CONFIG_MOUSE_SYNAPTICS_USB_MODULE)
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_TP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_INT_TP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_CPAD) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_STICK) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_WP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_COMP_TP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_WTP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_SYNAPTICS, USB_DEVICE_ID_SYNAPTICS_DPAD) },
-#endif
-	{ HID_USB_DEVICE(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_LABPRO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_GOTEMP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_SKIP) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_CYCLOPS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_LCSPEC) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_WACOM, HID_ANY_ID) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_WISEGROUP, USB_DEVICE_ID_4_PHIDGETSERVO_20) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_WISEGROUP, USB_DEVICE_ID_1_PHIDGETSERVO_20) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_WISEGROUP, USB_DEVICE_ID_8_8_4_IF_KIT) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_YEALINK, USB_DEVICE_ID_YEALINK_P1K_P4K_B2K) },
-	{ }
-};
-
-/**
- * hid_mouse_ignore_list - mouse devices which should not be handled by the hid layer
- *
- * There are composite devices for which we want to ignore only a certain
- * interface. This is a list of devices for which only the mouse interface will
- * be ignored. This allows a dedicated driver to take care of the interface.
- */
-static const struct hid_device_id hid_mouse_ignore_list[] = {
-	/* appletouch driver */
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_FOUNTAIN_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_FOUNTAIN_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER3_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER3_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER3_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_HF_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_HF_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_HF_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING2_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING2_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING2_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING3_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING3_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING3_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4A_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4A_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4A_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5A_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5A_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5A_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6A_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6A_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6A_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7A_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7A_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7A_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING8_ANSI) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING8_ISO) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING8_JIS) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_FOUNTAIN_TP_ONLY) },
-	{ HID_USB_DEVICE(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER1_TP_ONLY) },
-	{ }
-};
-
-bool hid_ignore(struct hid_device *hdev)
-{
-	if (hdev->quirks & HID_QUIRK_NO_IGNORE)
-		return false;
-	if (hdev->quirks & HID_QUIRK_IGNORE)
-		return true;
-
-	switch (hdev->vendor) {
-	case USB_VENDOR_ID_CODEMERCS:
-		/* ignore all Code Mercenaries IOWarrior devices */
-		if (hdev->product >= USB_DEVICE_ID_CODEMERCS_IOW_FIRST &&
-				hdev->product <= USB_DEVICE_ID_CODEMERCS_IOW_LAST)
-			return true;
-		break;
-	case USB_VENDOR_ID_LOGITECH:
-		if (hdev->product >= USB_DEVICE_ID_LOGITECH_HARMONY_FIRST &&
-				hdev->product <= USB_DEVICE_ID_LOGITECH_HARMONY_LAST)
-			return true;
-		/*
-		 * The Keene FM transmitter USB device has the same USB ID as
-		 * the Logitech AudioHub Speaker, but it should ignore the hid.
-		 * Check if the name is that of the Keene device.
-		 * For reference: the name of the AudioHub is
-		 * "HOLTEK  AudioHub Speaker".
-		 */
-		if (hdev->product == USB_DEVICE_ID_LOGITECH_AUDIOHUB &&
-			!strcmp(hdev->name, "HOLTEK  B-LINK USB Audio  "))
-				return true;
-		break;
-	case USB_VENDOR_ID_SOUNDGRAPH:
-		if (hdev->product >= USB_DEVICE_ID_SOUNDGRAPH_IMON_FIRST &&
-		    hdev->product <= USB_DEVICE_ID_SOUNDGRAPH_IMON_LAST)
-			return true;
-		break;
-	case USB_VENDOR_ID_HANWANG:
-		if (hdev->product >= USB_DEVICE_ID_HANWANG_TABLET_FIRST &&
-		    hdev->product <= USB_DEVICE_ID_HANWANG_TABLET_LAST)
-			return true;
-		break;
-	case USB_VENDOR_ID_JESS:
-		if (hdev->product == USB_DEVICE_ID_JESS_YUREX &&
-				hdev->type == HID_TYPE_USBNONE)
-			return true;
-		break;
-	case USB_VENDOR_ID_VELLEMAN:
-		/* These are not HID devices.  They are handled by comedi. */
-		if ((hdev->product >= USB_DEVICE_ID_VELLEMAN_K8055_FIRST &&
-		     hdev->product <= USB_DEVICE_ID_VELLEMAN_K8055_LAST) ||
-		    (hdev->product >= USB_DEVICE_ID_VELLEMAN_K8061_FIRST &&
-		     hdev->product <= USB_DEVICE_ID_VELLEMAN_K8061_LAST))
-			return true;
-		break;
-	case USB_VENDOR_ID_ATMEL_V_USB:
-		/* Masterkit MA901 usb radio based on Atmel tiny85 chip and
-		 * it has the same USB ID as many Atmel V-USB devices. This
-		 * usb radio is handled by radio-ma901.c driver so we want
-		 * ignore the hid. Check the name, bus, product and ignore
-		 * if we have MA901 usb radio.
-		 */
-		if (hdev->product == USB_DEVICE_ID_ATMEL_V_USB &&
-			hdev->bus == BUS_USB &&
-			strncmp(hdev->name, "www.masterkit.ru MA901", 22) == 0)
-			return true;
-		break;
-	}
-
-	if (hdev->type == HID_TYPE_USBMOUSE &&
-			hid_match_id(hdev, hid_mouse_ignore_list))
-		return true;
-
-	return !!hid_match_id(hdev, hid_ignore_list);
-}
-EXPORT_SYMBOL_GPL(hid_ignore);
-
 int hid_add_device(struct hid_device *hdev)
 {
 	static atomic_t id = ATOMIC_INIT(0);
@@ -2858,6 +3133,267 @@ int hid_add_device(struct hid_device *hdev)
 EXPORT_SYMBOL_GPL(hid_add_device);
 #endif
 
+#define HID_QUIRK_ID(v, p, q)           { (v), (p), (p), (q) }
+#define HID_QUIRK_RANGE(v, f, l, q)     { (v), (f), (l), (q) }
+
+/*
+ * Quirks by USB id: the linux hid_ignore_list, hid_mouse_ignore_list and
+ * the product ranges hid_ignore() tested by vendor, in one table sorted
+ * by vendor then first product. Ranges of a vendor must not overlap.
+ */
+static const struct hid_quirk_id {
+  uint16_t vendor;
+  uint16_t first;
+  uint16_t last;
+  uint32_t quirks;
+} hid_quirk_ids[] = {
+  HID_QUIRK_ID(USB_VENDOR_ID_NATIONAL_SEMICONDUCTOR, USB_DEVICE_ID_N_S_HARMONY, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_KYE, USB_DEVICE_ID_KYE_GPEN_560, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ACECAD, USB_DEVICE_ID_ACECAD_FLAIR, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ACECAD, USB_DEVICE_ID_ACECAD_302, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_LOGITECH, USB_DEVICE_ID_LOGITECH_HARMONY_FIRST, USB_DEVICE_ID_LOGITECH_HARMONY_LAST, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_PHILIPS, USB_DEVICE_ID_PHILIPS_IEEE802154_DONGLE, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_CYPRESS, USB_DEVICE_ID_CYPRESS_HIDCOM, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_CYPRESS, USB_DEVICE_ID_CYPRESS_ULTRAMOUSE, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_MICROCHIP, USB_DEVICE_ID_PICKIT1, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_MICROCHIP, USB_DEVICE_ID_PICKIT2, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_WACOM, 0x0000, 0xffff, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ALCOR, USB_DEVICE_ID_ALCOR_USBRS232, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_FOUNTAIN_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_FOUNTAIN_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER3_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER3_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER3_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_HF_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_HF_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER4_HF_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING2_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING2_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING2_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING3_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING3_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING3_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4A_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4A_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING4A_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6A_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6A_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6A_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING6_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5A_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5A_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING5A_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7A_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7A_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7A_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING7_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING8_ANSI, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING8_ISO, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_WELLSPRING8_JIS, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_FOUNTAIN_TP_ONLY, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_APPLE, USB_DEVICE_ID_APPLE_GEYSER1_TP_ONLY, HID_QUIRK_IGNORE_MOUSE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ETT, USB_DEVICE_ID_TC4UM, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ETT, USB_DEVICE_ID_TC5UH, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_4_PHIDGETSERVO_30, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_1_PHIDGETSERVO_30, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_0_4_IF_KIT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_16_16_IF_KIT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_8_8_8_IF_KIT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_8_7_IF_KIT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_0_8_8_IF_KIT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GLAB, USB_DEVICE_ID_PHIDGET_MOTORCONTROL, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ADS_TECH, USB_DEVICE_ID_ADS_TECH_RADIO_SI470X, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_IMATION, USB_DEVICE_ID_DISC_STAKKA, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_MADCATZ, USB_DEVICE_ID_MADCATZ_BEATPAD, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GRIFFIN, USB_DEVICE_ID_POWERMATE, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GRIFFIN, USB_DEVICE_ID_SOUNDKNOB, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GRIFFIN, USB_DEVICE_ID_RADIOSHARK, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_90, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_100, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_101, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_103, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_104, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_105, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_106, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_107, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_108, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_200, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_201, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_202, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_203, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_204, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_205, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_206, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_207, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_300, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_301, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_302, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_303, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_304, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_305, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_306, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_307, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_308, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_309, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_400, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_401, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_402, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_403, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_404, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_405, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_500, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_501, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_502, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_503, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_504, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1000, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1001, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1002, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1003, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1004, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1005, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1006, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GTCO, USB_DEVICE_ID_GTCO_1007, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_CODEMERCS, USB_DEVICE_ID_CODEMERCS_IOW_FIRST, USB_DEVICE_ID_CODEMERCS_IOW_LAST, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AVERMEDIA, USB_DEVICE_ID_AVER_FM_MR800, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_KBGEAR, USB_DEVICE_ID_KBGEAR_JAMSTUDIO, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_01, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_10, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_20, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_21, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_22, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_23, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIPTEK, USB_DEVICE_ID_AIPTEK_24, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GOTOP, USB_DEVICE_ID_SUPER_Q2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GOTOP, USB_DEVICE_ID_GOGOPEN, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GOTOP, USB_DEVICE_ID_PENPOWER, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_LABPRO, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_GOTEMP, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_SKIP, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_CYCLOPS, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_VERNIER, USB_DEVICE_ID_VERNIER_LCSPEC, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_WISEGROUP, USB_DEVICE_ID_1_PHIDGETSERVO_20, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_WISEGROUP, USB_DEVICE_ID_4_PHIDGETSERVO_20, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_WISEGROUP, USB_DEVICE_ID_8_8_4_IF_KIT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GRETAGMACBETH, USB_DEVICE_ID_GRETAGMACBETH_HUEY, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_MCC, USB_DEVICE_ID_MCC_PMD1024LS, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_MCC, USB_DEVICE_ID_MCC_PMD1208LS, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ONTRAK, USB_DEVICE_ID_ONTRAK_ADU100, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ASUSTEK, USB_DEVICE_ID_ASUSTEK_LCM, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ASUSTEK, USB_DEVICE_ID_ASUSTEK_LCM2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_JABRA, USB_DEVICE_ID_JABRA_SPEAK_410, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_JABRA, USB_DEVICE_ID_JABRA_SPEAK_510, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_HANWANG, USB_DEVICE_ID_HANWANG_TABLET_FIRST, USB_DEVICE_ID_HANWANG_TABLET_LAST, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_BERKSHIRE, USB_DEVICE_ID_BERKSHIRE_PCWD, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_ESSENTIAL_REALITY, USB_DEVICE_ID_ESSENTIAL_REALITY_P5, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_CMEDIA, USB_DEVICE_ID_CM109, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_POWERCOM, USB_DEVICE_ID_POWERCOM_UPS, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GENERAL_TOUCH, 0x0001, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GENERAL_TOUCH, 0x0002, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_GENERAL_TOUCH, 0x0004, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_CASSY, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_CASSY2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_POCKETCASSY, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_POCKETCASSY2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOBILECASSY, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOBILECASSY2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYVOLTAGE, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYCURRENT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYTIME, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYTEMPERATURE, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MICROCASSYPH, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_JWM, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_DMMP, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_UMIP, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_UMIC, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_UMIB, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_XRAY, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_XRAY2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_VIDEOCOM, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOTOR, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_COM3LAB, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_TELEPORT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_NETWORKANALYSER, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_POWERCONTROL, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MACHINETEST, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOSTANALYSER, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MOSTANALYSER2, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_ABSESP, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_AUTODATABUS, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_MCT, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_HYBRID, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_LD, USB_DEVICE_ID_LD_HEATCONTROL, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_CYGNAL, USB_DEVICE_ID_CYGNAL_RADIO_SI470X, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_CYGNAL, USB_DEVICE_ID_CYGNAL_RADIO_SI4713, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_DEALEXTREAME, USB_DEVICE_ID_DEALEXTREAME_RADIO_SI4701, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_VELLEMAN, USB_DEVICE_ID_VELLEMAN_K8055_FIRST, USB_DEVICE_ID_VELLEMAN_K8055_LAST, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_VELLEMAN, USB_DEVICE_ID_VELLEMAN_K8061_FIRST, USB_DEVICE_ID_VELLEMAN_K8061_LAST, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_DELORME, USB_DEVICE_ID_DELORME_EARTHMATE, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_DELORME, USB_DEVICE_ID_DELORME_EM_LT20, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AXENTIA, USB_DEVICE_ID_AXENTIA_FM_RADIO, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_PANJIT, 0x0001, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_PANJIT, 0x0002, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_PANJIT, 0x0003, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_PANJIT, 0x0004, HID_QUIRK_IGNORE),
+  HID_QUIRK_RANGE(USB_VENDOR_ID_SOUNDGRAPH, USB_DEVICE_ID_SOUNDGRAPH_IMON_FIRST, USB_DEVICE_ID_SOUNDGRAPH_IMON_LAST, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_CIDC, 0x0103, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_AIRCABLE, USB_DEVICE_ID_AIRCABLE1, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_KWORLD, USB_DEVICE_ID_KWORLD_RADIO_FM700, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_DREAM_CHEEKY, 0x0004, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_DREAM_CHEEKY, 0x000a, HID_QUIRK_IGNORE),
+  HID_QUIRK_ID(USB_VENDOR_ID_YEALINK, USB_DEVICE_ID_YEALINK_P1K_P4K_B2K, HID_QUIRK_IGNORE),
+};
+
+/**
+ * usbhid_lookup_quirk - quirks of a device by its USB id
+ *
+ * Binary search of hid_quirk_ids[], one per device at connect. Returns the
+ * HID_QUIRK_* bits, HID_QUIRK_IGNORE when the HID layer should leave the
+ * device alone, HID_QUIRK_IGNORE_MOUSE when only its mouse interface.
+ */
+uint32_t usbhid_lookup_quirk(const uint16_t idVendor, const uint16_t idProduct)
+{
+  uint32_t key = (uint32_t)idVendor << 16 | idProduct;
+  unsigned lo = 0, hi = ARRAY_SIZE(hid_quirk_ids);
+  unsigned mid;
+
+  /* first entry starting after the id, the one before may cover it */
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (((uint32_t)hid_quirk_ids[mid].vendor << 16 | hid_quirk_ids[mid].first) <= key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo == 0)
+    return 0;
+
+  lo--;
+  if (hid_quirk_ids[lo].vendor != idVendor || hid_quirk_ids[lo].last < idProduct)
+    return 0;
+  return hid_quirk_ids[lo].quirks;
+}
+
 /**
  * hid_allocate_device - allocate new hid device descriptor
  *
@@ -2880,6 +3416,8 @@ struct hid_device *hid_allocate_device(void)
     return NULL;
 
   memset(hdev, 0, sizeof(*hdev));
+  /* hid_destroy_device() walks it even if hidinput_connect() never ran */
+  INIT_LIST_HEAD(&hdev->inputs);
 
   /*
    * The following functions are commented out, but keep in mind there are two steps
@@ -2903,6 +3441,34 @@ struct hid_device *hid_allocate_device(void)
 }
 // EXPORT_SYMBOL_GPL(hid_allocate_device);
 
+/**
+ * hid_allocate_device_in - place a hid device in a caller supplied region
+ *
+ * @region: static buffer, 8 byte aligned
+ * @size: region size
+ *
+ * The hid_device sits at the start of the region and the rest becomes its
+ * arena, so probing a device never touches the heap. hid_destroy_device()
+ * leaves the region to the caller.
+ */
+struct hid_device *hid_allocate_device_in(void *region, size_t size)
+{
+  struct hid_device *hdev = region;
+  size_t head = HID_ARENA_ROUND(sizeof(*hdev));
+
+  if (region == NULL || size <= head)
+    return NULL;
+
+  memset(hdev, 0, sizeof(*hdev));
+  INIT_LIST_HEAD(&hdev->inputs);
+  hdev->in_region = 1;
+  hdev->arena.base = (uint8_t *)region + head;
+  hdev->arena.size = (size - head) & ~(size_t)(HID_ARENA_ALIGN - 1);
+
+  hid_close_report(hdev);
+  return hdev;
+}
+
 /*
  * This code are merged into hid_destroy_device
  *
@@ -2942,7 +3508,7 @@ void hid_destroy_device(struct hid_device *hdev)
   // hid_disconnect(hdev);       // hw_stop, destroy input_devs
 
 //  if (hdev->claimed & HID_CLAIMED_INPUT)
-//    hidinput_disconnect(hdev);
+  hidinput_disconnect(hdev);
 
   hid_close_report(hdev);
 
@@ -2951,10 +3517,300 @@ void hid_destroy_device(struct hid_device *hdev)
    *   hid_device_release
    */
   // close_report will free report descriptor
-  free(hdev);
+  if (hdev->arena.owned)
+    free(hdev->arena.base);
+
+  if (!hdev->in_region)
+    free(hdev);
 }
 // EXPORT_SYMBOL_GPL(hid_destroy_device);
 
+/*
+ * Saved device. Everything hid_open_report(), hidinput_connect() and
+ * hid_compile_reports() build lives in the hid_device and its arena, so
+ * the two copied back to back make the whole parsed and mapped device.
+ * Pointers are stored as offsets into that image, plus one to keep NULL.
+ */
+#define HID_SAVE_MAGIC          0x42444948      /* "HIDB" */
+#define HID_SAVE_VERSION        1               /* bump when parsing or mapping changes */
+
+struct hid_save_header
+{
+  uint32_t magic;
+  uint16_t version;
+  uint16_t layout;        /* checksum of the saved structure sizes */
+  uint32_t device;        /* image bytes of the hid_device */
+  uint32_t arena;         /* image bytes of the arena */
+};
+
+struct hid_reloc
+{
+  uint8_t *dev;
+  uint8_t *arena;
+  size_t used;
+  uint8_t *image;         /* hid_save_device() writes here, NULL when loading */
+  int bad;                /* a pointer outside the device */
+};
+
+static uint16_t hid_save_layout(void)
+{
+  return (uint16_t)(sizeof(struct hid_device) * 1 + sizeof(struct hid_report) * 3 +
+      sizeof(struct hid_field) * 5 + sizeof(struct hid_usage) * 7 +
+      sizeof(struct hid_input) * 11 + sizeof(struct input_dev) * 13 +
+      sizeof(struct hid_decode_op) * 17 + sizeof(void *) * 19);
+}
+
+/* image offset of a location in the device or its arena, plus one */
+static uintptr_t hid_reloc_offset(struct hid_reloc *r, const void *p)
+{
+  const uint8_t *b = p;
+
+  if (b >= r->dev && b < r->dev + sizeof(struct hid_device))
+    return b - r->dev + 1;
+  if (b >= r->arena && b <= r->arena + r->used)
+    return sizeof(struct hid_device) + (b - r->arena) + 1;
+  r->bad = 1;
+  return 0;
+}
+
+/*
+ * Saving: store the offset form of the pointer at @field into the image.
+ * Loading: turn the offset at @field back into a pointer. Either way the
+ * pointer is usable once this returns, so the walk can follow it.
+ */
+static void hid_reloc(struct hid_reloc *r, void *field)
+{
+  uintptr_t value, off;
+
+  /* a count read from a bad image may point the walk outside it */
+  off = hid_reloc_offset(r, field);
+  if (off == 0 || off - 1 + sizeof(value) > sizeof(struct hid_device) + r->used)
+  {
+    r->bad = 1;
+    return;
+  }
+
+  memcpy(&value, field, sizeof(value));
+  if (value == 0)
+    return;
+
+  if (r->image)
+  {
+    value = hid_reloc_offset(r, (void *)value);
+    memcpy(r->image + off - 1, &value, sizeof(value));
+    return;
+  }
+
+  value--;
+  if (value < sizeof(struct hid_device))
+    value += (uintptr_t)r->dev;
+  else if (value - sizeof(struct hid_device) <= r->used)
+    value += (uintptr_t)r->arena - sizeof(struct hid_device);
+  else
+  {
+    r->bad = 1;
+    value = 0;
+  }
+  memcpy(field, &value, sizeof(value));
+}
+
+static void hid_reloc_device(struct hid_device *hdev, struct hid_reloc *r)
+{
+  struct hid_report_enum *report_enum;
+  struct hid_report *report;
+  struct hid_field *field;
+  struct hid_decode_op *op;
+  struct hid_input *hidinput;
+  unsigned t, i;
+
+  hid_reloc(r, &hdev->dev_rdesc);
+  hid_reloc(r, &hdev->collection);
+
+  for (t = 0; t < HID_REPORT_TYPES && !r->bad; t++)
+  {
+    report_enum = &hdev->report_enum[t];
+    hid_reloc(r, &report_enum->report_id_map);
+    for (i = 0; i < report_enum->id_slots && report_enum->report_id_map; i++)
+      hid_reloc(r, &report_enum->report_id_map[i]);
+
+    hid_reloc(r, &report_enum->report_list.next);
+    hid_reloc(r, &report_enum->report_list.prev);
+    if (r->bad)
+      return;
+    list_for_each_entry(report, &report_enum->report_list, list)
+    {
+      hid_reloc(r, &report->list.next);
+      hid_reloc(r, &report->list.prev);
+      hid_reloc(r, &report->device);
+      hid_reloc(r, &report->field);
+      hid_reloc(r, &report->prog);
+      if (r->bad)
+        return;
+
+      for (i = 0; i < report->field_size && report->field; i++)
+      {
+        hid_reloc(r, &report->field[i]);
+        field = report->field[i];
+        if (field == NULL)
+          continue;
+        hid_reloc(r, &field->usage);
+        hid_reloc(r, &field->value);
+        hid_reloc(r, &field->new_value);
+        hid_reloc(r, &field->present);
+        hid_reloc(r, &field->report);
+        hid_reloc(r, &field->hidinput);
+      }
+
+      for (i = 0; i < report->prog_len && report->prog; i++)
+      {
+        op = &report->prog[i];
+        hid_reloc(r, &op->slot);
+        hid_reloc(r, &op->field);
+        hid_reloc(r, &op->usage);
+      }
+    }
+  }
+
+  hid_reloc(r, &hdev->inputs.next);
+  hid_reloc(r, &hdev->inputs.prev);
+  if (r->bad)
+    return;
+  list_for_each_entry(hidinput, &hdev->inputs, list)
+  {
+    hid_reloc(r, &hidinput->list.next);
+    hid_reloc(r, &hidinput->list.prev);
+    hid_reloc(r, &hidinput->report);
+    hid_reloc(r, &hidinput->input);
+    if (r->bad)
+      return;
+    if (hidinput->input == NULL)
+      continue;
+    hid_reloc(r, &hidinput->input->absinfo);
+    hid_reloc(r, &hidinput->input->hiddev);
+  }
+}
+
+/**
+ * hid_save_device - serialize a parsed and connected device
+ *
+ * @hdev: device after hid_open_report(), hidinput_connect() and
+ *	hid_compile_reports(), before its first report
+ * @buf: destination, NULL to get the size
+ * @size: bytes available at @buf
+ *
+ * Returns the image size, 0 if it does not fit or the device cannot be
+ * saved.
+ */
+size_t hid_save_device(struct hid_device *hdev, void *buf, size_t size)
+{
+  struct hid_save_header header;
+  struct hid_reloc r;
+  size_t need;
+
+  need = sizeof(header) + sizeof(*hdev) + hdev->arena.used;
+  if (buf == NULL)
+    return need;
+  if (size < need || hdev->arena.base == NULL)
+    return 0;
+
+  header.magic = HID_SAVE_MAGIC;
+  header.version = HID_SAVE_VERSION;
+  header.layout = hid_save_layout();
+  header.device = sizeof(*hdev);
+  header.arena = hdev->arena.used;
+
+  memcpy(buf, &header, sizeof(header));
+  r.image = (uint8_t *)buf + sizeof(header);
+  memcpy(r.image, hdev, sizeof(*hdev));
+  memcpy(r.image + sizeof(*hdev), hdev->arena.base, hdev->arena.used);
+
+  r.dev = (uint8_t *)hdev;
+  r.arena = hdev->arena.base;
+  r.used = hdev->arena.used;
+  r.bad = 0;
+  hid_reloc_device(hdev, &r);
+
+  return r.bad ? 0 : need;
+}
+
+/**
+ * hid_load_device - rebuild a device saved by hid_save_device()
+ *
+ * @buf: the image
+ * @len: its size
+ * @region: memory for the device as for hid_allocate_device_in(), NULL
+ *	to take it from the heap
+ * @size: bytes at @region
+ *
+ * The device comes back parsed, its usages mapped and its reports
+ * compiled, ready for hid_input_report(). Returns NULL if the image is
+ * not one this build saved.
+ */
+struct hid_device *hid_load_device(const void *buf, size_t len, void *region, size_t size)
+{
+  struct hid_save_header header;
+  struct hid_device *hdev;
+  struct hid_arena arena;
+  struct hid_reloc r;
+  const uint8_t *image = (const uint8_t *)buf + sizeof(header);
+
+  if (len < sizeof(header))
+    return NULL;
+  memcpy(&header, buf, sizeof(header));
+  if (header.magic != HID_SAVE_MAGIC || header.version != HID_SAVE_VERSION ||
+      header.layout != hid_save_layout() || header.device != sizeof(*hdev) ||
+      len != sizeof(header) + header.device + header.arena)
+    return NULL;
+
+  hdev = region ? hid_allocate_device_in(region, size) : hid_allocate_device();
+  if (hdev == NULL)
+    return NULL;
+
+  arena = hdev->arena;
+  if (arena.base == NULL)
+  {
+    arena.base = malloc(header.arena);
+    if (arena.base == NULL)
+      goto fail;
+    arena.size = header.arena;
+    arena.owned = 1;
+  }
+  else if (header.arena > arena.size)
+    goto fail;
+  arena.used = header.arena;
+  arena.top = arena.size;
+  arena.peak = arena.used;
+
+  memcpy(hdev, image, sizeof(*hdev));
+  hdev->arena = arena;
+  hdev->in_region = region != NULL;
+  memcpy(arena.base, image + sizeof(*hdev), header.arena);
+
+  r.dev = (uint8_t *)hdev;
+  r.arena = arena.base;
+  r.used = arena.used;
+  r.image = NULL;
+  r.bad = 0;
+  hid_reloc_device(hdev, &r);
+  if (r.bad)
+  {
+    /* nothing outside the arena was allocated, freeing it is enough */
+    USBH_ErrLog("HID: saved device image is corrupt");
+    goto fail;
+  }
+
+  hidinput_restore(hdev);
+  return hdev;
+
+fail:
+  if (arena.owned)
+    free(arena.base);
+  hdev->arena.owned = 0;
+  if (!hdev->in_region)
+    free(hdev);
+  return NULL;
+}
+
 #if 0
 
 int __hid_register_driver(struct hid_driver *hdrv, struct module *owner,
@@ -119,8 +119,6 @@ unsigned long find_next_zero_bit(const unsigned long *addr, unsigned long size,
 }
 
 
-void input_event (struct input_dev * dev, unsigned int type, unsigned int code, int value);
-
 #define unk	KEY_UNKNOWN
 
 /*
@@ -147,6 +145,17 @@ static const unsigned char hid_keyboard[256] = {
 	150,158,159,128,136,177,178,176,142,152,173,140,unk,unk,unk,unk
 };
 
+/*
+ * Keycode of a Keyboard/Keypad page usage, 0 if hid_keyboard[] has none.
+ * Lets boot protocol reports share the keycode based keymaps.
+ */
+unsigned int hidinput_keyboard_code(unsigned int usage)
+{
+  if (usage >= sizeof(hid_keyboard) || hid_keyboard[usage] == unk)
+    return 0;
+  return hid_keyboard[usage];
+}
+
 /*
  * This string array is used for debug/print.
  */
@@ -177,6 +186,7 @@ static const char* event_type_str[] = {
   "EV_MAX",               // 0x1f
 };
 
+#if (USBH_HID_INPUT_DEBUG == 1)
 /*
  * This string array is used for debug/print.
  */
@@ -441,76 +451,43 @@ static const char* keycode_str[256] = {
   "UNDEFINED",                //                              254
   "UNDEFINED",                //                              255
 };
+#endif
 
+#if (USBH_HID_INPUT_DEBUG == 1)
 /*
- * This is for debugging only
+ * Debug handler: lists the keys still held once a batch has been applied.
  */
-void input_event(struct input_dev * dev, unsigned int type, unsigned int code, int value) {
-
-  static int lctrl = 0;
-  static int lshift = 0;
-  static int lalt = 0;
-  static int lmeta = 0;
-
-  static int rctrl = 0;
-  static int rshift = 0;
-  static int ralt = 0;
-  static int rmeta = 0;
-
-  static int i;
-
-  static int keycode[256] = { 0 };
+static void hidinput_debug_events(struct input_handler *handler,
+    struct input_dev *dev, const struct input_event *vals, unsigned int count)
+{
+  unsigned int i, code;
+  int keypressed = 0;
 
-  if (type == EV_KEY) {
+  for (i = 0; i < BITS_TO_LONGS(256); i++)
+  {
+    unsigned long word = dev->key[i];
 
-    if (code == KEY_LEFTCTRL) {
-      lctrl = value;
-    }
-    else if (code == KEY_LEFTSHIFT) {
-      lshift = value;
-    }
-    else if (code == KEY_LEFTALT) {
-      lalt = value;
-    }
-    else if (code == KEY_LEFTMETA) {
-      lmeta = value;
-    }
-    else if (code == KEY_RIGHTCTRL) {
-      rctrl = value;
-    }
-    else if (code == KEY_RIGHTSHIFT) {
-      rshift = value;
-    }
-    else if (code == KEY_RIGHTALT) {
-      ralt = value;
-    }
-    else if (code == KEY_RIGHTMETA) {
-      rmeta = value;
-    }
-    else {
-//      USBH_UsrLog("        input_event, type: %d/%s, code: %d/%s, value: %d, lcsam: %d %d %d %d, rcsam: %d %d %d %d",
-//          type, event_type_str[type], code, keycode_str[code], value, lctrl, lshift, lalt, lmeta, rctrl, rshift, ralt, rmeta);
+    while (word)
+    {
+      code = i * BITS_PER_LONG + __builtin_ctzl(word);
+      word &= word - 1;
+      keypressed = 1;
+      USBH_UsrLog("    %s", keycode_str[code]);
     }
-    keycode[code] = value;
   }
-  else if (type == EV_SYN) {
-//    USBH_UsrLog("        input_event, type: %d/%s", type, event_type_str[type]);
-//    USBH_UsrLog("        pressed key:");
-
-    int keypressed = 0;
-    for (i = 0; i < 256; i++) {
-      if (keycode[i]) {
-        keypressed = 1;
-        USBH_UsrLog("    %s", keycode_str[i]);
-      }
-    }
 
-    if (!keypressed) {
-      USBH_UsrLog("    no key pressed")
-    }
+  if (!keypressed)
+  {
+    USBH_UsrLog("    no key pressed");
   }
 }
 
+static struct input_handler hidinput_debug_handler = {
+  .name = "hidinput-debug",
+  .events = hidinput_debug_events,
+};
+#endif
+
 /*
  * The following two functions are moved from hid.h to avoid including input.h in hid.h
  */
@@ -583,6 +560,237 @@ static const struct {
 #define map_abs_clear(c)	hid_map_usage_clear(hidinput, usage, &bit, &max, EV_ABS, (c))
 #define map_key_clear(c)	hid_map_usage_clear(hidinput, usage, &bit, &max, EV_KEY, (c))
 
+#define HID_MAP_CLEAR   0x01    /* clear the code bit, as map_*_clear() */
+#define HID_MAP_REP     0x02    /* the device autorepeats, set EV_REP */
+#define HID_MAP_TOUCH   0x04    /* the device reports touch, drop HID_QUIRK_NOTOUCH */
+
+/*
+ * Usages with a fixed input code, sorted by usage for hidinput_find_usage().
+ * Usages depending on the field (keyboard, buttons, axes, hats, digitizer
+ * pressure and tools) are mapped in hidinput_configure_usage().
+ */
+static const struct hidinput_map {
+  uint32_t hid;
+  uint16_t code;
+  uint8_t  type;
+  uint8_t  flags;
+} hidinput_usage_map[] = {
+  { HID_UP_GENDESK | 0x03d,    BTN_START,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x03e,    BTN_SELECT,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x081,    KEY_POWER,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x082,    KEY_SLEEP,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x083,    KEY_WAKEUP,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x084,    KEY_CONTEXT_MENU,   EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x085,    KEY_MENU,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x086,    KEY_PROG1,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x087,    KEY_HELP,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x088,    KEY_EXIT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x089,    KEY_SELECT,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x08a,    KEY_RIGHT,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x08b,    KEY_LEFT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x08c,    KEY_UP,             EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x08d,    KEY_DOWN,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x08e,    KEY_POWER2,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_GENDESK | 0x08f,    KEY_RESTART,        EV_KEY, HID_MAP_CLEAR },
+
+  { HID_UP_SIMULATION | 0x0ba, ABS_RUDDER,         EV_ABS, 0 },
+  { HID_UP_SIMULATION | 0x0bb, ABS_THROTTLE,       EV_ABS, 0 },
+  { HID_UP_SIMULATION | 0x0c4, ABS_GAS,            EV_ABS, 0 },
+  { HID_UP_SIMULATION | 0x0c5, ABS_BRAKE,          EV_ABS, 0 },
+  { HID_UP_SIMULATION | 0x0c8, ABS_WHEEL,          EV_ABS, 0 },
+
+  { HID_UP_LED | 0x001,        LED_NUML,           EV_LED, 0 },
+  { HID_UP_LED | 0x002,        LED_CAPSL,          EV_LED, 0 },
+  { HID_UP_LED | 0x003,        LED_SCROLLL,        EV_LED, 0 },
+  { HID_UP_LED | 0x004,        LED_COMPOSE,        EV_LED, 0 },
+  { HID_UP_LED | 0x005,        LED_KANA,           EV_LED, 0 },
+  { HID_UP_LED | 0x009,        LED_MUTE,           EV_LED, 0 },
+  { HID_UP_LED | 0x019,        LED_MAIL,           EV_LED, 0 },
+  { HID_UP_LED | 0x027,        LED_SLEEP,          EV_LED, 0 },
+  { HID_UP_LED | 0x04b,        LED_MISC,           EV_LED, 0 },
+  { HID_UP_LED | 0x04c,        LED_SUSPEND,        EV_LED, 0 },
+  { HID_UP_LED | 0x04d,        LED_CHARGING,       EV_LED, 0 },
+
+  { HID_UP_CONSUMER | 0x030,   KEY_POWER,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x031,   KEY_RESTART,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x032,   KEY_SLEEP,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x034,   KEY_SLEEP,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x035,   KEY_KBDILLUMTOGGLE, EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x036,   BTN_MISC,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x040,   KEY_MENU,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x041,   KEY_SELECT,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x042,   KEY_UP,             EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x043,   KEY_DOWN,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x044,   KEY_LEFT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x045,   KEY_RIGHT,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x046,   KEY_ESC,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x047,   KEY_KPPLUS,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x048,   KEY_KPMINUS,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x060,   KEY_INFO,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x061,   KEY_SUBTITLE,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x063,   KEY_VCR,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x065,   KEY_CAMERA,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x069,   KEY_RED,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x06a,   KEY_GREEN,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x06b,   KEY_BLUE,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x06c,   KEY_YELLOW,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x06d,   KEY_ZOOM,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x082,   KEY_VIDEO_NEXT,     EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x083,   KEY_LAST,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x084,   KEY_ENTER,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x088,   KEY_PC,             EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x089,   KEY_TV,             EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x08a,   KEY_WWW,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x08b,   KEY_DVD,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x08c,   KEY_PHONE,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x08d,   KEY_PROGRAM,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x08e,   KEY_VIDEOPHONE,     EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x08f,   KEY_GAMES,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x090,   KEY_MEMO,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x091,   KEY_CD,             EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x092,   KEY_VCR,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x093,   KEY_TUNER,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x094,   KEY_EXIT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x095,   KEY_HELP,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x096,   KEY_TAPE,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x097,   KEY_TV2,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x098,   KEY_SAT,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x09a,   KEY_PVR,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x09c,   KEY_CHANNELUP,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x09d,   KEY_CHANNELDOWN,    EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0a0,   KEY_VCR2,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b0,   KEY_PLAY,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b1,   KEY_PAUSE,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b2,   KEY_RECORD,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b3,   KEY_FASTFORWARD,    EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b4,   KEY_REWIND,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b5,   KEY_NEXTSONG,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b6,   KEY_PREVIOUSSONG,   EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b7,   KEY_STOPCD,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b8,   KEY_EJECTCD,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0b9,   KEY_SHUFFLE,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0bc,   KEY_MEDIA_REPEAT,   EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0bf,   KEY_SLOW,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0cd,   KEY_PLAYPAUSE,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0e0,   ABS_VOLUME,         EV_ABS, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0e2,   KEY_MUTE,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0e5,   KEY_BASSBOOST,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0e9,   KEY_VOLUMEUP,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0ea,   KEY_VOLUMEDOWN,     EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x0f5,   KEY_SLOW,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x182,   KEY_BOOKMARKS,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x183,   KEY_CONFIG,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x184,   KEY_WORDPROCESSOR,  EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x185,   KEY_EDITOR,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x186,   KEY_SPREADSHEET,    EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x187,   KEY_GRAPHICSEDITOR, EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x188,   KEY_PRESENTATION,   EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x189,   KEY_DATABASE,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x18a,   KEY_MAIL,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x18b,   KEY_NEWS,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x18c,   KEY_VOICEMAIL,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x18d,   KEY_ADDRESSBOOK,    EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x18e,   KEY_CALENDAR,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x191,   KEY_FINANCE,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x192,   KEY_CALC,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x193,   KEY_PLAYER,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x194,   KEY_FILE,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x196,   KEY_WWW,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x199,   KEY_CHAT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x19c,   KEY_LOGOFF,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x19e,   KEY_COFFEE,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1a6,   KEY_HELP,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1a7,   KEY_DOCUMENTS,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1ab,   KEY_SPELLCHECK,     EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1ae,   KEY_KEYBOARD,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1b6,   KEY_IMAGES,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1b7,   KEY_AUDIO,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1b8,   KEY_VIDEO,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1bc,   KEY_MESSENGER,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x1bd,   KEY_INFO,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x201,   KEY_NEW,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x202,   KEY_OPEN,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x203,   KEY_CLOSE,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x204,   KEY_EXIT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x207,   KEY_SAVE,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x208,   KEY_PRINT,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x209,   KEY_PROPS,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x21a,   KEY_UNDO,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x21b,   KEY_COPY,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x21c,   KEY_CUT,            EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x21d,   KEY_PASTE,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x21f,   KEY_FIND,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x221,   KEY_SEARCH,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x222,   KEY_GOTO,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x223,   KEY_HOMEPAGE,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x224,   KEY_BACK,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x225,   KEY_FORWARD,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x226,   KEY_STOP,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x227,   KEY_REFRESH,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x22a,   KEY_BOOKMARKS,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x22d,   KEY_ZOOMIN,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x22e,   KEY_ZOOMOUT,        EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x22f,   KEY_ZOOMRESET,      EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x233,   KEY_SCROLLUP,       EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x234,   KEY_SCROLLDOWN,     EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x238,   REL_HWHEEL,         EV_REL, 0 },
+  { HID_UP_CONSUMER | 0x23d,   KEY_EDIT,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x25f,   KEY_CANCEL,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x269,   KEY_INSERT,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x26a,   KEY_DELETE,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x279,   KEY_REDO,           EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x289,   KEY_REPLY,          EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x28b,   KEY_FORWARDMAIL,    EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_CONSUMER | 0x28c,   KEY_SEND,           EV_KEY, HID_MAP_CLEAR },
+
+  { HID_UP_DIGITIZER | 0x033,  BTN_TOUCH,          EV_KEY, HID_MAP_CLEAR | HID_MAP_TOUCH },
+  { HID_UP_DIGITIZER | 0x03c,  BTN_TOOL_RUBBER,    EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_DIGITIZER | 0x03d,  ABS_TILT_X,         EV_ABS, HID_MAP_CLEAR },
+  { HID_UP_DIGITIZER | 0x03e,  ABS_TILT_Y,         EV_ABS, HID_MAP_CLEAR },
+  { HID_UP_DIGITIZER | 0x042,  BTN_TOUCH,          EV_KEY, HID_MAP_CLEAR | HID_MAP_TOUCH },
+  { HID_UP_DIGITIZER | 0x043,  BTN_TOUCH,          EV_KEY, HID_MAP_CLEAR | HID_MAP_TOUCH },
+  { HID_UP_DIGITIZER | 0x044,  BTN_STYLUS,         EV_KEY, HID_MAP_CLEAR },
+  { HID_UP_DIGITIZER | 0x046,  BTN_STYLUS2,        EV_KEY, HID_MAP_CLEAR },
+
+  { HID_UP_PID | 0x0a4,        BTN_DEAD,           EV_KEY, HID_MAP_CLEAR },
+
+  { HID_UP_HPVENDOR2 | 0x003,  KEY_BRIGHTNESSDOWN, EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR2 | 0x004,  KEY_BRIGHTNESSUP,   EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+
+  { HID_UP_HPVENDOR | 0x021,   KEY_PRINT,          EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x070,   KEY_HP,             EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x071,   KEY_CAMERA,         EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x072,   KEY_SOUND,          EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x073,   KEY_QUESTION,       EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x080,   KEY_EMAIL,          EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x081,   KEY_CHAT,           EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x082,   KEY_SEARCH,         EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x083,   KEY_CONNECT,        EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x084,   KEY_FINANCE,        EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x085,   KEY_SPORT,          EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+  { HID_UP_HPVENDOR | 0x086,   KEY_SHOP,           EV_KEY, HID_MAP_CLEAR | HID_MAP_REP },
+
+};
+
+static const struct hidinput_map *hidinput_find_usage(unsigned hid)
+{
+  unsigned lo = 0, hi = sizeof(hidinput_usage_map) / sizeof(hidinput_usage_map[0]);
+  unsigned mid;
+
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (hidinput_usage_map[mid].hid < hid)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < sizeof(hidinput_usage_map) / sizeof(hidinput_usage_map[0])
+      && hidinput_usage_map[lo].hid == hid)
+    return &hidinput_usage_map[lo];
+  return NULL;
+}
+
 #if 0
 
 static bool match_scancode(struct hid_usage *usage,
@@ -1005,12 +1213,45 @@ static void hidinput_cleanup_battery(struct hid_device *dev)
 
 
 
+/*
+ * Sort a mapped usage into the hidinput_hid_event() cases, which only
+ * depend on the mapping, so that the per value work is a switch.
+ */
+static uint8_t hidinput_usage_special(struct hid_field *field, struct hid_usage *usage)
+{
+  if (usage->hat_min < usage->hat_max || usage->hat_dir)
+    return HID_SPECIAL_HAT;
+
+  switch (usage->hid)
+  {
+  case HID_UP_DIGITIZER | 0x003c:
+    return HID_SPECIAL_INVERT;
+  case HID_UP_DIGITIZER | 0x0032:
+    return HID_SPECIAL_INRANGE;
+  case HID_UP_DIGITIZER | 0x0030:
+    return HID_SPECIAL_PRESSURE;
+  case HID_UP_PID | 0x83UL: /* Simultaneous Effects Max */
+  case HID_UP_PID | 0x7fUL: /* PID Pool Report */
+    return HID_SPECIAL_SKIP;
+  }
+
+  if ((usage->type == EV_KEY) && (usage->code == 0)) /* Key 0 is "unassigned", not KEY_UNKNOWN */
+    return HID_SPECIAL_SKIP;
+
+  if ((usage->type == EV_ABS) && (field->flags & HID_MAIN_ITEM_RELATIVE)
+      && (usage->code == ABS_VOLUME))
+    return HID_SPECIAL_VOLUME;
+
+  return HID_SPECIAL_NONE;
+}
+
 static void hidinput_configure_usage(struct hid_input *hidinput,
     struct hid_field *field, struct hid_usage *usage)
 {
   struct input_dev *input = hidinput->input;
   // struct hid_device *device = input_get_drvdata(input);
   struct hid_device *device = input->hiddev;
+  const struct hidinput_map *map;
 
   int max = 0, code;
   unsigned long *bit = NULL;
@@ -1048,13 +1289,22 @@ static void hidinput_configure_usage(struct hid_input *hidinput,
 //			goto ignore;
 //	}
 
-  switch (usage->hid & HID_USAGE_PAGE)
+  map = hidinput_find_usage(usage->hid);
+  if (map)
   {
-  case HID_UP_UNDEFINED:
-    USBH_UsrLog("HID_UP_UNDEFINED")
-    ;
-    goto ignore;
+    if (map->flags & HID_MAP_REP)
+      set_bit(EV_REP, input->evbit);
+    if (map->flags & HID_MAP_TOUCH)
+      device->quirks &= ~HID_QUIRK_NOTOUCH;
+    hid_map_usage(hidinput, usage, &bit, &max, map->type, map->code);
+    if (map->flags & HID_MAP_CLEAR)
+      clear_bit(map->code, bit);
+    goto mapped;
+  }
 
+  /* usages hidinput_usage_map[] has no fixed code for */
+  switch (usage->hid & HID_USAGE_PAGE)
+  {
   case HID_UP_KEYBOARD:
     set_bit(EV_REP, input->evbit);
 
@@ -1115,89 +1365,9 @@ static void hidinput_configure_usage(struct hid_input *hidinput,
     map_key(code);
     break;
 
-  case HID_UP_SIMULATION:
-    USBH_UsrLog("HID_UP_SIMULATION")
-    ;
-    switch (usage->hid & 0xffff)
-    {
-    case 0xba:
-      map_abs(ABS_RUDDER);
-      break;
-    case 0xbb:
-      map_abs(ABS_THROTTLE);
-      break;
-    case 0xc4:
-      map_abs(ABS_GAS);
-      break;
-    case 0xc5:
-      map_abs(ABS_BRAKE);
-      break;
-    case 0xc8:
-      map_abs(ABS_WHEEL);
-      break;
-    default:
-      goto ignore;
-    }
-    break;
-
   case HID_UP_GENDESK:
     USBH_UsrLog("HID_UP_GENDESK")
     ;
-    if ((usage->hid & 0xf0) == 0x80)
-    { /* SystemControl */
-      switch (usage->hid & 0xf)
-      {
-      case 0x1:
-        map_key_clear(KEY_POWER);
-        break;
-      case 0x2:
-        map_key_clear(KEY_SLEEP);
-        break;
-      case 0x3:
-        map_key_clear(KEY_WAKEUP);
-        break;
-      case 0x4:
-        map_key_clear(KEY_CONTEXT_MENU);
-        break;
-      case 0x5:
-        map_key_clear(KEY_MENU);
-        break;
-      case 0x6:
-        map_key_clear(KEY_PROG1);
-        break;
-      case 0x7:
-        map_key_clear(KEY_HELP);
-        break;
-      case 0x8:
-        map_key_clear(KEY_EXIT);
-        break;
-      case 0x9:
-        map_key_clear(KEY_SELECT);
-        break;
-      case 0xa:
-        map_key_clear(KEY_RIGHT);
-        break;
-      case 0xb:
-        map_key_clear(KEY_LEFT);
-        break;
-      case 0xc:
-        map_key_clear(KEY_UP);
-        break;
-      case 0xd:
-        map_key_clear(KEY_DOWN);
-        break;
-      case 0xe:
-        map_key_clear(KEY_POWER2);
-        break;
-      case 0xf:
-        map_key_clear(KEY_RESTART);
-        break;
-      default:
-        goto unknown;
-      }
-      break;
-    }
-
     if ((usage->hid & 0xf0) == 0x90)
     { /* D-pad */
       switch (usage->hid)
@@ -1250,67 +1420,16 @@ static void hidinput_configure_usage(struct hid_input *hidinput,
       map_abs(ABS_HAT0X);
       break;
 
-    case HID_GD_START:
-      map_key_clear(BTN_START);
-      break;
-    case HID_GD_SELECT:
-      map_key_clear(BTN_SELECT);
-      break;
-
     default:
       goto unknown;
     }
 
     break;
 
-  case HID_UP_LED:
-    // USBH_UsrLog("HID_UP_LED");
-
-    switch (usage->hid & 0xffff)
-    { /* HID-Value:                   */
-    case 0x01:
-      map_led(LED_NUML);
-      break; /*   "Num Lock"                 */
-    case 0x02:
-      map_led(LED_CAPSL);
-      break; /*   "Caps Lock"                */
-    case 0x03:
-      map_led(LED_SCROLLL);
-      break; /*   "Scroll Lock"              */
-    case 0x04:
-      map_led(LED_COMPOSE);
-      break; /*   "Compose"                  */
-    case 0x05:
-      map_led(LED_KANA);
-      break; /*   "Kana"                     */
-    case 0x27:
-      map_led(LED_SLEEP);
-      break; /*   "Stand-By"                 */
-    case 0x4c:
-      map_led(LED_SUSPEND);
-      break; /*   "System Suspend"           */
-    case 0x09:
-      map_led(LED_MUTE);
-      break; /*   "Mute"                     */
-    case 0x4b:
-      map_led(LED_MISC);
-      break; /*   "Generic Indicator"        */
-    case 0x19:
-      map_led(LED_MAIL);
-      break; /*   "Message Waiting"          */
-    case 0x4d:
-      map_led(LED_CHARGING);
-      break; /*   "External Power Connected" */
-
-    default:
-      goto ignore;
-    }
-    break;
-
   case HID_UP_DIGITIZER:
     USBH_UsrLog("HID_UP_DIGITIZER")
     ;
-    switch (usage->hid & 0xff)
+    switch (usage->hid & HID_USAGE)
     {
     case 0x00: /* Undefined */
       goto ignore;
@@ -1341,553 +1460,33 @@ static void hidinput_configure_usage(struct hid_input *hidinput,
       }
       break;
 
-    case 0x3c: /* Invert */
-      map_key_clear(BTN_TOOL_RUBBER);
-      break;
-
-    case 0x3d: /* X Tilt */
-      map_abs_clear(ABS_TILT_X);
-      break;
-
-    case 0x3e: /* Y Tilt */
-      map_abs_clear(ABS_TILT_Y);
-      break;
-
-    case 0x33: /* Touch */
-    case 0x42: /* TipSwitch */
-    case 0x43: /* TipSwitch2 */
-      device->quirks &= ~HID_QUIRK_NOTOUCH;
-      map_key_clear(BTN_TOUCH);
-      break;
-
-    case 0x44: /* BarrelSwitch */
-      map_key_clear(BTN_STYLUS);
-      break;
-
-    case 0x46: /* TabletPick */
-      map_key_clear(BTN_STYLUS2);
-      break;
-
     default:
       goto unknown;
     }
     break;
 
-  case HID_UP_CONSUMER: /* USB HUT v1.12, pages 75-84 */
-    USBH_UsrLog("HID_UP_CONSUMER")
-    ;
-    switch (usage->hid & HID_USAGE)
-    {
-    case 0x000:
-      goto ignore;
-    case 0x030:
-      map_key_clear(KEY_POWER);
-      break;
-    case 0x031:
-      map_key_clear(KEY_RESTART);
-      break;
-    case 0x032:
-      map_key_clear(KEY_SLEEP);
-      break;
-    case 0x034:
-      map_key_clear(KEY_SLEEP);
-      break;
-    case 0x035:
-      map_key_clear(KEY_KBDILLUMTOGGLE);
-      break;
-    case 0x036:
-      map_key_clear(BTN_MISC);
-      break;
-
-    case 0x040:
-      map_key_clear(KEY_MENU);
-      break; /* Menu */
-    case 0x041:
-      map_key_clear(KEY_SELECT);
-      break; /* Menu Pick */
-    case 0x042:
-      map_key_clear(KEY_UP);
-      break; /* Menu Up */
-    case 0x043:
-      map_key_clear(KEY_DOWN);
-      break; /* Menu Down */
-    case 0x044:
-      map_key_clear(KEY_LEFT);
-      break; /* Menu Left */
-    case 0x045:
-      map_key_clear(KEY_RIGHT);
-      break; /* Menu Right */
-    case 0x046:
-      map_key_clear(KEY_ESC);
-      break; /* Menu Escape */
-    case 0x047:
-      map_key_clear(KEY_KPPLUS);
-      break; /* Menu Value Increase */
-    case 0x048:
-      map_key_clear(KEY_KPMINUS);
-      break; /* Menu Value Decrease */
-
-    case 0x060:
-      map_key_clear(KEY_INFO);
-      break; /* Data On Screen */
-    case 0x061:
-      map_key_clear(KEY_SUBTITLE);
-      break; /* Closed Caption */
-    case 0x063:
-      map_key_clear(KEY_VCR);
-      break; /* VCR/TV */
-    case 0x065:
-      map_key_clear(KEY_CAMERA);
-      break; /* Snapshot */
-    case 0x069:
-      map_key_clear(KEY_RED);
-      break;
-    case 0x06a:
-      map_key_clear(KEY_GREEN);
-      break;
-    case 0x06b:
-      map_key_clear(KEY_BLUE);
-      break;
-    case 0x06c:
-      map_key_clear(KEY_YELLOW);
-      break;
-    case 0x06d:
-      map_key_clear(KEY_ZOOM);
-      break;
-
-    case 0x082:
-      map_key_clear(KEY_VIDEO_NEXT);
-      break;
-    case 0x083:
-      map_key_clear(KEY_LAST);
-      break;
-    case 0x084:
-      map_key_clear(KEY_ENTER);
-      break;
-    case 0x088:
-      map_key_clear(KEY_PC);
-      break;
-    case 0x089:
-      map_key_clear(KEY_TV);
-      break;
-    case 0x08a:
-      map_key_clear(KEY_WWW);
-      break;
-    case 0x08b:
-      map_key_clear(KEY_DVD);
-      break;
-    case 0x08c:
-      map_key_clear(KEY_PHONE);
-      break;
-    case 0x08d:
-      map_key_clear(KEY_PROGRAM);
-      break;
-    case 0x08e:
-      map_key_clear(KEY_VIDEOPHONE);
-      break;
-    case 0x08f:
-      map_key_clear(KEY_GAMES);
-      break;
-    case 0x090:
-      map_key_clear(KEY_MEMO);
-      break;
-    case 0x091:
-      map_key_clear(KEY_CD);
-      break;
-    case 0x092:
-      map_key_clear(KEY_VCR);
-      break;
-    case 0x093:
-      map_key_clear(KEY_TUNER);
-      break;
-    case 0x094:
-      map_key_clear(KEY_EXIT);
-      break;
-    case 0x095:
-      map_key_clear(KEY_HELP);
-      break;
-    case 0x096:
-      map_key_clear(KEY_TAPE);
-      break;
-    case 0x097:
-      map_key_clear(KEY_TV2);
-      break;
-    case 0x098:
-      map_key_clear(KEY_SAT);
-      break;
-    case 0x09a:
-      map_key_clear(KEY_PVR);
-      break;
-
-    case 0x09c:
-      map_key_clear(KEY_CHANNELUP);
-      break;
-    case 0x09d:
-      map_key_clear(KEY_CHANNELDOWN);
-      break;
-    case 0x0a0:
-      map_key_clear(KEY_VCR2);
-      break;
-
-    case 0x0b0:
-      map_key_clear(KEY_PLAY);
-      break;
-    case 0x0b1:
-      map_key_clear(KEY_PAUSE);
-      break;
-    case 0x0b2:
-      map_key_clear(KEY_RECORD);
-      break;
-    case 0x0b3:
-      map_key_clear(KEY_FASTFORWARD);
-      break;
-    case 0x0b4:
-      map_key_clear(KEY_REWIND);
-      break;
-    case 0x0b5:
-      map_key_clear(KEY_NEXTSONG);
-      break;
-    case 0x0b6:
-      map_key_clear(KEY_PREVIOUSSONG);
-      break;
-    case 0x0b7:
-      map_key_clear(KEY_STOPCD);
-      break;
-    case 0x0b8:
-      map_key_clear(KEY_EJECTCD);
-      break;
-    case 0x0bc:
-      map_key_clear(KEY_MEDIA_REPEAT);
-      break;
-    case 0x0b9:
-      map_key_clear(KEY_SHUFFLE);
-      break;
-    case 0x0bf:
-      map_key_clear(KEY_SLOW);
-      break;
-
-    case 0x0cd:
-      map_key_clear(KEY_PLAYPAUSE);
-      break;
-    case 0x0e0:
-      map_abs_clear(ABS_VOLUME);
-      break;
-    case 0x0e2:
-      map_key_clear(KEY_MUTE);
-      break;
-    case 0x0e5:
-      map_key_clear(KEY_BASSBOOST);
-      break;
-    case 0x0e9:
-      map_key_clear(KEY_VOLUMEUP);
-      break;
-    case 0x0ea:
-      map_key_clear(KEY_VOLUMEDOWN);
-      break;
-    case 0x0f5:
-      map_key_clear(KEY_SLOW);
-      break;
-
-    case 0x182:
-      map_key_clear(KEY_BOOKMARKS);
-      break;
-    case 0x183:
-      map_key_clear(KEY_CONFIG);
-      break;
-    case 0x184:
-      map_key_clear(KEY_WORDPROCESSOR);
-      break;
-    case 0x185:
-      map_key_clear(KEY_EDITOR);
-      break;
-    case 0x186:
-      map_key_clear(KEY_SPREADSHEET);
-      break;
-    case 0x187:
-      map_key_clear(KEY_GRAPHICSEDITOR);
-      break;
-    case 0x188:
-      map_key_clear(KEY_PRESENTATION);
-      break;
-    case 0x189:
-      map_key_clear(KEY_DATABASE);
-      break;
-    case 0x18a:
-      map_key_clear(KEY_MAIL);
-      break;
-    case 0x18b:
-      map_key_clear(KEY_NEWS);
-      break;
-    case 0x18c:
-      map_key_clear(KEY_VOICEMAIL);
-      break;
-    case 0x18d:
-      map_key_clear(KEY_ADDRESSBOOK);
-      break;
-    case 0x18e:
-      map_key_clear(KEY_CALENDAR);
-      break;
-    case 0x191:
-      map_key_clear(KEY_FINANCE);
-      break;
-    case 0x192:
-      map_key_clear(KEY_CALC);
-      break;
-    case 0x193:
-      map_key_clear(KEY_PLAYER);
-      break;
-    case 0x194:
-      map_key_clear(KEY_FILE);
-      break;
-    case 0x196:
-      map_key_clear(KEY_WWW);
-      break;
-    case 0x199:
-      map_key_clear(KEY_CHAT);
-      break;
-    case 0x19c:
-      map_key_clear(KEY_LOGOFF);
-      break;
-    case 0x19e:
-      map_key_clear(KEY_COFFEE);
-      break;
-    case 0x1a6:
-      map_key_clear(KEY_HELP);
-      break;
-    case 0x1a7:
-      map_key_clear(KEY_DOCUMENTS);
-      break;
-    case 0x1ab:
-      map_key_clear(KEY_SPELLCHECK);
-      break;
-    case 0x1ae:
-      map_key_clear(KEY_KEYBOARD);
-      break;
-    case 0x1b6:
-      map_key_clear(KEY_IMAGES);
-      break;
-    case 0x1b7:
-      map_key_clear(KEY_AUDIO);
-      break;
-    case 0x1b8:
-      map_key_clear(KEY_VIDEO);
-      break;
-    case 0x1bc:
-      map_key_clear(KEY_MESSENGER);
-      break;
-    case 0x1bd:
-      map_key_clear(KEY_INFO);
-      break;
-    case 0x201:
-      map_key_clear(KEY_NEW);
-      break;
-    case 0x202:
-      map_key_clear(KEY_OPEN);
-      break;
-    case 0x203:
-      map_key_clear(KEY_CLOSE);
-      break;
-    case 0x204:
-      map_key_clear(KEY_EXIT);
-      break;
-    case 0x207:
-      map_key_clear(KEY_SAVE);
-      break;
-    case 0x208:
-      map_key_clear(KEY_PRINT);
-      break;
-    case 0x209:
-      map_key_clear(KEY_PROPS);
-      break;
-    case 0x21a:
-      map_key_clear(KEY_UNDO);
-      break;
-    case 0x21b:
-      map_key_clear(KEY_COPY);
-      break;
-    case 0x21c:
-      map_key_clear(KEY_CUT);
-      break;
-    case 0x21d:
-      map_key_clear(KEY_PASTE);
-      break;
-    case 0x21f:
-      map_key_clear(KEY_FIND);
-      break;
-    case 0x221:
-      map_key_clear(KEY_SEARCH);
-      break;
-    case 0x222:
-      map_key_clear(KEY_GOTO);
-      break;
-    case 0x223:
-      map_key_clear(KEY_HOMEPAGE);
-      break;
-    case 0x224:
-      map_key_clear(KEY_BACK);
-      break;
-    case 0x225:
-      map_key_clear(KEY_FORWARD);
-      break;
-    case 0x226:
-      map_key_clear(KEY_STOP);
-      break;
-    case 0x227:
-      map_key_clear(KEY_REFRESH);
-      break;
-    case 0x22a:
-      map_key_clear(KEY_BOOKMARKS);
-      break;
-    case 0x22d:
-      map_key_clear(KEY_ZOOMIN);
-      break;
-    case 0x22e:
-      map_key_clear(KEY_ZOOMOUT);
-      break;
-    case 0x22f:
-      map_key_clear(KEY_ZOOMRESET);
-      break;
-    case 0x233:
-      map_key_clear(KEY_SCROLLUP);
-      break;
-    case 0x234:
-      map_key_clear(KEY_SCROLLDOWN);
-      break;
-    case 0x238:
-      map_rel(REL_HWHEEL);
-      break;
-    case 0x23d:
-      map_key_clear(KEY_EDIT);
-      break;
-    case 0x25f:
-      map_key_clear(KEY_CANCEL);
-      break;
-    case 0x269:
-      map_key_clear(KEY_INSERT);
-      break;
-    case 0x26a:
-      map_key_clear(KEY_DELETE);
-      break;
-    case 0x279:
-      map_key_clear(KEY_REDO);
-      break;
-
-    case 0x289:
-      map_key_clear(KEY_REPLY);
-      break;
-    case 0x28b:
-      map_key_clear(KEY_FORWARDMAIL);
-      break;
-    case 0x28c:
-      map_key_clear(KEY_SEND);
-      break;
-
-    default:
-      goto ignore;
-    }
-    break;
-
-  case HID_UP_GENDEVCTRLS:        // TODO
-    USBH_UsrLog("HID_UP_GENDEVCTRLS")
-    ;
-//		if (hidinput_setup_battery(device, HID_INPUT_REPORT, field))
-//			goto ignore;
-//		else
-//			goto unknown;
-    break;
-
   case HID_UP_HPVENDOR: /* Reported on a Dutch layout HP5308 */
-    USBH_UsrLog("HID_UP_HPVENDOR")
-    ;
-    set_bit(EV_REP, input->evbit);
-    switch (usage->hid & HID_USAGE)
-    {
-    case 0x021:
-      map_key_clear(KEY_PRINT);
-      break;
-    case 0x070:
-      map_key_clear(KEY_HP);
-      break;
-    case 0x071:
-      map_key_clear(KEY_CAMERA);
-      break;
-    case 0x072:
-      map_key_clear(KEY_SOUND);
-      break;
-    case 0x073:
-      map_key_clear(KEY_QUESTION);
-      break;
-    case 0x080:
-      map_key_clear(KEY_EMAIL);
-      break;
-    case 0x081:
-      map_key_clear(KEY_CHAT);
-      break;
-    case 0x082:
-      map_key_clear(KEY_SEARCH);
-      break;
-    case 0x083:
-      map_key_clear(KEY_CONNECT);
-      break;
-    case 0x084:
-      map_key_clear(KEY_FINANCE);
-      break;
-    case 0x085:
-      map_key_clear(KEY_SPORT);
-      break;
-    case 0x086:
-      map_key_clear(KEY_SHOP);
-      break;
-    default:
-      goto ignore;
-    }
-    break;
-
   case HID_UP_HPVENDOR2:
-    USBH_UsrLog("HID_UP_HPVENDOR2")
-    ;
-    set_bit(EV_REP, input->evbit);
-    switch (usage->hid & HID_USAGE)
-    {
-    case 0x003:
-      map_key_clear(KEY_BRIGHTNESSDOWN);
-      break;
-    case 0x004:
-      map_key_clear(KEY_BRIGHTNESSUP);
-      break;
-    default:
-      goto ignore;
-    }
-    break;
-
-  case HID_UP_MSVENDOR:
-    USBH_UsrLog("HID_UP_MSVENDOR")
-    ;
-    goto ignore;
-
   case HID_UP_CUSTOM: /* Reported on Logitech and Apple USB keyboards */
-    USBH_UsrLog("HID_UP_CUSTOM")
-    ;
     set_bit(EV_REP, input->evbit);
     goto ignore;
 
+  /* pages mapped by hidinput_usage_map[] alone */
+  case HID_UP_UNDEFINED:
+  case HID_UP_SIMULATION:
+  case HID_UP_LED:
+  case HID_UP_CONSUMER:
+  case HID_UP_MSVENDOR:
   case HID_UP_LOGIVENDOR:
-    USBH_UsrLog("HID_UP_LOGIVENDOR")
-    ;
+  case HID_UP_PID:
     goto ignore;
 
-  case HID_UP_PID:
-    USBH_UsrLog("HID_UP_PID")
-    ;
-    switch (usage->hid & HID_USAGE)
-    {
-    case 0xa4:
-      map_key_clear(BTN_DEAD);
-      break;
-    default:
-      goto ignore;
-    }
-    break;
+  case HID_UP_GENDEVCTRLS:
+//		if (hidinput_setup_battery(device, HID_INPUT_REPORT, field))
+//			goto ignore;
+//		else
+//			goto unknown;
+    goto unknown;
 
   default:
     USBH_UsrLog("HID_UP_DEFAULT")
@@ -1982,7 +1581,7 @@ static void hidinput_configure_usage(struct hid_input *hidinput,
     set_bit(MSC_SCAN, input->mscbit);
   }
 
-  ignore: return;
+  ignore: usage->special = hidinput_usage_special(field, usage);
 }
 
 /*
@@ -2010,7 +1609,9 @@ void hidinput_hid_event(struct hid_device *hid, struct hid_field *field,
     return;
   }
 
-  if (usage->hat_min < usage->hat_max || usage->hat_dir)
+  switch (usage->special)
+  {
+  case HID_SPECIAL_HAT:
   {
     int hat_dir = usage->hat_dir;
     if (!hat_dir)
@@ -2024,14 +1625,11 @@ void hidinput_hid_event(struct hid_device *hid, struct hid_field *field,
     return;
   }
 
-  if (usage->hid == (HID_UP_DIGITIZER | 0x003c))
-  { /* Invert */
+  case HID_SPECIAL_INVERT:
     *quirks = value ? (*quirks | HID_QUIRK_INVERT) : (*quirks & ~HID_QUIRK_INVERT);
     return;
-  }
 
-  if (usage->hid == (HID_UP_DIGITIZER | 0x0032))
-  { /* InRange */
+  case HID_SPECIAL_INRANGE:
     if (value)
     {
       input_event(input, usage->type,
@@ -2041,35 +1639,20 @@ void hidinput_hid_event(struct hid_device *hid, struct hid_field *field,
     input_event(input, usage->type, usage->code, 0);
     input_event(input, usage->type, BTN_TOOL_RUBBER, 0);
     return;
-  }
-
-  if (usage->hid == (HID_UP_DIGITIZER | 0x0030)
-      && (*quirks & HID_QUIRK_NOTOUCH))
-  { /* Pressure */
-    int a = field->logical_minimum;
-    int b = field->logical_maximum;
-    input_event(input, EV_KEY, BTN_TOUCH, value > a + ((b - a) >> 3));
-  }
-
-  if (usage->hid == (HID_UP_PID | 0x83UL))
-  { /* Simultaneous Effects Max */
-    // dbg_hid("Maximum Effects - %d\n",value);
-    return;
-  }
 
-  if (usage->hid == (HID_UP_PID | 0x7fUL))
-  {
-    // dbg_hid("PID Pool Report\n");
-    return;
-  }
+  case HID_SPECIAL_PRESSURE:
+    if (*quirks & HID_QUIRK_NOTOUCH)
+    {
+      int a = field->logical_minimum;
+      int b = field->logical_maximum;
+      input_event(input, EV_KEY, BTN_TOUCH, value > a + ((b - a) >> 3));
+    }
+    break;
 
-  if ((usage->type == EV_KEY) && (usage->code == 0)) /* Key 0 is "unassigned", not KEY_UNKNOWN */
-  {
+  case HID_SPECIAL_SKIP:
     return;
-  }
 
-  if ((usage->type == EV_ABS) && (field->flags & HID_MAIN_ITEM_RELATIVE)
-      && (usage->code == ABS_VOLUME))
+  case HID_SPECIAL_VOLUME:
   {
     int count = abs(value);
     int direction = value > 0 ? KEY_VOLUMEUP : KEY_VOLUMEDOWN;
@@ -2084,6 +1667,7 @@ void hidinput_hid_event(struct hid_device *hid, struct hid_field *field,
     }
     return;
   }
+  }
 
   /*
    * Ignore out-of-range values as per HID specification,
@@ -2110,6 +1694,27 @@ void hidinput_hid_event(struct hid_device *hid, struct hid_field *field,
     input_event(input, usage->type, usage->code, 0);
 }
 
+/*
+ * Classify a variable usage for the compiled decoder, see hid_compile_reports().
+ * Usages hidinput_hid_event() would drop become HID_OP_RAW, the special
+ * cases stay with hidinput_hid_event() and the rest is a plain input_event().
+ */
+int hidinput_usage_kind(struct hid_field *field, struct hid_usage *usage)
+{
+  if (!field->hidinput || !usage->type)
+    return HID_OP_RAW;
+
+  switch (usage->special)
+  {
+  case HID_SPECIAL_NONE:
+    return HID_OP_EMIT;
+  case HID_SPECIAL_SKIP:
+    return HID_OP_RAW;
+  default:
+    return HID_OP_EVENT;
+  }
+}
+
 /*
  * do input sync for each device
  */
@@ -2312,21 +1917,17 @@ static struct hid_input *hidinput_allocate(struct hid_device *hid)
 //		return NULL;
 //	}
 
-    struct hid_input *hidinput = malloc(sizeof(struct hid_input));
+    /* both come zeroed from the device arena and go with hid_close_report() */
+    struct hid_input *hidinput = hid_arena_alloc(hid, sizeof(struct hid_input));
     if (hidinput == NULL)
       return NULL;
 
-    struct input_dev *input_dev = malloc(sizeof(struct input_dev));
-    if (input_dev == NULL) {
-      free(hidinput);
+    struct input_dev *input_dev = hid_arena_alloc(hid, sizeof(struct input_dev));
+    if (input_dev == NULL)
       return NULL;
-    }
 
-    memset(input_dev, 0, sizeof(struct input_dev));
     input_dev->hiddev = hid;
 
-    memset(hidinput, 0, sizeof(struct hid_input));
-
 //	input_set_drvdata(input_dev, hid);
     input_dev->hiddev = hid;
 
@@ -2398,7 +1999,7 @@ static void hidinput_cleanup_hidinput(struct hid_device *hid,
   list_del(&hidinput->list);
   // TODO may be problematic
   // input_free_device(hidinput->input);
-  free(hidinput->input);
+  /* hidinput and its input_dev are arena memory, only unlink them here */
 
   for (k = HID_INPUT_REPORT; k <= HID_OUTPUT_REPORT; k++)
   {
@@ -2416,7 +2017,6 @@ static void hidinput_cleanup_hidinput(struct hid_device *hid,
   }
 
   // kfree(hidinput);
-  free(hidinput);
 }
 
 /*
@@ -2433,6 +2033,10 @@ int hidinput_connect(struct hid_device *hid, unsigned int force)
   INIT_LIST_HEAD(&hid->inputs);
   // INIT_WORK(&hid->led_work, hidinput_led_worker);
 
+#if (USBH_HID_INPUT_DEBUG == 1)
+  input_register_handler(&hidinput_debug_handler);
+#endif
+
   if (!force)
   {
     for (i = 0; i < hid->maxcollection; i++)
@@ -2524,7 +2128,6 @@ int hidinput_connect(struct hid_device *hid, unsigned int force)
     list_del(&hidinput->list);
     // input_free_device(hidinput->input);
     // kfree(hidinput);
-    free(hidinput);
 
   out_unwind:
     /* unwind the ones we already registered */
@@ -2543,10 +2146,9 @@ void hidinput_disconnect(struct hid_device *hid)
 
   list_for_each_entry_safe(hidinput, next, &hid->inputs, list)
   {
-    list_del(&hidinput->list);
     // input_unregister_device(hidinput->input);
-    // kfree(hidinput);
-    free(hidinput);
+    /* also frees the input_dev and clears field->hidinput */
+    hidinput_cleanup_hidinput(hid, hidinput);
   }
 
   /* led_work is spawned by input_dev callbacks, but doesn't access the
@@ -2557,4 +2159,17 @@ void hidinput_disconnect(struct hid_device *hid)
 }
 // EXPORT_SYMBOL_GPL(hidinput_disconnect);
 
+/*
+ * Redo what hidinput_connect() does outside the device for one that
+ * hid_load_device() brought back already connected.
+ */
+void hidinput_restore(struct hid_device *hid)
+{
+#if (USBH_HID_INPUT_DEBUG == 1)
+  input_register_handler(&hidinput_debug_handler);
+#else
+  (void)hid;
+#endif
+}
+
 
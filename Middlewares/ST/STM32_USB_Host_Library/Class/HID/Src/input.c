@@ -1,5 +1,6 @@
 #include <stdlib.h>
 #include "kinput.h"
+#include "hid.h"
 
 /**
  * input_alloc_absinfo - allocates array of input_absinfo structs
@@ -13,7 +14,7 @@ void input_alloc_absinfo(struct input_dev *dev)
   if (!dev->absinfo)
   {
     // dev->absinfo = kcalloc(ABS_CNT, sizeof(struct input_absinfo), GFP_KERNEL);
-    dev->absinfo = malloc(ABS_CNT * sizeof(struct input_absinfo));
+    dev->absinfo = hid_arena_alloc(dev->hiddev, ABS_CNT * sizeof(struct input_absinfo));
   }
 
   // WARN(!dev->absinfo, "%s(): kcalloc() failed?\n", __func__);
@@ -38,3 +39,132 @@ void input_set_abs_params(struct input_dev *dev, unsigned int axis, int min,
   dev->absbit[BIT_WORD(axis)] |= BIT_MASK(axis);
 }
 // EXPORT_SYMBOL( input_set_abs_params);
+
+static LIST_HEAD(input_handler_list);
+
+/**
+ * input_register_handler - subscribe to the events of every input device
+ * @handler: handler to add, its node is owned by the input core until
+ *	input_unregister_handler()
+ */
+int input_register_handler(struct input_handler *handler)
+{
+  struct input_handler *h;
+
+  if (!handler->events)
+    return -1;
+
+  list_for_each_entry(h, &input_handler_list, node)
+  {
+    if (h == handler)
+      return -1;
+  }
+
+  list_add_tail(&handler->node, &input_handler_list);
+  return 0;
+}
+// EXPORT_SYMBOL(input_register_handler);
+
+void input_unregister_handler(struct input_handler *handler)
+{
+  struct input_handler *h;
+
+  list_for_each_entry(h, &input_handler_list, node)
+  {
+    if (h == handler)
+    {
+      list_del(&handler->node);
+      return;
+    }
+  }
+}
+// EXPORT_SYMBOL(input_unregister_handler);
+
+static void input_pass_values(struct input_dev *dev)
+{
+  struct input_handler *handler;
+
+  list_for_each_entry(handler, &input_handler_list, node)
+    handler->events(handler, dev, dev->vals, dev->num_vals);
+
+  dev->num_vals = 0;
+}
+
+static void input_queue_value(struct input_dev *dev, unsigned int type,
+    unsigned int code, int value)
+{
+  struct input_event *ev = &dev->vals[dev->num_vals++];
+
+  ev->time = HAL_GetTick();
+  ev->type = type;
+  ev->code = code;
+  ev->value = value;
+}
+
+/**
+ * input_event - queue an event for the handlers
+ * @dev: device that generated the event
+ * @type: type of the event
+ * @code: event code
+ * @value: value of the event
+ *
+ * Like the kernel input core this drops events that do not change the
+ * device state (key already in that position, zero relative motion,
+ * unchanged absolute value) and hands the rest to the handlers as one
+ * batch when SYN_REPORT arrives. A report that produces more events than
+ * the queue holds is split into several batches, each closed by its own
+ * SYN_REPORT.
+ */
+void input_event(struct input_dev *dev, unsigned int type, unsigned int code,
+    int value)
+{
+  switch (type)
+  {
+  case EV_SYN:
+    if (code == SYN_REPORT && dev->num_vals)
+    {
+      input_queue_value(dev, EV_SYN, SYN_REPORT, 0);
+      input_pass_values(dev);
+    }
+    return;
+
+  case EV_KEY:
+    if (code >= KEY_CNT)
+      return;
+    /* autorepeat (2) is passed on without touching the state */
+    if (value != 2)
+    {
+      if (!!test_bit(code, dev->key) == !!value)
+        return;
+      if (value)
+        __set_bit(code, dev->key);
+      else
+        __clear_bit(code, dev->key);
+    }
+    break;
+
+  case EV_REL:
+    if (!value)
+      return;
+    break;
+
+  case EV_ABS:
+    if (dev->absinfo && code < ABS_CNT)
+    {
+      if (dev->absinfo[code].value == value)
+        return;
+      dev->absinfo[code].value = value;
+    }
+    break;
+  }
+
+  /* keep the last slot for the SYN_REPORT that closes the batch */
+  if (dev->num_vals >= USBH_HID_EVENT_RING - 1)
+  {
+    input_queue_value(dev, EV_SYN, SYN_REPORT, 0);
+    input_pass_values(dev);
+  }
+
+  input_queue_value(dev, type, code, value);
+}
+// EXPORT_SYMBOL(input_event);
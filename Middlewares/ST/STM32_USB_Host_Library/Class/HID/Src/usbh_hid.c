@@ -40,38 +40,65 @@
  */
 
 /* Includes ------------------------------------------------------------------*/
+#include <errno.h>
 #include "debug.h"
 #include "hid.h"
 #include "usbh_hid.h"
+#include "usbh_hid_scan.h"
+#include "usbh_hid_pos.h"
+#include "usbh_hid_cache.h"
+#include "usbh_hid_motion.h"
 
 /**
  * debug control
  */
-static void suppress_in_pipe_debug_print(uint8_t pipenum)
+static void suppress_in_pipe_debug_print(void)
 {
 	debug_hal_hcd_hc_submitrequest_print = 0;
-	debug_hc_hcintx_mask[pipenum] = 0;
 }
 
-static void unsupress_in_pipe_debug_print(uint8_t pipenum)
+static void unsupress_in_pipe_debug_print(void)
 {
   debug_hal_hcd_hc_submitrequest_print = DEBUG_HAL_HCD_HC_SUBMITREQUEST_DEFAULT;
-  debug_hc_hcintx_mask[pipenum] = DEBUG_HC_HCINTX_MASK_DEFAULT;
 }
 
 extern int hid_report_raw_event(struct hid_device *hid, int type, uint8_t *data, int size);
 
+/* wIndex of the interface requests, the interface being served */
+#define HID_ITF_NUMBER(phost) \
+  ((phost)->device.CfgDesc.Itf_Desc[(phost)->device.current_interface].bInterfaceNumber)
+
 // extern int hid_device_probe(USBH_HandleTypeDef *phost);
 
 static USBH_StatusTypeDef USBH_USBHID_Probe(USBH_HandleTypeDef *phost);
 static USBH_StatusTypeDef USBH_USBHID_Disconnect(USBH_HandleTypeDef *phost);
+static void USBH_HID_DecodeReport(HID_HandleTypeDef *HID_Handle, uint8_t *data, uint32_t length);
+static void USBH_HID_PrintAttach(HID_HandleTypeDef *HID_Handle);
+static void USBH_HID_InSubmit(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle);
+static void USBH_HID_InComplete(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle);
+static void USBH_HID_InDecode(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle);
+static void USBH_HID_DedupSetup(HID_HandleTypeDef *HID_Handle, struct hid_device *hiddev);
+static uint8_t USBH_HID_ReportChanged(HID_HandleTypeDef *HID_Handle, uint8_t *report, uint32_t length);
+static void USBH_HID_PrintDecodeStats(USBH_HandleTypeDef *phost);
+static void USBH_HID_PrintPollStats(USBH_HandleTypeDef *phost);
+static void USBH_HID_SetPoll(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle,
+    uint16_t poll);
 
 static USBH_StatusTypeDef USBH_HID_InterfaceInit(USBH_HandleTypeDef *phost);
 static USBH_StatusTypeDef USBH_HID_InterfaceDeInit(USBH_HandleTypeDef *phost);
 static USBH_StatusTypeDef USBH_HID_ClassRequest(USBH_HandleTypeDef *phost);
 static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost);
+static USBH_StatusTypeDef USBH_HID_ProcessInterface(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle);
+static void USBH_HID_OutputProcess(USBH_HandleTypeDef *phost, uint8_t control);
 static USBH_StatusTypeDef USBH_HID_SOFProcess(USBH_HandleTypeDef *phost);
 static void USBH_HID_ParseHIDDesc(HID_DescTypeDef *desc, uint8_t *buf);
+static USBH_StatusTypeDef USBH_HID_GetInterfaceDescriptor(USBH_HandleTypeDef *phost,
+    uint16_t value_idx, uint8_t *buff, uint16_t length);
+
+#if (USBH_HID_ARENA_SIZE > 0)
+/* hold the hid_device and its arena of each interface, see hid_allocate_device_in() */
+static uint64_t hid_arena_region[USBH_HID_MAX_INTERFACES][(USBH_HID_ARENA_SIZE + 7) / 8];
+#endif
 
 extern USBH_StatusTypeDef USBH_HID_MouseInit(USBH_HandleTypeDef *phost);
 extern USBH_StatusTypeDef USBH_HID_KeybdInit(USBH_HandleTypeDef *phost);
@@ -83,20 +110,172 @@ USBH_ClassTypeDef HID_Class =
     USBH_HID_ClassRequest, USBH_HID_Process, USBH_HID_SOFProcess,
     NULL };
 
+/**
+ * @brief  USBH_HID_OpenInterface
+ *         The function creates the handle of one HID interface and opens
+ *         its pipes.
+ * @param  phost: Host handle
+ * @param  interface: index in phost->device.CfgDesc.Itf_Desc
+ * @retval HID handle, NULL if the interface cannot be served
+ */
+static HID_HandleTypeDef *USBH_HID_OpenInterface(USBH_HandleTypeDef *phost, uint8_t interface)
+{
+  USBH_EpDescTypeDef *ep_in, *ep_out;
+  USBH_InterfaceDescTypeDef* itf_desc = &phost->device.CfgDesc.Itf_Desc[interface];
+  HID_HandleTypeDef *HID_Handle;
+
+  if ((ep_in = USBH_FindEndpoint(phost, interface, USB_EP_TYPE_INTR, USB_EP_DIR_IN)) == NULL)
+  {
+    USBH_UsrLog("HID interface #%d has no interrupt IN endpoint.", interface);
+    return NULL;
+  }
+  ep_out = USBH_FindEndpoint(phost, interface, USB_EP_TYPE_INTR, USB_EP_DIR_OUT);
+
+  // Create HID_Handle for the interface
+  HID_Handle = (HID_HandleTypeDef *) USBH_malloc(sizeof(HID_HandleTypeDef));
+  if (HID_Handle == NULL)
+  {
+    return NULL;
+  }
+  USBH_memset(HID_Handle, 0, sizeof(HID_HandleTypeDef));
+  HID_Handle->state = HID_ERROR;
+  HID_Handle->interface = interface;
+
+  /** init embedded hid_device **/
+  /** this struct is initialized when class_request **/
+  HID_Handle->hiddev = NULL;
+
+  HID_Handle->decode_start = phost->Timer;
+
+  /*Decode Boot class Protocol: Mouse or Keyboard*/
+  if (itf_desc->bInterfaceSubClass == HID_BOOT_CODE &&
+      itf_desc->bInterfaceProtocol == HID_KEYBRD_BOOT_CODE)
+  {
+    // Bootable HID Keyboard
+    USBH_UsrLog("HID interface #%d: bootable keyboard", interface);
+    HID_Handle->Init = USBH_HID_KeybdInit;
+  }
+  else if (itf_desc->bInterfaceSubClass == HID_BOOT_CODE &&
+      itf_desc->bInterfaceProtocol == HID_MOUSE_BOOT_CODE)
+  {
+    USBH_UsrLog("HID interface #%d: bootable mouse", interface);
+    HID_Handle->Init = USBH_HID_MouseInit;
+  }
+  else {  // non-boot device, or a boot protocol we do not know, read in report protocol
+    USBH_UsrLog("HID interface #%d: non-boot device", interface);
+    HID_Handle->Init = USBH_HID_NonBootKbdInit;
+  }
+
+  HID_Handle->state = HID_INIT;
+  HID_Handle->ctl_state = HID_REQ_INIT;
+  HID_Handle->ep_addr = ep_in->bEndpointAddress;
+  HID_Handle->length = ep_in->wMaxPacketSize;
+  HID_Handle->poll = ep_in->bInterval;
+
+  if (HID_Handle->poll < HID_MIN_POLL)
+  {
+    HID_Handle->poll = HID_MIN_POLL;
+  }
+
+  /* quiet devices are polled slow, a changed report switches to bInterval */
+  HID_Handle->poll_idle = HID_Handle->poll;
+  HID_Handle->poll_burst = ep_in->bInterval != 0 ? ep_in->bInterval : 1;
+#if (USBH_HID_BURST_HOLD == 0)
+  HID_Handle->poll_burst = HID_Handle->poll_idle;
+#endif
+  HID_Handle->mode_start = phost->Timer;
+  HID_Handle->timer = phost->Timer;
+  USBH_HID_QueueInit(&HID_Handle->in, HID_Handle->in_slot, USBH_HID_IN_SLOTS);
+
+  /* Open pipe for IN endpoint */
+  HID_Handle->InEp = ep_in->bEndpointAddress;
+  HID_Handle->InPipe = USBH_AllocPipe(phost, HID_Handle->InEp);
+  if (HID_Handle->InPipe == 0xFF)
+  {
+    USBH_ErrLog("HID interface #%d: no free pipe", interface);
+    free(HID_Handle);
+    return NULL;
+  }
+
+  USBH_OpenPipe(phost, HID_Handle->InPipe, HID_Handle->InEp,
+      phost->device.address, phost->device.speed,
+      USB_EP_TYPE_INTR, HID_Handle->length);
+
+  USBH_LL_SetToggle(phost, HID_Handle->InPipe, 0);
+
+  /* Open pipe for the optional OUT endpoint, reports also go by SET_REPORT */
+  HID_Handle->OutPipe = 0xFF;
+  if (ep_out != NULL)
+  {
+    HID_Handle->OutEp = ep_out->bEndpointAddress;
+    HID_Handle->OutLength = ep_out->wMaxPacketSize;
+    HID_Handle->OutPoll = ep_out->bInterval != 0 ? ep_out->bInterval : 1;
+    HID_Handle->OutPipe = USBH_AllocPipe(phost, HID_Handle->OutEp);
+  }
+
+  if (HID_Handle->OutPipe != 0xFF)
+  {
+    USBH_OpenPipe(phost, HID_Handle->OutPipe, HID_Handle->OutEp,
+        phost->device.address, phost->device.speed,
+        USB_EP_TYPE_INTR, HID_Handle->OutLength);
+
+    USBH_LL_SetToggle(phost, HID_Handle->OutPipe, 0);
+  }
+  else
+  {
+    HID_Handle->OutEp = 0;
+    HID_Handle->OutPipe = 0;
+    HID_Handle->OutLength = 0;
+  }
+
+  return HID_Handle;
+}
+
+/**
+ * @brief  USBH_HID_Select
+ *         The function makes a handle the one the class functions and the
+ *         interface requests work on.
+ * @param  phost: Host handle
+ * @param  index: handle index
+ * @retval HID handle
+ */
+static HID_HandleTypeDef *USBH_HID_Select(USBH_HandleTypeDef *phost, uint8_t index)
+{
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+
+  HID_Itfs->current = index;
+  phost->device.current_interface = HID_Itfs->itf[index]->interface;
+  return HID_Itfs->itf[index];
+}
+
+/**
+ * @brief  USBH_HID_GetHandle
+ *         The function returns the handle of the interface being served.
+ * @param  phost: Host handle
+ * @retval HID handle, NULL when the class is not active
+ */
+HID_HandleTypeDef *USBH_HID_GetHandle(USBH_HandleTypeDef *phost)
+{
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+
+  if (HID_Itfs == NULL || HID_Itfs->count == 0)
+  {
+    return NULL;
+  }
+  return HID_Itfs->itf[HID_Itfs->current];
+}
+
 /**
  * @brief  USBH_HID_InterfaceInit
- *         The function init the HID class.
+ *         The function init the HID class, one handle per HID interface.
  * @param  phost: Host handle
  * @retval USBH Status
  */
 static USBH_StatusTypeDef USBH_HID_InterfaceInit(USBH_HandleTypeDef *phost)
 {
-  uint8_t max_ep;
-  uint8_t num = 0;
   uint8_t interface;
-
   USBH_InterfaceDescTypeDef* itf_desc =  NULL;
-  USBH_StatusTypeDef status = USBH_FAIL;
+  HID_InterfacesTypeDef *HID_Itfs;
   HID_HandleTypeDef *HID_Handle;
 
   /*
@@ -107,123 +286,71 @@ static USBH_StatusTypeDef USBH_HID_InterfaceInit(USBH_HandleTypeDef *phost)
    * the original st hid class driver supports only boot device.
    *
    * for non-boot device, subclass code should be 0, according to Ch 4.3, this field (bInterfaceProtocol) should be 0.
+   *
+   * a composite scanner exposes keyboard, POS and configuration interfaces
+   * side by side, every one of them gets a handle.
    */
-
-  /* find boot device first */
-  interface = USBH_FindInterface(phost, phost->pActiveClass->ClassCode, HID_BOOT_CODE, 0xFF);
-
-  if (interface == 0xFF) {
-    /* find non-boot device second */
-    // interface = USBH_FindInterface(phost, phost->pActiveClass->ClassCode, 0xFF, 0xFF);
-    interface = USBH_FindInterface(phost, phost->pActiveClass->ClassCode, 0, 0);
+  HID_Itfs = (HID_InterfacesTypeDef *) USBH_malloc(sizeof(HID_InterfacesTypeDef));
+  if (HID_Itfs == NULL)
+  {
+    return USBH_FAIL;
   }
+  USBH_memset(HID_Itfs, 0, sizeof(HID_InterfacesTypeDef));
+  phost->pActiveClass->pData = HID_Itfs;
 
-  if (interface == 0xFF) /* No Valid Interface */
+  /* devices linux leaves to their own drivers are not HID devices to us either */
+  HID_Itfs->quirks = usbhid_lookup_quirk(phost->device.DevDesc.idVendor,
+      phost->device.DevDesc.idProduct);
+  if ((HID_Itfs->quirks & (HID_QUIRK_IGNORE | HID_QUIRK_NO_IGNORE)) == HID_QUIRK_IGNORE)
   {
-    status = USBH_FAIL;
-    USBH_DbgLog("Cannot Find the interface for %s class.",
-        phost->pActiveClass->Name);
+    USBH_UsrLog("HID: device %04x:%04x ignored",
+        phost->device.DevDesc.idVendor, phost->device.DevDesc.idProduct);
+    free(HID_Itfs);
+    phost->pActiveClass->pData = NULL;
+    return USBH_NOT_SUPPORTED;
   }
-  else
-  {
-    USBH_SelectInterface(phost, interface);
-
-    // Create HID_Handle for Class_Handle
-    phost->pActiveClass->pData = (HID_HandleTypeDef *) USBH_malloc(sizeof(HID_HandleTypeDef));
-    HID_Handle = phost->pActiveClass->pData;
-    HID_Handle->state = HID_ERROR;
-
-    /** init embedded hid_device **/
-    /** this struct is initialized when class_request **/
-    HID_Handle->hiddev = NULL;
-
-    /*Decode Boot class Protocol: Mouse or Keyboard*/
-    itf_desc = &phost->device.CfgDesc.Itf_Desc[phost->device.current_interface];
 
-    if (itf_desc->bInterfaceSubClass == HID_BOOT_CODE) {
-      if (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].bInterfaceProtocol
-          == HID_KEYBRD_BOOT_CODE)
-      {
-        // Bootable HID Keyboard
-        USBH_UsrLog("Bootable HID KeyBoard found!");
-        HID_Handle->Init = USBH_HID_KeybdInit;
-      }
-      else if (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].bInterfaceProtocol
-          == HID_MOUSE_BOOT_CODE)
-      {
-        USBH_UsrLog("Bootable HID Mouse found!");
-        HID_Handle->Init = USBH_HID_MouseInit;
-      }
-      else
-      {
-        USBH_UsrLog("Bootable Device found but protocol not supported.");
-        return USBH_FAIL;
-      }
-    }
-    else {  // non-boot device, not sure if it is a keyboard
-      USBH_UsrLog("Non-boot device found!");
-      HID_Handle->Init = USBH_HID_NonBootKbdInit;
+  for (interface = 0; interface < phost->device.CfgDesc.Index.nb_itf; interface++)
+  {
+    itf_desc = &phost->device.CfgDesc.Itf_Desc[interface];
+    if (itf_desc->bInterfaceClass != phost->pActiveClass->ClassCode ||
+        itf_desc->bAlternateSetting != 0)
+    {
+      continue;
     }
 
-    HID_Handle->state = HID_INIT;
-    HID_Handle->ctl_state = HID_REQ_INIT;
-    HID_Handle->ep_addr =
-        phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].bEndpointAddress;
-    HID_Handle->length =
-        phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].wMaxPacketSize;
-    HID_Handle->poll =
-        phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].bInterval;
-
-    if (HID_Handle->poll < HID_MIN_POLL)
+    if ((HID_Itfs->quirks & HID_QUIRK_IGNORE_MOUSE) &&
+        itf_desc->bInterfaceProtocol == HID_MOUSE_BOOT_CODE)
     {
-      HID_Handle->poll = HID_MIN_POLL;
+      USBH_UsrLog("HID interface #%d ignored, mouse of a device with its own driver.", interface);
+      continue;
     }
 
-    /* Check fo available number of endpoints */
-    /* Find the number of EPs in the Interface Descriptor */
-    /* Choose the lower number in order not to overrun the buffer allocated */
-    max_ep =
-        ((phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].bNumEndpoints
-            <= USBH_MAX_NUM_ENDPOINTS) ?
-            phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].bNumEndpoints :
-            USBH_MAX_NUM_ENDPOINTS);
-
-    /* Decode endpoint IN and OUT address from interface descriptor */
-    for (; num < max_ep; num++)
+    if (HID_Itfs->count == USBH_HID_MAX_INTERFACES)
     {
-      if (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[num].bEndpointAddress
-          & 0x80)
-      {
-        HID_Handle->InEp =
-            (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[num].bEndpointAddress);
-        HID_Handle->InPipe = USBH_AllocPipe(phost, HID_Handle->InEp);
-
-        /* Open pipe for IN endpoint */
-        USBH_OpenPipe(phost, HID_Handle->InPipe, HID_Handle->InEp,
-            phost->device.address, phost->device.speed,
-            USB_EP_TYPE_INTR, HID_Handle->length);
-
-        USBH_LL_SetToggle(phost, HID_Handle->InPipe, 0);
-
-      }
-      else
-      {
-        HID_Handle->OutEp =
-            (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[num].bEndpointAddress);
-        HID_Handle->OutPipe = USBH_AllocPipe(phost, HID_Handle->OutEp);
-
-        /* Open pipe for OUT endpoint */
-        USBH_OpenPipe(phost, HID_Handle->OutPipe, HID_Handle->OutEp,
-            phost->device.address, phost->device.speed,
-            USB_EP_TYPE_INTR, HID_Handle->length);
-
-        USBH_LL_SetToggle(phost, HID_Handle->OutPipe, 0);
-      }
+      USBH_UsrLog("HID interface #%d ignored, USBH_HID_MAX_INTERFACES reached.", interface);
+      continue;
+    }
 
+    HID_Handle = USBH_HID_OpenInterface(phost, interface);
+    if (HID_Handle != NULL)
+    {
+      HID_Itfs->itf[HID_Itfs->count++] = HID_Handle;
     }
-    status = USBH_OK;
   }
-  return status;
+
+  if (HID_Itfs->count == 0) /* No Valid Interface */
+  {
+    USBH_DbgLog("Cannot Find the interface for %s class.",
+        phost->pActiveClass->Name);
+    free(HID_Itfs);
+    phost->pActiveClass->pData = NULL;
+    return USBH_FAIL;
+  }
+
+  USBH_UsrLog("HID: %d interfaces", HID_Itfs->count);
+  USBH_HID_Select(phost, 0);
+  return USBH_OK;
 }
 
 /**
@@ -234,49 +361,60 @@ static USBH_StatusTypeDef USBH_HID_InterfaceInit(USBH_HandleTypeDef *phost)
  */
 USBH_StatusTypeDef USBH_HID_InterfaceDeInit(USBH_HandleTypeDef *phost)
 {
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle;
+  uint8_t i;
 
   USBH_UsrLog("%s", __func__);
 
-  USBH_USBHID_Disconnect(phost);
-
-
-  if (HID_Handle->InPipe != 0x00)
+  if (HID_Itfs == NULL)
   {
-    /*
-     * restore debug default
-     */
-    unsupress_in_pipe_debug_print(HID_Handle->InPipe);
-
-    USBH_ClosePipe(phost, HID_Handle->InPipe);
-    USBH_FreePipe(phost, HID_Handle->InPipe);
-    HID_Handle->InPipe = 0; /* Reset the pipe as Free */
+    return USBH_OK;
   }
 
-  if (HID_Handle->OutPipe != 0x00)
-  {
-    USBH_ClosePipe(phost, HID_Handle->OutPipe);
-    USBH_FreePipe(phost, HID_Handle->OutPipe);
-    HID_Handle->OutPipe = 0; /* Reset the pipe as Free */
-  }
+  USBH_HID_PrintDecodeStats(phost);
+  USBH_HID_PrintPollStats(phost);
 
-  if (phost->pActiveClass->pData)
+  for (i = 0; i < HID_Itfs->count; i++)
   {
-    HID_HandleTypeDef *HID_Handle = (HID_HandleTypeDef*)phost->pActiveClass->pData;
+    HID_Handle = USBH_HID_Select(phost, i);
 
-    if (HID_Handle) {
-//  bug: this device is already freed in Disconnect
-//      if (HID_Handle->hiddev) {
-//        free(HID_Handle->hiddev);
-//        HID_Handle->hiddev = NULL;
-//      }
+    USBH_USBHID_Disconnect(phost);
 
-      // USBH_free(phost->pActiveClass->pData);
-      free(HID_Handle);
-      phost->pActiveClass->pData = NULL;
+    if (HID_Handle->InPipe != 0x00)
+    {
+      /*
+       * restore debug default
+       */
+      unsupress_in_pipe_debug_print();
+
+      USBH_ClosePipe(phost, HID_Handle->InPipe);
+      USBH_FreePipe(phost, HID_Handle->InPipe);
+      HID_Handle->InPipe = 0; /* Reset the pipe as Free */
     }
+
+    if (HID_Handle->OutPipe != 0x00)
+    {
+      USBH_ClosePipe(phost, HID_Handle->OutPipe);
+      USBH_FreePipe(phost, HID_Handle->OutPipe);
+      HID_Handle->OutPipe = 0; /* Reset the pipe as Free */
+    }
+
+    free(HID_Handle);
+    HID_Itfs->itf[i] = NULL;
   }
 
+#if (USBH_HID_SCAN_ASSEMBLER == 1)
+  USBH_HID_ScanStop();
+#endif
+#if (USBH_HID_MOTION_INTERVAL > 0)
+  USBH_HID_MotionStop();
+#endif
+
+  // USBH_free(phost->pActiveClass->pData);
+  free(HID_Itfs);
+  phost->pActiveClass->pData = NULL;
+
   debug_hal_hcd_hc_submitrequest_print = DEBUG_HAL_HCD_HC_SUBMITREQUEST_DEFAULT;
 
   return USBH_OK;
@@ -308,12 +446,18 @@ static USBH_StatusTypeDef USBH_HID_ClassRequest(USBH_HandleTypeDef *phost)
 
   USBH_StatusTypeDef status = USBH_BUSY;
   USBH_StatusTypeDef classReqStatus = USBH_BUSY;
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle = USBH_HID_GetHandle(phost);
 
   /* Switch HID state machine */
   switch (HID_Handle->ctl_state)
   {
   case HID_REQ_INIT:
+    HID_Handle->attach_tick = HAL_GetTick();
+    HID_Handle->attach_cycles = DWT->CYCCNT;
+    HID_Handle->ctl_state = HID_REQ_GET_HID_DESC;
+    /* no break */
+
   case HID_REQ_GET_HID_DESC:
 
     /* Get HID Desc */
@@ -359,7 +503,7 @@ static USBH_StatusTypeDef USBH_HID_ClassRequest(USBH_HandleTypeDef *phost)
   case HID_REQ_SET_IDLE:
 
     // return USBH_FAIL;
-    classReqStatus = USBH_HID_SetIdle(phost, 0, 0);
+    classReqStatus = USBH_HID_SetIdle(phost, USBH_HID_IDLE_RATE, 0);
 
     /* set Idle */
     if (classReqStatus == USBH_OK)
@@ -373,13 +517,22 @@ static USBH_StatusTypeDef USBH_HID_ClassRequest(USBH_HandleTypeDef *phost)
     break;
 
   case HID_REQ_SET_PROTOCOL:
-    /* set protocol */
-    if (USBH_HID_SetProtocol(phost, 0) == USBH_OK)
+    /* set protocol, optional for non-boot interfaces */
+    classReqStatus = USBH_HID_SetProtocol(phost, 0);
+    if (classReqStatus == USBH_OK || classReqStatus == USBH_NOT_SUPPORTED)
     {
       HID_Handle->ctl_state = HID_REQ_IDLE;
 
+      /* the next interface runs the same requests */
+      if (HID_Itfs->current + 1 < HID_Itfs->count)
+      {
+        USBH_HID_Select(phost, HID_Itfs->current + 1);
+        break;
+      }
+      USBH_HID_Select(phost, 0);
+
       /* suppress periodical debug print */
-      suppress_in_pipe_debug_print(HID_Handle->InPipe);
+      suppress_in_pipe_debug_print();
 
       /* all requests performed*/
       phost->pUser(phost, HOST_USER_CLASS_ACTIVE);
@@ -397,38 +550,60 @@ static USBH_StatusTypeDef USBH_HID_ClassRequest(USBH_HandleTypeDef *phost)
 
 /**
  * @brief  USBH_HID_Process
- *         The function is for managing state machine for HID data transfers
+ *         The function runs the data transfer state machine of every
+ *         HID interface.
  * @param  phost: Host handle
  * @retval USBH Status
  */
+static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
+{
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle;
+  uint8_t control = (HID_Itfs->out_state == HID_OUT_CONTROL);
+  uint8_t starting = 0;
+  uint8_t i;
 
-static int need_report(uint8_t* report, int size) {
-
-  static int previous_zero = 1;
-  int i;
+  for (i = 0; i < HID_Itfs->count; i++)
+  {
+    HID_Handle = HID_Itfs->itf[i];
 
-  for (i = 0; i < size; i++) {
-    if (report[i] != 0) {
-      previous_zero = 0;
-      return 1; // should report
+    /* back off once the device has been quiet for the hold time */
+    if (HID_Handle->poll != HID_Handle->poll_idle &&
+        (phost->Timer - HID_Handle->last_data) >= USBH_HID_BURST_HOLD)
+    {
+      USBH_HID_SetPoll(phost, HID_Handle, HID_Handle->poll_idle);
     }
-  }
 
-  if (previous_zero != 1) {
+    /* the control pipe is shared, one interface at a time gets its first report */
+    if (HID_Handle->state == HID_INIT || HID_Handle->state == HID_IDLE)
+      starting = 1;
+    if (HID_Handle->state == HID_IDLE)
+    {
+      if (control)
+        continue;
+      control = 1;
+    }
 
-    // USBH_UsrLog("Zero report");
-    previous_zero = 1;
-    return 1;
+    USBH_HID_Select(phost, i);
+    USBH_HID_ProcessInterface(phost, HID_Handle);
   }
 
-  return 0;
+  /* output reports wait until every interface got its first report */
+  USBH_HID_OutputProcess(phost, starting);
+  return USBH_OK;
 }
 
-static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
+/**
+ * @brief  USBH_HID_ProcessInterface
+ *         The function is for managing state machine for HID data transfers
+ * @param  phost: Host handle
+ * @param  HID_Handle: handle of the interface
+ * @retval USBH Status
+ */
+static USBH_StatusTypeDef USBH_HID_ProcessInterface(USBH_HandleTypeDef *phost,
+    HID_HandleTypeDef *HID_Handle)
 {
   USBH_StatusTypeDef status = USBH_OK;
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
-  uint32_t xfer_count;
 
   switch (HID_Handle->state)
   {
@@ -439,12 +614,19 @@ static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
     break;
 
   case HID_IDLE:
-    if (USBH_HID_GetReport(phost, 0x01, 0, HID_Handle->pData,
-        HID_Handle->length) == USBH_OK)
+    /* GET_REPORT is optional, a stall must not keep the interface from polling */
+    status = USBH_HID_GetReport(phost, 0x01, 0, HID_Handle->pData,
+        HID_Handle->length);
+    if (status == USBH_OK)
     {
       USBH_UsrLog("HID_GetReport return USBH_OK.")
-      fifo_write(&HID_Handle->fifo, HID_Handle->pData, HID_Handle->length);
+      USBH_HID_QueueWrite(&HID_Handle->fifo, 0, phost->Timer, HID_Handle->pData,
+          HID_Handle->length);
+    }
+    if (status != USBH_BUSY)
+    {
       HID_Handle->state = HID_SYNC;
+      status = USBH_OK;
     }
 
     break;
@@ -464,18 +646,33 @@ static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
 
   case HID_GET_DATA:
 
-    USBH_InterruptReceiveData(phost, HID_Handle->pData, HID_Handle->length,
-        HID_Handle->InPipe);
+    /*
+     * a report that landed just before the poll timer fired is kept. the
+     * URB state of a reused channel reads DONE until the first submit, so
+     * only an IN this handle has in flight counts.
+     */
+    if (HID_Handle->in_flight &&
+        USBH_LL_GetURBState(phost, HID_Handle->InPipe) == USBH_URB_DONE)
+    {
+      HID_Handle->DataReady = 1;
+      USBH_HID_InComplete(phost, HID_Handle);
+      break;
+    }
 
-    HID_Handle->state = HID_POLL;
-    HID_Handle->timer = phost->Timer;
-    HID_Handle->DataReady = 0;
+    USBH_HID_InSubmit(phost, HID_Handle);
     // This prints every 10ms almost.
     // USBH_UsrLog("Urb submitted. Go to HID_POLL.");
     break;
 
   case HID_POLL:
 
+#if (USBH_HID_SCAN_ASSEMBLER == 1)
+    USBH_HID_ScanPoll();
+#endif
+#if (USBH_HID_MOTION_INTERVAL > 0)
+    USBH_HID_MotionPoll();
+#endif
+
     if (USBH_LL_GetURBState(phost, HID_Handle->InPipe) == USBH_URB_DONE)
     {
       if (HID_Handle->DataReady == 0)
@@ -483,18 +680,8 @@ static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
 
         // for USB rfid reader in Marlin's case, this prints every 30ms.
         // USBH_UsrLog("Urb done. Data is ready.");
-        xfer_count = USBH_LL_GetLastXferSize(phost, HID_Handle->InPipe);
-
-        if (need_report(HID_Handle->pData, xfer_count)) {
-          USBH_UsrLog("in xfered bytes: %d", (int)xfer_count);
-          // hid_input_report(&device, HID_INPUT_REPORT, HID_Handle->pData, xfer_count, 1);
-          // hid_report_raw_event(&device, 0 /* HID_INPUT_REPORT */ , HID_Handle->pData, xfer_count);
-          // TODO temporarily disable report processing
-          // hid_report_raw_event(HID_Handle->hiddev, HID_INPUT_REPORT, HID_Handle->pData, xfer_count);
-        }
-
-        // fifo_write(&HID_Handle->fifo, HID_Handle->pData, HID_Handle->length);
         HID_Handle->DataReady = 1;
+        USBH_HID_InComplete(phost, HID_Handle);
 
         // USBH_UsrLog(":: 0x%02x 0x%02x", HID_Handle->pData[0], HID_Handle->pData[1]);
         // USBH_HID_EventCallback(phost);
@@ -520,9 +707,104 @@ static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
   default:
     break;
   }
+
+  /* the next IN is already armed, decode what arrived meanwhile */
+  USBH_HID_InDecode(phost, HID_Handle);
   return status;
 }
 
+/**
+ * @brief  USBH_HID_InSubmit
+ *         The function arms the interrupt IN pipe on the free slot.
+ * @param  phost: Host handle
+ * @param  HID_Handle: HID handle
+ * @retval None
+ */
+static void USBH_HID_InSubmit(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle)
+{
+  USBH_RearmReceiveData(phost, USBH_HID_QueueBack(&HID_Handle->in)->data,
+      HID_Handle->length, HID_Handle->InPipe);
+
+  HID_Handle->state = HID_POLL;
+  HID_Handle->poll_prev = HID_Handle->timer;
+  HID_Handle->timer = phost->Timer;
+  HID_Handle->mode_polls[HID_Handle->poll != HID_Handle->poll_idle]++;
+  HID_Handle->DataReady = 0;
+  HID_Handle->in_flight = 1;
+}
+
+/**
+ * @brief  USBH_HID_InComplete
+ *         The function queues the slot the pipe has just filled and arms
+ *         the pipe on the next one, at once if the poll interval has
+ *         already elapsed, so decoding never delays the next IN.
+ * @param  phost: Host handle
+ * @param  HID_Handle: HID handle
+ * @retval None
+ */
+static void USBH_HID_InComplete(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle)
+{
+  HID_RecordTypeDef *slot = USBH_HID_QueueBack(&HID_Handle->in);
+
+  HID_Handle->in_flight = 0;
+  slot->time = USBH_LL_GetURBTime(phost, HID_Handle->InPipe);
+  slot->length = USBH_LL_GetLastXferSize(phost, HID_Handle->InPipe);
+  slot->id = HID_Handle->hiddev != NULL && slot->length != 0 &&
+      HID_Handle->hiddev->report_enum[HID_INPUT_REPORT].numbered ? slot->data[0] : 0;
+
+  /* full, the slot is filled again */
+  if (!USBH_HID_QueuePush(&HID_Handle->in))
+  {
+    HID_Handle->in_overrun++;
+  }
+
+  if ((phost->Timer - HID_Handle->timer) >= HID_Handle->poll)
+  {
+    USBH_HID_InSubmit(phost, HID_Handle);
+  }
+}
+
+/**
+ * @brief  USBH_HID_InDecode
+ *         The function decodes the queued reports, oldest first.
+ * @param  phost: Host handle
+ * @param  HID_Handle: HID handle
+ * @retval None
+ */
+static void USBH_HID_InDecode(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle)
+{
+  HID_RecordTypeDef *slot;
+  uint32_t wait;
+
+  while ((slot = USBH_HID_QueueFront(&HID_Handle->in)) != NULL)
+  {
+
+    if (USBH_HID_ReportChanged(HID_Handle, slot->data, slot->length)) {
+      /* repeats do not hold the burst, a device ignoring SET_IDLE falls back too */
+      HID_Handle->last_data = slot->time;
+      if (HID_Handle->poll != HID_Handle->poll_burst)
+      {
+        /* the report was ready at most one interval before its IN request */
+        wait = slot->time - HID_Handle->poll_prev;
+
+        HID_Handle->burst_count++;
+        HID_Handle->first_sum += wait;
+        if (wait > HID_Handle->first_max)
+          HID_Handle->first_max = wait;
+        USBH_HID_SetPoll(phost, HID_Handle, HID_Handle->poll_burst);
+      }
+      /* boot reports also go to USBH_HID_GetKeybdInfo() and USBH_HID_GetMouseInfo() */
+      if (HID_Handle->Init == USBH_HID_KeybdInit || HID_Handle->Init == USBH_HID_MouseInit)
+        USBH_HID_QueueWrite(&HID_Handle->fifo, slot->id, slot->time, slot->data, slot->length);
+      if (HID_Handle->hiddev) {
+        USBH_HID_DecodeReport(HID_Handle, slot->data, slot->length);
+      }
+    }
+
+    USBH_HID_QueuePop(&HID_Handle->in);
+  }
+}
+
 /**
  * @brief  USBH_HID_SOFProcess
  *         The function is for managing the SOF Process
@@ -531,18 +813,26 @@ static USBH_StatusTypeDef USBH_HID_Process(USBH_HandleTypeDef *phost)
  */
 static USBH_StatusTypeDef USBH_HID_SOFProcess(USBH_HandleTypeDef *phost)
 {
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle;
+  uint8_t i;
 
-  if (HID_Handle->state == HID_POLL)
+  /* every interface keeps its own bInterval, USBH_HID_Process() switches it */
+  for (i = 0; i < HID_Itfs->count; i++)
   {
-    if ((phost->Timer - HID_Handle->timer) >= HID_Handle->poll)
+    HID_Handle = HID_Itfs->itf[i];
+
+    if (HID_Handle->state == HID_POLL)
     {
-      HID_Handle->state = HID_GET_DATA;
-      // This prints once every 10ms, almost.
-      // USBH_UsrLog("HID_POLLING time out. Go to GET_DATA.");
+      if ((phost->Timer - HID_Handle->timer) >= HID_Handle->poll)
+      {
+        HID_Handle->state = HID_GET_DATA;
+        // This prints once every 10ms, almost.
+        // USBH_UsrLog("HID_POLLING time out. Go to GET_DATA.");
 #if (USBH_USE_OS == 1)
-      osMessagePut ( phost->os_event, USBH_URB_EVENT, 0);
+        osMessagePut ( phost->os_event, USBH_URB_EVENT, 0);
 #endif       
+      }
     }
   }
   return USBH_OK;
@@ -562,8 +852,7 @@ USBH_StatusTypeDef USBH_HID_GetHIDReportDescriptor(USBH_HandleTypeDef *phost,
 
   USBH_StatusTypeDef status;
 
-  status = USBH_GetDescriptor(phost,
-  USB_REQ_RECIPIENT_INTERFACE | USB_REQ_TYPE_STANDARD,
+  status = USBH_HID_GetInterfaceDescriptor(phost,
   USB_DESC_HID_REPORT, phost->device.Data, length);
 
   /* HID report descriptor is available in phost->device.Data.
@@ -589,13 +878,37 @@ USBH_StatusTypeDef USBH_HID_GetHIDDescriptor(USBH_HandleTypeDef *phost,
 
   USBH_StatusTypeDef status;
 
-  status = USBH_GetDescriptor(phost,
-  USB_REQ_RECIPIENT_INTERFACE | USB_REQ_TYPE_STANDARD,
+  status = USBH_HID_GetInterfaceDescriptor(phost,
   USB_DESC_HID, phost->device.Data, length);
 
   return status;
 }
 
+/**
+ * @brief  USBH_HID_GetInterfaceDescriptor
+ *         Issue a standard GetDescriptor request to the interface being
+ *         served, USBH_GetDescriptor() always addresses interface 0.
+ * @param  phost: Host handle
+ * @param  value_idx: descriptor type and index
+ * @param  buff: buffer for the descriptor
+ * @param  length: descriptor length
+ * @retval USBH Status
+ */
+static USBH_StatusTypeDef USBH_HID_GetInterfaceDescriptor(USBH_HandleTypeDef *phost,
+    uint16_t value_idx, uint8_t *buff, uint16_t length)
+{
+  if (phost->RequestState == CMD_SEND)
+  {
+    phost->Control.setup.b.bmRequestType = USB_D2H | USB_REQ_RECIPIENT_INTERFACE
+        | USB_REQ_TYPE_STANDARD;
+    phost->Control.setup.b.bRequest = USB_REQ_GET_DESCRIPTOR;
+    phost->Control.setup.b.wValue.w = value_idx;
+    phost->Control.setup.b.wIndex.w = HID_ITF_NUMBER(phost);
+    phost->Control.setup.b.wLength.w = length;
+  }
+  return USBH_CtlReq(phost, buff, length);
+}
+
 /**
  * @brief  USBH_Set_Idle
  *         Set Idle State.
@@ -615,7 +928,7 @@ USBH_StatusTypeDef USBH_HID_SetIdle(USBH_HandleTypeDef *phost, uint8_t duration,
   phost->Control.setup.b.bRequest = USB_HID_SET_IDLE;
   phost->Control.setup.b.wValue.w = (duration << 8) | reportId;
 
-  phost->Control.setup.b.wIndex.w = 0;
+  phost->Control.setup.b.wIndex.w = HID_ITF_NUMBER(phost);
   phost->Control.setup.b.wLength.w = 0;
 
   return USBH_CtlReq(phost, 0, 0);
@@ -641,7 +954,7 @@ USBH_StatusTypeDef USBH_HID_SetReport(USBH_HandleTypeDef *phost,
   phost->Control.setup.b.bRequest = USB_HID_SET_REPORT;
   phost->Control.setup.b.wValue.w = (reportType << 8) | reportId;
 
-  phost->Control.setup.b.wIndex.w = 0;
+  phost->Control.setup.b.wIndex.w = HID_ITF_NUMBER(phost);
   phost->Control.setup.b.wLength.w = reportLen;
 
   return USBH_CtlReq(phost, reportBuff, reportLen);
@@ -666,7 +979,7 @@ USBH_StatusTypeDef USBH_HID_GetReport(USBH_HandleTypeDef *phost,
   phost->Control.setup.b.bRequest = USB_HID_GET_REPORT;
   phost->Control.setup.b.wValue.w = (reportType << 8) | reportId;
 
-  phost->Control.setup.b.wIndex.w = 0;
+  phost->Control.setup.b.wIndex.w = HID_ITF_NUMBER(phost);
   phost->Control.setup.b.wLength.w = reportLen;
 
   return USBH_CtlReq(phost, reportBuff, reportLen);
@@ -687,7 +1000,7 @@ USBH_StatusTypeDef USBH_HID_SetProtocol(USBH_HandleTypeDef *phost,
 
   phost->Control.setup.b.bRequest = USB_HID_SET_PROTOCOL;
   phost->Control.setup.b.wValue.w = protocol != 0 ? 0 : 1;
-  phost->Control.setup.b.wIndex.w = 0;
+  phost->Control.setup.b.wIndex.w = HID_ITF_NUMBER(phost);
   phost->Control.setup.b.wLength.w = 0;
 
   return USBH_CtlReq(phost, 0, 0);
@@ -750,7 +1063,7 @@ HID_TypeTypeDef USBH_HID_GetDeviceType(USBH_HandleTypeDef *phost)
  */
 uint8_t USBH_HID_GetPollInterval(USBH_HandleTypeDef *phost)
 {
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle = USBH_HID_GetHandle(phost);
 
   if ((phost->gState == HOST_CLASS_REQUEST) || (phost->gState == HOST_INPUT)
       || (phost->gState == HOST_SET_CONFIGURATION)
@@ -764,98 +1077,136 @@ uint8_t USBH_HID_GetPollInterval(USBH_HandleTypeDef *phost)
   }
 }
 /**
- * @brief  fifo_init
- *         Initialize FIFO.
- * @param  f: Fifo address
- * @param  buf: Fifo buffer
- * @param  size: Fifo Size
+ * @brief  USBH_HID_QueueInit
+ *         Initialize a report queue. It holds size - 1 reports, the
+ *         remaining slot is the one the producer fills.
+ * @param  q: queue
+ * @param  slot: slot array
+ * @param  size: number of slots, at least 2
  * @retval none
  */
-void fifo_init(FIFO_TypeDef * f, uint8_t * buf, uint16_t size)
+void USBH_HID_QueueInit(HID_QueueTypeDef *q, HID_RecordTypeDef *slot, uint8_t size)
 {
-  f->head = 0;
-  f->tail = 0;
-  f->lock = 0;
-  f->size = size;
-  f->buf = buf;
+  q->slot = slot;
+  q->size = size;
+  q->head = 0;
+  q->tail = 0;
 }
 
 /**
- * @brief  fifo_read
- *         Read from FIFO.
- * @param  f: Fifo address
- * @param  buf: read buffer
- * @param  nbytes: number of item to read
- * @retval number of read items
+ * @brief  USBH_HID_QueueBack
+ *         Producer side, the slot to fill. It belongs to the producer
+ *         until USBH_HID_QueuePush() hands it over.
+ * @param  q: queue
+ * @retval slot
  */
-uint16_t fifo_read(FIFO_TypeDef * f, void * buf, uint16_t nbytes)
+HID_RecordTypeDef *USBH_HID_QueueBack(HID_QueueTypeDef *q)
 {
-  uint16_t i;
-  uint8_t * p;
-  p = buf;
+  return &q->slot[q->head];
+}
 
-  if (f->lock == 0)
+/**
+ * @brief  USBH_HID_QueuePush
+ *         Producer side, hand the filled slot over to the consumer.
+ * @param  q: queue
+ * @retval 1, 0 if the queue is full and the slot stays with the producer
+ */
+uint8_t USBH_HID_QueuePush(HID_QueueTypeDef *q)
+{
+  uint8_t next = (q->head + 1) % q->size;
+
+  if (next == q->tail)
   {
-    f->lock = 1;
-    for (i = 0; i < nbytes; i++)
-    {
-      if (f->tail != f->head)
-      {
-        *p++ = f->buf[f->tail];
-        f->tail++;
-        if (f->tail == f->size)
-        {
-          f->tail = 0;
-        }
-      }
-      else
-      {
-        f->lock = 0;
-        return i;
-      }
-    }
+    return 0;
   }
-  f->lock = 0;
-  return nbytes;
+
+  /* the record is complete before the consumer can see it */
+  __DMB();
+  q->head = next;
+  return 1;
 }
 
 /**
- * @brief  fifo_write
- *         Read from FIFO.
- * @param  f: Fifo address
+ * @brief  USBH_HID_QueueFront
+ *         Consumer side, the oldest report. It stays valid until
+ *         USBH_HID_QueuePop().
+ * @param  q: queue
+ * @retval slot, NULL if the queue is empty
+ */
+HID_RecordTypeDef *USBH_HID_QueueFront(HID_QueueTypeDef *q)
+{
+  if (q->tail == q->head)
+  {
+    return NULL;
+  }
+
+  /* read the record only after seeing it published */
+  __DMB();
+  return &q->slot[q->tail];
+}
+
+/**
+ * @brief  USBH_HID_QueuePop
+ *         Consumer side, give the oldest slot back to the producer.
+ * @param  q: queue
+ * @retval none
+ */
+void USBH_HID_QueuePop(HID_QueueTypeDef *q)
+{
+  /* done with the record before the producer may refill it */
+  __DMB();
+  q->tail = (q->tail + 1) % q->size;
+}
+
+/**
+ * @brief  USBH_HID_QueueWrite
+ *         Producer side, queue a copy of a report.
+ * @param  q: queue
+ * @param  id: report ID, 0 if the device numbers none
+ * @param  time: phost->Timer when it arrived
+ * @param  data: report
+ * @param  length: report length, at most HID_PACKET_SIZE
+ * @retval length, 0 if the queue is full or the report too long
+ */
+uint16_t USBH_HID_QueueWrite(HID_QueueTypeDef *q, uint8_t id, uint32_t time,
+    const void *data, uint16_t length)
+{
+  HID_RecordTypeDef *r = USBH_HID_QueueBack(q);
+
+  if (length > sizeof(r->data))
+  {
+    return 0;
+  }
+
+  r->time = time;
+  r->id = id;
+  r->length = length;
+  USBH_memcpy(r->data, data, length);
+  return USBH_HID_QueuePush(q) ? length : 0;
+}
+
+/**
+ * @brief  USBH_HID_QueueRead
+ *         Consumer side, copy out and remove the oldest report.
+ * @param  q: queue
  * @param  buf: read buffer
- * @param  nbytes: number of item to write
- * @retval number of written items
+ * @param  size: buffer size, a longer report is cut
+ * @retval report length, 0 if the queue is empty
  */
-uint16_t fifo_write(FIFO_TypeDef * f, const void * buf, uint16_t nbytes)
+uint16_t USBH_HID_QueueRead(HID_QueueTypeDef *q, void *buf, uint16_t size)
 {
-  uint16_t i;
-  const uint8_t * p;
-  p = buf;
-  if (f->lock == 0)
+  HID_RecordTypeDef *r = USBH_HID_QueueFront(q);
+  uint16_t length;
+
+  if (r == NULL)
   {
-    f->lock = 1;
-    for (i = 0; i < nbytes; i++)
-    {
-      if ((f->head + 1 == f->tail)
-          || ((f->head + 1 == f->size) && (f->tail == 0)))
-      {
-        f->lock = 0;
-        return i;
-      }
-      else
-      {
-        f->buf[f->head] = *p++;
-        f->head++;
-        if (f->head == f->size)
-        {
-          f->head = 0;
-        }
-      }
-    }
+    return 0;
   }
-  f->lock = 0;
-  return nbytes;
+
+  length = r->length;
+  USBH_memcpy(buf, r->data, length < size ? length : size);
+  USBH_HID_QueuePop(q);
+  return length;
 }
 
 /**
@@ -904,12 +1255,24 @@ static USBH_StatusTypeDef USBH_USBHID_Probe(USBH_HandleTypeDef *phost)
 {
   int ret = 0;
   struct hid_device* hiddev;
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle = USBH_HID_GetHandle(phost);
+  USBH_StatusTypeDef pos;
+  HID_CACHE_KeyTypeDef key;
+  uint32_t cycles = DWT->CYCCNT;
 
   /* The descriptor is available in phost->device.Data */
   uint8_t *rdesc = phost->device.Data;
   uint16_t rsize = HID_Handle->HID_Desc.wItemLength;
 
+#if (USBH_HID_ARENA_SIZE > 0)
+  void *region = hid_arena_region[HID_Itfs->current];
+  size_t size = sizeof(hid_arena_region[0]);
+#else
+  void *region = NULL;
+  size_t size = 0;
+#endif
+
   /* print raw data of report descriptor */
 //  USBH_UsrLog("HID: Print raw data of HID report descriptor.");
 //
@@ -919,49 +1282,555 @@ static USBH_StatusTypeDef USBH_USBHID_Probe(USBH_HandleTypeDef *phost)
 //    USBH_UsrLog(" - 0x%02x", phost->device.Data[i]);
 //  }
 
-  hiddev = hid_allocate_device();
+  /* a device seen before comes back parsed, connected and compiled */
+  USBH_HID_CacheKey(phost, rdesc, rsize, &key);
+  hiddev = USBH_HID_CacheLoad(&key, region, size);
+  HID_Handle->attach_cached = hiddev != NULL;
 
   if (hiddev == NULL)
-    goto fail;
-
-  ret = hid_set_report_descriptor(hiddev, rdesc, rsize);
-  if (ret)
-    goto fail;
-
-  ret = hid_open_report(hiddev);
-  if (ret)
-    goto fail;
+  {
+    hiddev = region ? hid_allocate_device_in(region, size) : hid_allocate_device();
+    if (hiddev == NULL)
+      goto fail;
+    hiddev->quirks = HID_Itfs->quirks;
+
+    ret = hid_set_report_descriptor(hiddev, rdesc, rsize);
+    if (ret)
+      goto fail;
+
+    ret = hid_open_report(hiddev);
+    if (ret)
+      goto fail;
+  }
 
 //  HID_Handle->hiddev = hiddev;
 //
 //  return USBH_OK;   // DEBUG
 
-  /* ret = hid_connect(hiddev, HID_CONNECT_DEFAULT); */
-  ret = hidinput_connect(hiddev, 0);    // force?
-  if (ret)
-    goto fail;
+  /* a POS barcode scanner has no input application, its data is decoded directly */
+  pos = USBH_HID_PosConnect(hiddev);
+
+  if (!HID_Handle->attach_cached)
+  {
+    /* ret = hid_connect(hiddev, HID_CONNECT_DEFAULT); */
+    ret = hidinput_connect(hiddev, 0);    // force?
+    if (ret && pos != USBH_OK)
+      goto fail;
+
+    /* not fatal, reports without a program are decoded field by field */
+    if (ret == 0 && hid_compile_reports(hiddev))
+    {
+      USBH_UsrLog("HID: decode program not built, using the field walk");
+    }
 
-  hidinput_disconnect(hiddev);
+    /* before the first report, the saved field values are all zero */
+    USBH_HID_CacheStore(&key, hiddev);
+  }
 
+  /* inputs stay connected for report processing, hid_destroy_device() releases them */
 //  hiddev->claimed |= HID_CLAIMED_INPUT;
 
+  cycles = DWT->CYCCNT - cycles;
+  USBH_UsrLog("HID: %u byte descriptor %s in %u us, arena peak %u/%u bytes + %u device",
+      (unsigned int)rsize,
+      HID_Handle->attach_cached ? "loaded from cache" : "parsed",
+      (unsigned int)(cycles / (SystemCoreClock / 1000000)),
+      (unsigned int)hiddev->arena.peak,
+      (unsigned int)hiddev->arena.size,
+      (unsigned int)sizeof(*hiddev));
+
   HID_Handle->hiddev = hiddev;
+  USBH_HID_DedupSetup(HID_Handle, hiddev);
+#if (USBH_HID_SCAN_ASSEMBLER == 1)
+  USBH_HID_ScanStart();
+#endif
+#if (USBH_HID_MOTION_INTERVAL > 0)
+  USBH_HID_MotionStart();
+#endif
   return USBH_OK;
 
-fail: hid_destroy_device(hiddev);
+fail:
+  if (hiddev)
+    hid_destroy_device(hiddev);
 
   USBH_UsrLog("Hid probe fail");
   return USBH_FAIL;
 }
 
+/**
+ * @brief   Decode an input report through the linux hid stack
+ *          and account the time spent.
+ * @param   HID_Handle: HID handle with a probed hiddev
+ * @param   data: input report as received
+ * @param   length: report length
+ * @retval  None
+ */
+static void USBH_HID_DecodeReport(HID_HandleTypeDef *HID_Handle, uint8_t *data, uint32_t length)
+{
+  uint32_t cycles = DWT->CYCCNT;
+  int ret = 0;
+
+  if (USBH_HID_PosDecode(HID_Handle->hiddev, data, length) != USBH_OK)
+    ret = hid_report_raw_event(HID_Handle->hiddev, HID_INPUT_REPORT, data, length);
+  if (ret == -EMSGSIZE)
+    HID_Handle->short_count++;
+  else if (ret == -ENOENT)
+    HID_Handle->unknown_count++;
+
+  cycles = DWT->CYCCNT - cycles;
+  HID_Handle->decode_count++;
+  HID_Handle->decode_cycles += cycles;
+  if (cycles > HID_Handle->decode_max)
+    HID_Handle->decode_max = cycles;
+
+  if (!HID_Handle->attach_done)
+  {
+    HID_Handle->attach_done = 1;
+    USBH_HID_PrintAttach(HID_Handle);
+  }
+}
+
+/**
+ * @brief   Log the time from the first class request to the first
+ *          decoded report, with or without the descriptor cache.
+ * @param   HID_Handle: HID handle that just decoded its first report
+ * @retval  None
+ */
+static void USBH_HID_PrintAttach(HID_HandleTypeDef *HID_Handle)
+{
+  uint32_t ms = HAL_GetTick() - HID_Handle->attach_tick;
+  uint32_t cycles = DWT->CYCCNT - HID_Handle->attach_cycles;
+
+  /* the cycle counter wraps after 25 s at 168 MHz, a keyboard may wait longer for a key */
+  if (ms < 10000)
+  {
+    USBH_UsrLog("HID: first report %u us after class request, descriptor cache %s",
+        (unsigned int)(cycles / (SystemCoreClock / 1000000)),
+        HID_Handle->attach_cached ? "hit" : "miss");
+  }
+  else
+  {
+    USBH_UsrLog("HID: first report %u ms after class request, descriptor cache %s",
+        (unsigned int)ms, HID_Handle->attach_cached ? "hit" : "miss");
+  }
+}
+
+/**
+ * @brief   Prepare one last-report slot per input report ID.
+ *
+ *          Bits of relative fields are recorded so that a repeated report
+ *          still carrying motion is not taken for a duplicate. Barcode
+ *          reports carry events, not state, and get no slot.
+ * @param   HID_Handle: HID handle
+ * @param   hiddev: parsed device
+ * @retval  None
+ */
+static void USBH_HID_DedupSetup(HID_HandleTypeDef *HID_Handle, struct hid_device *hiddev)
+{
+#if (USBH_HID_DEDUP_IDS > 0)
+  struct hid_report_enum *report_enum = &hiddev->report_enum[HID_INPUT_REPORT];
+  struct hid_report *report;
+  struct hid_field *field;
+  HID_LastReportTypeDef *last;
+  unsigned int i, bit, end;
+
+  HID_Handle->last_count = 0;
+  HID_Handle->last_numbered = report_enum->numbered;
+
+  list_for_each_entry(report, &report_enum->report_list, list)
+  {
+    if (HID_Handle->last_count == USBH_HID_DEDUP_IDS)
+      break;
+
+    for (i = 0; i < report->maxfield; i++)
+    {
+      if ((report->field[i]->application & HID_USAGE_PAGE) == HID_UP_BARCODE)
+        break;
+    }
+    if (i < report->maxfield)
+      continue;
+
+    last = &HID_Handle->last[HID_Handle->last_count++];
+    USBH_memset(last, 0, sizeof(*last));
+    last->id = report->id;
+
+    for (i = 0; i < report->maxfield; i++)
+    {
+      field = report->field[i];
+      if (!(field->flags & HID_MAIN_ITEM_RELATIVE))
+        continue;
+
+      /* offsets exclude the report ID byte */
+      bit = field->report_offset + (report_enum->numbered ? 8 : 0);
+      end = bit + field->report_size * field->report_count;
+      for (; bit < end && bit < USBH_HID_DEDUP_LEN * 8; bit++)
+        ((uint8_t *)last->relative)[bit / 8] |= 1 << (bit % 8);
+    }
+  }
+#endif
+}
+
+/**
+ * @brief   Check an input report against the last one of its report ID.
+ *
+ *          An identical report is dropped unless one of its relative
+ *          fields is non-zero. Report IDs without a slot always pass.
+ * @param   HID_Handle: HID handle
+ * @param   report: report as received
+ * @param   length: report length
+ * @retval  1 if the report needs decoding, 0 if it is a duplicate
+ */
+static uint8_t USBH_HID_ReportChanged(HID_HandleTypeDef *HID_Handle, uint8_t *report, uint32_t length)
+{
+#if (USBH_HID_DEDUP_IDS > 0)
+  HID_LastReportTypeDef *last = NULL;
+  uint32_t words[(USBH_HID_DEDUP_LEN + 3) / 4];
+  uint32_t i, n, diff = 0, motion = 0;
+  uint8_t id = HID_Handle->last_numbered ? report[0] : 0;
+
+  if (length == 0 || length > USBH_HID_DEDUP_LEN)
+    return 1;
+
+  for (i = 0; i < HID_Handle->last_count; i++)
+  {
+    if (HID_Handle->last[i].id == id)
+    {
+      last = &HID_Handle->last[i];
+      break;
+    }
+  }
+  if (last == NULL)
+    return 1;
+
+  /* word copy of the report, the tail of the last word cleared */
+  n = (length + 3) / 4;
+  words[n - 1] = 0;
+  USBH_memcpy(words, report, length);
+
+  for (i = 0; i < n; i++)
+  {
+    diff |= words[i] ^ last->data[i];
+    motion |= words[i] & last->relative[i];
+  }
+
+  if (diff == 0 && motion == 0 && length == last->length)
+  {
+    HID_Handle->dup_count++;
+    return 0;
+  }
+
+  USBH_memcpy(last->data, words, n * 4);
+  last->length = length;
+#endif
+  return 1;
+}
+
+/**
+ * @brief   Queue a report for sending, once per report ID.
+ *
+ *          A report already waiting is not queued twice, it is built from
+ *          the field values when it goes out so the latest values are sent.
+ * @param   HID_Handle: HID handle
+ * @param   report: output or feature report
+ * @retval  USBH_OK, USBH_BUSY when the queue is full
+ */
+static USBH_StatusTypeDef USBH_HID_QueueReport(HID_HandleTypeDef *HID_Handle, struct hid_report *report)
+{
+  uint8_t i;
+
+  for (i = 0; i < HID_Handle->out_count; i++)
+  {
+    if (HID_Handle->out_queue[i] == report)
+      return USBH_OK;
+  }
+
+  if (HID_Handle->out_count == USBH_HID_OUT_QUEUE)
+    return USBH_BUSY;
+
+  HID_Handle->out_queue[HID_Handle->out_count++] = report;
+  return USBH_OK;
+}
+
+/**
+ * @brief   Send the queued output and feature reports, one at a time.
+ *
+ *          Output reports go over the interrupt OUT pipe when the
+ *          interface has one and the report fits a packet, everything
+ *          else goes by SET_REPORT.
+ * @param   phost: Host handle
+ * @param   starting: an interface still waits for its first report
+ * @retval  None
+ */
+static void USBH_HID_OutputProcess(USBH_HandleTypeDef *phost, uint8_t starting)
+{
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle;
+  struct hid_report *report;
+  USBH_URBStateTypeDef urb;
+  USBH_StatusTypeDef status;
+  uint8_t i, n;
+
+  switch (HID_Itfs->out_state)
+  {
+  case HID_OUT_IDLE:
+    if (starting)
+      break;
+
+    /* round robin, starting after the interface served last */
+    for (n = 1; n <= HID_Itfs->count; n++)
+    {
+      i = (HID_Itfs->out_itf + n) % HID_Itfs->count;
+      if (HID_Itfs->itf[i]->out_count != 0)
+        break;
+    }
+    if (n > HID_Itfs->count)
+      break;
+
+    HID_Handle = HID_Itfs->itf[i];
+    report = HID_Handle->out_queue[0];
+    HID_Handle->out_count--;
+    for (n = 0; n < HID_Handle->out_count; n++)
+      HID_Handle->out_queue[n] = HID_Handle->out_queue[n + 1];
+
+    if (hid_report_len(report) > sizeof(HID_Itfs->out))
+    {
+      USBH_ErrLog("HID: report %d too long to send", report->id);
+      break;
+    }
+
+    HID_Itfs->out_itf = i;
+    HID_Itfs->out_type = report->type;
+    HID_Itfs->out_id = report->id;
+    HID_Itfs->out_len = hid_report_len(report);
+    hid_output_report(report, HID_Itfs->out);
+
+    if (report->type == HID_OUTPUT_REPORT && HID_Handle->OutPipe != 0 &&
+        HID_Itfs->out_len <= HID_Handle->OutLength)
+    {
+      USBH_InterruptSendData(phost, HID_Itfs->out, HID_Itfs->out_len, HID_Handle->OutPipe);
+      HID_Itfs->out_retry = 0;
+      HID_Itfs->out_timer = phost->Timer;
+      HID_Itfs->out_state = HID_OUT_PIPE;
+    }
+    else
+    {
+      HID_Itfs->out_state = HID_OUT_CONTROL;
+    }
+    break;
+
+  case HID_OUT_PIPE:
+    HID_Handle = HID_Itfs->itf[HID_Itfs->out_itf];
+    urb = USBH_LL_GetURBState(phost, HID_Handle->OutPipe);
+    if (urb == USBH_URB_DONE)
+    {
+      HID_Itfs->out_state = HID_OUT_IDLE;
+    }
+    else if (urb == USBH_URB_NOTREADY)
+    {
+      /* NAKed, resent once per bInterval, a few times, before SET_REPORT */
+      if (HID_Itfs->out_retry >= HID_OUT_NAK_RETRIES)
+      {
+        HID_Itfs->out_state = HID_OUT_CONTROL;
+      }
+      else if (phost->Timer - HID_Itfs->out_timer >= HID_Handle->OutPoll)
+      {
+        HID_Itfs->out_retry++;
+        HID_Itfs->out_timer = phost->Timer;
+        USBH_InterruptSendData(phost, HID_Itfs->out, HID_Itfs->out_len, HID_Handle->OutPipe);
+      }
+    }
+    else if (urb == USBH_URB_STALL || urb == USBH_URB_ERROR)
+    {
+      HID_Itfs->out_state = HID_OUT_CONTROL;
+    }
+    break;
+
+  case HID_OUT_CONTROL:
+    USBH_HID_Select(phost, HID_Itfs->out_itf);
+    status = USBH_HID_SetReport(phost, HID_Itfs->out_type + 1, HID_Itfs->out_id,
+        HID_Itfs->out, HID_Itfs->out_len);
+    if (status != USBH_BUSY)
+    {
+      if (status != USBH_OK)
+      {
+        USBH_ErrLog("HID: SET_REPORT %d failed", HID_Itfs->out_id);
+      }
+      HID_Itfs->out_state = HID_OUT_IDLE;
+    }
+    break;
+  }
+}
+
+/**
+ * @brief   Set an output or feature usage and queue its report.
+ *
+ *          Values set before the report goes out are sent together, in
+ *          one report per report ID.
+ * @param   phost: Host handle
+ * @param   type: HID_OUTPUT_REPORT or HID_FEATURE_REPORT
+ * @param   usage: usage, page in the upper 16 bits, e.g. HID_UP_LED | 0x01
+ * @param   value: logical value
+ * @retval  USBH_OK, USBH_NOT_SUPPORTED if no interface has the usage,
+ *          USBH_FAIL if the value is out of range, USBH_BUSY if the queue is full
+ */
+USBH_StatusTypeDef USBH_HID_SetUsage(USBH_HandleTypeDef *phost, uint8_t type,
+    uint32_t usage, int32_t value)
+{
+  HID_InterfacesTypeDef *HID_Itfs;
+  HID_HandleTypeDef *HID_Handle;
+  struct hid_report *report;
+  struct hid_field *field;
+  unsigned int i, j, n;
+
+  if (phost->pActiveClass != &HID_Class || phost->pActiveClass->pData == NULL ||
+      (type != HID_OUTPUT_REPORT && type != HID_FEATURE_REPORT))
+    return USBH_FAIL;
+
+  HID_Itfs = phost->pActiveClass->pData;
+  for (n = 0; n < HID_Itfs->count; n++)
+  {
+    HID_Handle = HID_Itfs->itf[n];
+    if (HID_Handle->hiddev == NULL)
+      continue;
+
+    list_for_each_entry(report, &HID_Handle->hiddev->report_enum[type].report_list, list)
+    {
+      for (i = 0; i < report->maxfield; i++)
+      {
+        field = report->field[i];
+        if (!(field->flags & HID_MAIN_ITEM_VARIABLE))
+          continue;
+
+        for (j = 0; j < field->maxusage; j++)
+        {
+          if (field->usage[j].hid != usage)
+            continue;
+          if (value < field->logical_minimum || value > field->logical_maximum ||
+              hid_set_field(field, j, value))
+            return USBH_FAIL;
+          return USBH_HID_QueueReport(HID_Handle, report);
+        }
+      }
+    }
+  }
+  return USBH_NOT_SUPPORTED;
+}
+
+/**
+ * @brief   Print the report decode rate and timing of every interface
+ *          since interface init.
+ * @param   phost: Host handle
+ * @retval  None
+ */
+static void USBH_HID_PrintDecodeStats(USBH_HandleTypeDef *phost)
+{
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle;
+  uint32_t clock_mhz = SystemCoreClock / 1000000;
+  uint32_t elapsed;
+  uint8_t i;
+
+  for (i = 0; i < HID_Itfs->count; i++)
+  {
+    HID_Handle = HID_Itfs->itf[i];
+    if (HID_Handle->decode_count == 0)
+      continue;
+
+    elapsed = phost->Timer - HID_Handle->decode_start;
+    if (elapsed == 0)
+      elapsed = 1;
+
+    USBH_UsrLog("HID #%d decode: %u reports, %u reports/s, avg %u us, max %u us",
+        HID_Handle->interface,
+        (unsigned int)HID_Handle->decode_count,
+        (unsigned int)((HID_Handle->decode_count * 1000ULL) / elapsed),
+        (unsigned int)(HID_Handle->decode_cycles / HID_Handle->decode_count / clock_mhz),
+        (unsigned int)(HID_Handle->decode_max / clock_mhz));
+    USBH_UsrLog("HID #%d decode: %u unchanged reports dropped, %u lost to a full ring",
+        HID_Handle->interface,
+        (unsigned int)HID_Handle->dup_count, (unsigned int)HID_Handle->in_overrun);
+    if (HID_Handle->short_count != 0)
+    {
+      USBH_UsrLog("HID #%d decode: %u short reports too long to pad, dropped",
+          HID_Handle->interface, (unsigned int)HID_Handle->short_count);
+    }
+    if (HID_Handle->unknown_count != 0)
+    {
+      USBH_UsrLog("HID #%d decode: %u reports with an undeclared ID, dropped",
+          HID_Handle->interface, (unsigned int)HID_Handle->unknown_count);
+    }
+  }
+}
+
+/**
+ * @brief   Switch the poll interval of an interface, burst or idle.
+ * @param   phost: Host handle
+ * @param   HID_Handle: HID handle
+ * @param   poll: new interval, ms
+ * @retval  None
+ */
+static void USBH_HID_SetPoll(USBH_HandleTypeDef *phost, HID_HandleTypeDef *HID_Handle,
+    uint16_t poll)
+{
+  HID_Handle->mode_ms[HID_Handle->poll != HID_Handle->poll_idle] +=
+      phost->Timer - HID_Handle->mode_start;
+  HID_Handle->mode_start = phost->Timer;
+  HID_Handle->poll = poll;
+}
+
+/**
+ * @brief   Print, for every interface, the IN requests per second and the
+ *          first report wait of the idle and burst poll intervals.
+ * @param   phost: Host handle
+ * @retval  None
+ */
+static void USBH_HID_PrintPollStats(USBH_HandleTypeDef *phost)
+{
+  HID_InterfacesTypeDef *HID_Itfs = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle;
+  uint32_t ms;
+  uint8_t i, mode;
+
+  for (i = 0; i < HID_Itfs->count; i++)
+  {
+    HID_Handle = HID_Itfs->itf[i];
+
+    /* close the current period */
+    USBH_HID_SetPoll(phost, HID_Handle, HID_Handle->poll);
+
+    for (mode = 0; mode < 2; mode++)
+    {
+      ms = HID_Handle->mode_ms[mode] != 0 ? HID_Handle->mode_ms[mode] : 1;
+      USBH_UsrLog("HID #%d poll %s: every %u ms, %u ms, %u IN requests, %u/s",
+          HID_Handle->interface, mode ? "burst" : "idle",
+          (unsigned int)(mode ? HID_Handle->poll_burst : HID_Handle->poll_idle),
+          (unsigned int)HID_Handle->mode_ms[mode],
+          (unsigned int)HID_Handle->mode_polls[mode],
+          (unsigned int)((HID_Handle->mode_polls[mode] * 1000ULL) / ms));
+    }
+    if (HID_Handle->burst_count != 0)
+    {
+      USBH_UsrLog("HID #%d poll: %u bursts, first report waited avg %u ms, max %u ms",
+          HID_Handle->interface,
+          (unsigned int)HID_Handle->burst_count,
+          (unsigned int)(HID_Handle->first_sum / HID_Handle->burst_count),
+          (unsigned int)HID_Handle->first_max);
+    }
+  }
+}
+
 static USBH_StatusTypeDef USBH_USBHID_Disconnect(USBH_HandleTypeDef *phost) {
 
-  HID_HandleTypeDef *HID_Handle = phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle = USBH_HID_GetHandle(phost);
   struct hid_device *hiddev = HID_Handle->hiddev;
 
+  /* queued reports belong to the parsed device */
+  HID_Handle->out_count = 0;
+
   if (hiddev) {
+    USBH_HID_PosDisconnect(hiddev);
     hid_destroy_device(hiddev);
-    hiddev = NULL;
+    HID_Handle->hiddev = NULL;
   }
 
   return USBH_OK;
@@ -0,0 +1,308 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_cache.c
+  * @brief   This file keeps parsed report descriptors across attaches.
+  *
+  *          Parsing the report descriptor, mapping its usages and compiling
+  *          its reports is the bulk of an interface's CPU time at attach,
+  *          and a device that comes back presents the same descriptor. Once
+  *          parsed, the device is saved with hid_save_device() under its USB
+  *          ids, bcdDevice and a CRC of the descriptor; the next attach with
+  *          the same key restores it with hid_load_device() instead.
+  *
+  *          Entries are appended to a RAM pool of USBH_HID_CACHE_SIZE bytes,
+  *          the oldest dropped to make room. With USBH_HID_CACHE_FLASH they are
+  *          also appended to a flash sector, read in place on a RAM miss, so
+  *          they survive a reset. The sector is only erased when full.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <string.h>
+#include "usbh_hid.h"
+#include "usbh_hid_cache.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_HID_CLASS
+* @{
+*/
+
+/** @defgroup USBH_HID_CACHE
+* @brief    This file includes the parsed descriptor cache for USB Host HID class.
+* @{
+*/
+
+/** @defgroup USBH_HID_CACHE_Private_TypesDefinitions
+* @{
+*/
+#define HID_CACHE_MAGIC                 0x43444948      /* "HIDC" */
+
+/* header, image and padding to the next word */
+#define HID_CACHE_ENTRY_SIZE(len)       ((sizeof(HID_CACHE_EntryTypeDef) + (len) + 3) & ~3UL)
+
+typedef struct
+{
+  uint32_t magic;               /* written first, an erased word ends the entries */
+  HID_CACHE_KeyTypeDef key;
+  uint32_t len;                 /* image bytes that follow */
+  uint32_t crc;                 /* of the image, catches an entry torn by a reset */
+}
+HID_CACHE_EntryTypeDef;
+/**
+* @}
+*/
+
+#if (USBH_HID_CACHE_SIZE > 0)
+
+/** @defgroup USBH_HID_CACHE_Private_Variables
+* @{
+*/
+static uint32_t cache_ram[USBH_HID_CACHE_SIZE / 4];
+static uint32_t cache_used;     /* bytes of cache_ram holding entries */
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_CACHE_Private_Functions
+* @{
+*/
+
+/* CRC unit, a word per write; the last partial word is zero padded */
+static uint32_t USBH_HID_CacheCrc(const uint8_t *data, uint32_t length)
+{
+  uint32_t word;
+
+  CRC->CR = CRC_CR_RESET;
+  for (; length >= 4; length -= 4, data += 4)
+  {
+    memcpy(&word, data, 4);
+    CRC->DR = word;
+  }
+  if (length != 0)
+  {
+    word = 0;
+    memcpy(&word, data, length);
+    CRC->DR = word;
+  }
+  return CRC->DR;
+}
+
+/* last entry for the key, *end gets the offset the entries stop at */
+static const HID_CACHE_EntryTypeDef *USBH_HID_CacheFind(const uint8_t *base, uint32_t size,
+    const HID_CACHE_KeyTypeDef *key, uint32_t *end)
+{
+  const HID_CACHE_EntryTypeDef *entry, *found = NULL;
+  uint32_t pos = 0;
+
+  while (pos + sizeof(*entry) <= size)
+  {
+    entry = (const HID_CACHE_EntryTypeDef *)(base + pos);
+    if (entry->magic != HID_CACHE_MAGIC || entry->len > size - pos - sizeof(*entry))
+    {
+      break;
+    }
+    if (memcmp(&entry->key, key, sizeof(*key)) == 0)
+    {
+      found = entry;
+    }
+    pos += HID_CACHE_ENTRY_SIZE(entry->len);
+  }
+
+  *end = pos;
+  return found;
+}
+
+#if (USBH_HID_CACHE_FLASH == 1)
+static void USBH_HID_CacheFlashStore(const HID_CACHE_EntryTypeDef *entry)
+{
+  const uint8_t *base = (const uint8_t *)USBH_HID_CACHE_FLASH_ADDR;
+  const uint32_t *word = (const uint32_t *)entry;
+  FLASH_EraseInitTypeDef erase;
+  uint32_t need = HID_CACHE_ENTRY_SIZE(entry->len);
+  uint32_t end, sector_error, i;
+
+  if (need > USBH_HID_CACHE_FLASH_SIZE)
+  {
+    return;
+  }
+  USBH_HID_CacheFind(base, USBH_HID_CACHE_FLASH_SIZE, &entry->key, &end);
+
+  HAL_FLASH_Unlock();
+
+  /* full, or an entry was torn by a reset: the CPU stalls while the sector erases */
+  if (end + need > USBH_HID_CACHE_FLASH_SIZE || *(const uint32_t *)(base + end) != 0xFFFFFFFF)
+  {
+    erase.TypeErase = TYPEERASE_SECTORS;
+    erase.Sector = USBH_HID_CACHE_FLASH_SECTOR;
+    erase.NbSectors = 1;
+    erase.VoltageRange = VOLTAGE_RANGE_3;
+    if (HAL_FLASHEx_Erase(&erase, &sector_error) != HAL_OK)
+    {
+      USBH_ErrLog("HID cache: flash erase failed");
+      HAL_FLASH_Lock();
+      return;
+    }
+    end = 0;
+  }
+
+  for (i = 0; i < need / 4; i++)
+  {
+    if (HAL_FLASH_Program(TYPEPROGRAM_WORD, USBH_HID_CACHE_FLASH_ADDR + end + i * 4, word[i]) != HAL_OK)
+    {
+      USBH_ErrLog("HID cache: flash program failed");
+      break;
+    }
+  }
+
+  HAL_FLASH_Lock();
+}
+#endif
+
+#endif /* USBH_HID_CACHE_SIZE > 0 */
+
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_CACHE_Exported_Functions
+* @{
+*/
+
+/**
+  * @brief  USBH_HID_CacheKey
+  *         The function builds the cache key of a report descriptor.
+  * @param  phost: Host handle
+  * @param  rdesc: report descriptor as read from the device
+  * @param  rsize: its length
+  * @param  key: the key
+  * @retval None
+  */
+void USBH_HID_CacheKey(USBH_HandleTypeDef *phost, const uint8_t *rdesc, uint16_t rsize,
+                       HID_CACHE_KeyTypeDef *key)
+{
+  key->vid = phost->device.DevDesc.idVendor;
+  key->pid = phost->device.DevDesc.idProduct;
+  key->bcd = phost->device.DevDesc.bcdDevice;
+  key->rsize = rsize;
+#if (USBH_HID_CACHE_SIZE > 0)
+  __CRC_CLK_ENABLE();
+  key->crc = USBH_HID_CacheCrc(rdesc, rsize);
+#else
+  key->crc = 0;
+#endif
+}
+
+/**
+  * @brief  USBH_HID_CacheLoad
+  *         The function restores the device saved under the key.
+  * @param  key: key of the descriptor just read
+  * @param  region: memory for the device as for hid_allocate_device_in(),
+  *         NULL to take it from the heap
+  * @param  size: bytes at region
+  * @retval the device, parsed, connected and compiled, NULL on a miss
+  */
+struct hid_device *USBH_HID_CacheLoad(const HID_CACHE_KeyTypeDef *key, void *region, size_t size)
+{
+#if (USBH_HID_CACHE_SIZE > 0)
+  const HID_CACHE_EntryTypeDef *entry;
+  uint32_t end;
+
+  entry = USBH_HID_CacheFind((const uint8_t *)cache_ram, cache_used, key, &end);
+#if (USBH_HID_CACHE_FLASH == 1)
+  if (entry == NULL)
+  {
+    entry = USBH_HID_CacheFind((const uint8_t *)USBH_HID_CACHE_FLASH_ADDR,
+        USBH_HID_CACHE_FLASH_SIZE, key, &end);
+    if (entry != NULL && USBH_HID_CacheCrc((const uint8_t *)(entry + 1), entry->len) != entry->crc)
+    {
+      entry = NULL;
+    }
+  }
+#endif
+  if (entry == NULL)
+  {
+    return NULL;
+  }
+
+  /* NULL too for an entry an older firmware saved */
+  return hid_load_device(entry + 1, entry->len, region, size);
+#else
+  return NULL;
+#endif
+}
+
+/**
+  * @brief  USBH_HID_CacheStore
+  *         The function saves a device under the key. Call it once the
+  *         device is connected and compiled, before its first report.
+  * @param  key: key of its descriptor
+  * @param  hiddev: the device
+  * @retval None
+  */
+void USBH_HID_CacheStore(const HID_CACHE_KeyTypeDef *key, struct hid_device *hiddev)
+{
+#if (USBH_HID_CACHE_SIZE > 0)
+  HID_CACHE_EntryTypeDef *entry;
+  uint32_t len, need, drop;
+
+  len = hid_save_device(hiddev, NULL, 0);
+  need = HID_CACHE_ENTRY_SIZE(len);
+  if (need > sizeof(cache_ram))
+  {
+    USBH_UsrLog("HID cache: %u byte device does not fit", (unsigned int)len);
+    return;
+  }
+  /* the oldest entries make room */
+  while (cache_used + need > sizeof(cache_ram))
+  {
+    drop = HID_CACHE_ENTRY_SIZE(((HID_CACHE_EntryTypeDef *)cache_ram)->len);
+    memmove(cache_ram, (uint8_t *)cache_ram + drop, cache_used - drop);
+    cache_used -= drop;
+  }
+
+  entry = (HID_CACHE_EntryTypeDef *)((uint8_t *)cache_ram + cache_used);
+  if (hid_save_device(hiddev, entry + 1, len) == 0)
+  {
+    return;
+  }
+  entry->key = *key;
+  entry->len = len;
+  entry->crc = USBH_HID_CacheCrc((const uint8_t *)(entry + 1), len);
+  entry->magic = HID_CACHE_MAGIC;
+  cache_used += need;
+
+#if (USBH_HID_CACHE_FLASH == 1)
+  USBH_HID_CacheFlashStore(entry);
+#endif
+#else
+  (void)key;
+  (void)hiddev;
+#endif
+}
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -79,6 +79,8 @@
 /** @defgroup USBH_HID_KEYBD_Private_Macros
 * @{
 */ 
+/* nonzero when a byte of w is above the boot keycode range (101) */
+#define HID_KEYBD_OUT_OF_RANGE(w)  (((((w) & 0x7F7F7F7FU) + 0x1A1A1A1AU) | (w)) & 0x80808080U)
 /**
 * @}
 */ 
@@ -315,7 +317,7 @@ static  const  uint8_t  HID_KEYBRD_Codes[] = {
 USBH_StatusTypeDef USBH_HID_KeybdInit(USBH_HandleTypeDef *phost)
 {
   uint32_t x;
-  HID_HandleTypeDef *HID_Handle =  phost->pActiveClass->pData;  
+  HID_HandleTypeDef *HID_Handle =  USBH_HID_GetHandle(phost);
     
   keybd_info.lctrl=keybd_info.lshift= 0;
   keybd_info.lalt=keybd_info.lgui= 0;
@@ -328,12 +330,12 @@ USBH_StatusTypeDef USBH_HID_KeybdInit(USBH_HandleTypeDef *phost)
     keybd_report_data[x]=0;
   }
   
-  if(HID_Handle->length > (sizeof(keybd_report_data)/sizeof(uint32_t)))
+  if(HID_Handle->length > sizeof(keybd_report_data))
   {
-    HID_Handle->length = (sizeof(keybd_report_data)/sizeof(uint32_t));
+    HID_Handle->length = sizeof(keybd_report_data);
   }
   HID_Handle->pData = (uint8_t*)keybd_report_data;
-  fifo_init(&HID_Handle->fifo, phost->device.Data, HID_QUEUE_SIZE * sizeof(keybd_report_data));
+  USBH_HID_QueueInit(&HID_Handle->fifo, HID_Handle->fifo_slot, HID_QUEUE_SIZE);
   
   return USBH_OK;    
 }
@@ -365,14 +367,43 @@ HID_KEYBD_Info_TypeDef *USBH_HID_GetKeybdInfo(USBH_HandleTypeDef *phost)
 static USBH_StatusTypeDef USBH_HID_KeybdDecode(USBH_HandleTypeDef *phost)
 {
   uint8_t x;
+  uint16_t length;
   
-  HID_HandleTypeDef *HID_Handle =  phost->pActiveClass->pData;
-  if(HID_Handle->length == 0)
+  HID_HandleTypeDef *HID_Handle =  USBH_HID_GetHandle(phost);
+  if(HID_Handle == NULL || HID_Handle->length == 0)
   {
     return USBH_FAIL;
   }
   /*Fill report */
-  if(fifo_read(&HID_Handle->fifo, &keybd_report_data, HID_Handle->length) ==  HID_Handle->length)
+  length = USBH_HID_QueueRead(&HID_Handle->fifo, &keybd_report_data, sizeof(keybd_report_data));
+  if(length == sizeof(keybd_report_data))
+  {
+    /* boot report: modifier bits, reserved byte, six keycodes */
+    x = (uint8_t)keybd_report_data[0];
+    keybd_info.lctrl  = x & 1;
+    keybd_info.lshift = (x >> 1) & 1;
+    keybd_info.lalt   = (x >> 2) & 1;
+    keybd_info.lgui   = (x >> 3) & 1;
+    keybd_info.rctrl  = (x >> 4) & 1;
+    keybd_info.rshift = (x >> 5) & 1;
+    keybd_info.ralt   = (x >> 6) & 1;
+    keybd_info.rgui   = (x >> 7) & 1;
+    USBH_memcpy(keybd_info.keys, (uint8_t *)keybd_report_data + 2, sizeof(keybd_info.keys));
+
+    /* HID_ReadItem() reads a keycode outside the logical range as 0 */
+    if(HID_KEYBD_OUT_OF_RANGE(keybd_report_data[0] >> 16) || HID_KEYBD_OUT_OF_RANGE(keybd_report_data[1]))
+    {
+      for(x=0; x < sizeof(keybd_info.keys); x++)
+      {
+        if(keybd_info.keys[x] > imp_0_key_array.logical_max)
+        {
+          keybd_info.keys[x] = 0;
+        }
+      }
+    }
+    return USBH_OK;
+  }
+  if(length != 0)
   {
     
     keybd_info.lctrl=(uint8_t)HID_ReadItem((HID_Report_ItemTypedef *) &imp_0_lctrl, 0);
@@ -0,0 +1,559 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_keymap.c
+  * @brief   This file translates key events into UTF-8 text for a selectable
+  *          keyboard layout (US, UK, DE and FR).
+  *
+  *          Keys are Linux keycodes, as delivered by the input handlers, so
+  *          the same tables serve the event path and boot keyboard reports.
+  *          Modifiers, AltGr, CapsLock and dead keys are applied here.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include <stddef.h>
+#include "uinput.h"
+#include "hid.h"
+#include "usbh_hid_keymap.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_HID_CLASS
+* @{
+*/
+
+/** @defgroup USBH_HID_KEYMAP
+* @brief    This file includes the keyboard layout tables for USB Host HID class.
+* @{
+*/
+
+/** @defgroup USBH_HID_KEYMAP_Private_Defines
+* @{
+*/
+/* keycodes above this produce no text */
+#define KM_KEYS                 (KEY_KPSLASH + 1)
+
+/* symbol flags, code points in the tables stay below 0x4000 */
+#define KM_DEAD                 0x8000  /* combines with the next key */
+#define KM_CAPS                 0x4000  /* CapsLock acts as Shift on this key */
+#define KM_SYM(s)               ((s) & 0x3FFF)
+
+#define KM_CTRL                 (HID_KEYMAP_MOD_LCTRL | HID_KEYMAP_MOD_RCTRL)
+#define KM_SHIFT                (HID_KEYMAP_MOD_LSHIFT | HID_KEYMAP_MOD_RSHIFT)
+#define KM_GUI                  (HID_KEYMAP_MOD_LGUI | HID_KEYMAP_MOD_RGUI)
+
+/* a letter: lower case, upper case, no AltGr symbol */
+#define L(c)                    { (c) | KM_CAPS, (c) - 0x20, 0 }
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_KEYMAP_Private_Variables
+* @{
+*/
+
+/* keys that do not depend on the layout */
+#define KM_COMMON \
+  [KEY_BACKSPACE]  = { '\b', '\b', 0 },   \
+  [KEY_TAB]        = { '\t', '\t', 0 },   \
+  [KEY_ENTER]      = { '\n', '\n', 0 },   \
+  [KEY_SPACE]      = { ' ',  ' ',  ' ' }, \
+  [KEY_KPASTERISK] = { '*',  '*',  0 },   \
+  [KEY_KP7]        = { '7',  '7',  0 },   \
+  [KEY_KP8]        = { '8',  '8',  0 },   \
+  [KEY_KP9]        = { '9',  '9',  0 },   \
+  [KEY_KPMINUS]    = { '-',  '-',  0 },   \
+  [KEY_KP4]        = { '4',  '4',  0 },   \
+  [KEY_KP5]        = { '5',  '5',  0 },   \
+  [KEY_KP6]        = { '6',  '6',  0 },   \
+  [KEY_KPPLUS]     = { '+',  '+',  0 },   \
+  [KEY_KP1]        = { '1',  '1',  0 },   \
+  [KEY_KP2]        = { '2',  '2',  0 },   \
+  [KEY_KP3]        = { '3',  '3',  0 },   \
+  [KEY_KP0]        = { '0',  '0',  0 },   \
+  [KEY_KPENTER]    = { '\n', '\n', 0 },   \
+  [KEY_KPSLASH]    = { '/',  '/',  0 }
+
+#define KM_LETTERS \
+  [KEY_Q] = L('q'), [KEY_W] = L('w'), [KEY_E] = L('e'), [KEY_R] = L('r'), \
+  [KEY_T] = L('t'), [KEY_Y] = L('y'), [KEY_U] = L('u'), [KEY_I] = L('i'), \
+  [KEY_O] = L('o'), [KEY_P] = L('p'), [KEY_A] = L('a'), [KEY_S] = L('s'), \
+  [KEY_D] = L('d'), [KEY_F] = L('f'), [KEY_G] = L('g'), [KEY_H] = L('h'), \
+  [KEY_J] = L('j'), [KEY_K] = L('k'), [KEY_L] = L('l'), [KEY_Z] = L('z'), \
+  [KEY_X] = L('x'), [KEY_C] = L('c'), [KEY_V] = L('v'), [KEY_B] = L('b'), \
+  [KEY_N] = L('n'), [KEY_M] = L('m')
+
+static const uint16_t keymap_us[KM_KEYS][3] = {
+  KM_COMMON,
+  KM_LETTERS,
+  [KEY_KPDOT]      = { '.',  '.',  0 },
+  [KEY_GRAVE]      = { '`',  '~',  0 },
+  [KEY_1]          = { '1',  '!',  0 },
+  [KEY_2]          = { '2',  '@',  0 },
+  [KEY_3]          = { '3',  '#',  0 },
+  [KEY_4]          = { '4',  '$',  0 },
+  [KEY_5]          = { '5',  '%',  0 },
+  [KEY_6]          = { '6',  '^',  0 },
+  [KEY_7]          = { '7',  '&',  0 },
+  [KEY_8]          = { '8',  '*',  0 },
+  [KEY_9]          = { '9',  '(',  0 },
+  [KEY_0]          = { '0',  ')',  0 },
+  [KEY_MINUS]      = { '-',  '_',  0 },
+  [KEY_EQUAL]      = { '=',  '+',  0 },
+  [KEY_LEFTBRACE]  = { '[',  '{',  0 },
+  [KEY_RIGHTBRACE] = { ']',  '}',  0 },
+  [KEY_SEMICOLON]  = { ';',  ':',  0 },
+  [KEY_APOSTROPHE] = { '\'', '"',  0 },
+  [KEY_BACKSLASH]  = { '\\', '|',  0 },
+  [KEY_102ND]      = { '\\', '|',  0 },
+  [KEY_COMMA]      = { ',',  '<',  0 },
+  [KEY_DOT]        = { '.',  '>',  0 },
+  [KEY_SLASH]      = { '/',  '?',  0 },
+};
+
+static const uint16_t keymap_uk[KM_KEYS][3] = {
+  KM_COMMON,
+  KM_LETTERS,
+  [KEY_KPDOT]      = { '.',  '.',  0 },
+  [KEY_GRAVE]      = { '`',  0xAC, 0xA6 },      /* ¬ ¦ */
+  [KEY_1]          = { '1',  '!',  0 },
+  [KEY_2]          = { '2',  '"',  0 },
+  [KEY_3]          = { '3',  0xA3, 0 },         /* £ */
+  [KEY_4]          = { '4',  '$',  0x20AC },    /* € */
+  [KEY_5]          = { '5',  '%',  0 },
+  [KEY_6]          = { '6',  '^',  0 },
+  [KEY_7]          = { '7',  '&',  0 },
+  [KEY_8]          = { '8',  '*',  0 },
+  [KEY_9]          = { '9',  '(',  0 },
+  [KEY_0]          = { '0',  ')',  0 },
+  [KEY_MINUS]      = { '-',  '_',  0 },
+  [KEY_EQUAL]      = { '=',  '+',  0 },
+  [KEY_LEFTBRACE]  = { '[',  '{',  0 },
+  [KEY_RIGHTBRACE] = { ']',  '}',  0 },
+  [KEY_SEMICOLON]  = { ';',  ':',  0 },
+  [KEY_APOSTROPHE] = { '\'', '@',  0 },
+  [KEY_BACKSLASH]  = { '#',  '~',  0 },
+  [KEY_102ND]      = { '\\', '|',  0 },
+  [KEY_COMMA]      = { ',',  '<',  0 },
+  [KEY_DOT]        = { '.',  '>',  0 },
+  [KEY_SLASH]      = { '/',  '?',  0 },
+};
+
+static const uint16_t keymap_de[KM_KEYS][3] = {
+  KM_COMMON,
+  KM_LETTERS,
+  [KEY_Y]          = L('z'),
+  [KEY_Z]          = L('y'),
+  [KEY_Q]          = { 'q' | KM_CAPS, 'Q', '@' },
+  [KEY_E]          = { 'e' | KM_CAPS, 'E', 0x20AC },      /* € */
+  [KEY_M]          = { 'm' | KM_CAPS, 'M', 0xB5 },        /* µ */
+  [KEY_KPDOT]      = { ',',  ',',  0 },
+  [KEY_GRAVE]      = { '^' | KM_DEAD, 0xB0, 0 },          /* ° */
+  [KEY_1]          = { '1',  '!',  0 },
+  [KEY_2]          = { '2',  '"',  0xB2 },                /* ² */
+  [KEY_3]          = { '3',  0xA7, 0xB3 },                /* § ³ */
+  [KEY_4]          = { '4',  '$',  0 },
+  [KEY_5]          = { '5',  '%',  0 },
+  [KEY_6]          = { '6',  '&',  0 },
+  [KEY_7]          = { '7',  '/',  '{' },
+  [KEY_8]          = { '8',  '(',  '[' },
+  [KEY_9]          = { '9',  ')',  ']' },
+  [KEY_0]          = { '0',  '=',  '}' },
+  [KEY_MINUS]      = { 0xDF, '?',  '\\' },                /* ß */
+  [KEY_EQUAL]      = { 0xB4 | KM_DEAD, '`' | KM_DEAD, 0 },
+  [KEY_LEFTBRACE]  = { 0xFC | KM_CAPS, 0xDC, 0 },         /* ü Ü */
+  [KEY_RIGHTBRACE] = { '+',  '*',  '~' },
+  [KEY_SEMICOLON]  = { 0xF6 | KM_CAPS, 0xD6, 0 },         /* ö Ö */
+  [KEY_APOSTROPHE] = { 0xE4 | KM_CAPS, 0xC4, 0 },         /* ä Ä */
+  [KEY_BACKSLASH]  = { '#',  '\'', 0 },
+  [KEY_102ND]      = { '<',  '>',  '|' },
+  [KEY_COMMA]      = { ',',  ';',  0 },
+  [KEY_DOT]        = { '.',  ':',  0 },
+  [KEY_SLASH]      = { '-',  '_',  0 },
+};
+
+static const uint16_t keymap_fr[KM_KEYS][3] = {
+  KM_COMMON,
+  KM_LETTERS,
+  [KEY_Q]          = L('a'),
+  [KEY_W]          = L('z'),
+  [KEY_E]          = { 'e' | KM_CAPS, 'E', 0x20AC },      /* € */
+  [KEY_A]          = L('q'),
+  [KEY_SEMICOLON]  = L('m'),
+  [KEY_Z]          = L('w'),
+  [KEY_KPDOT]      = { '.',  '.',  0 },
+  [KEY_GRAVE]      = { 0xB2, 0,    0 },                   /* ² */
+  [KEY_1]          = { '&',  '1',  0 },
+  [KEY_2]          = { 0xE9, '2',  '~' },                 /* é */
+  [KEY_3]          = { '"',  '3',  '#' },
+  [KEY_4]          = { '\'', '4',  '{' },
+  [KEY_5]          = { '(',  '5',  '[' },
+  [KEY_6]          = { '-',  '6',  '|' },
+  [KEY_7]          = { 0xE8, '7',  '`' },                 /* è */
+  [KEY_8]          = { '_',  '8',  '\\' },
+  [KEY_9]          = { 0xE7, '9',  '^' },                 /* ç */
+  [KEY_0]          = { 0xE0, '0',  '@' },                 /* à */
+  [KEY_MINUS]      = { ')',  0xB0, ']' },                 /* ° */
+  [KEY_EQUAL]      = { '=',  '+',  '}' },
+  [KEY_LEFTBRACE]  = { '^' | KM_DEAD, 0xA8 | KM_DEAD, 0 },/* ¨ */
+  [KEY_RIGHTBRACE] = { '$',  0xA3, 0xA4 },                /* £ ¤ */
+  [KEY_APOSTROPHE] = { 0xF9, '%',  0 },                   /* ù */
+  [KEY_BACKSLASH]  = { '*',  0xB5, 0 },                   /* µ */
+  [KEY_102ND]      = { '<',  '>',  0 },
+  [KEY_M]          = { ',',  '?',  0 },
+  [KEY_COMMA]      = { ';',  '.',  0 },
+  [KEY_DOT]        = { ':',  '/',  0 },
+  [KEY_SLASH]      = { '!',  0xA7, 0 },                   /* § */
+};
+
+static const struct
+{
+  const uint16_t (*keys)[3];
+  uint8_t altgr;
+}
+HID_KEYMAP_Layouts[HID_KEYMAP_NUM] = {
+  [HID_KEYMAP_US] = { keymap_us, 0 },
+  [HID_KEYMAP_UK] = { keymap_uk, 1 },
+  [HID_KEYMAP_DE] = { keymap_de, 1 },
+  [HID_KEYMAP_FR] = { keymap_fr, 1 },
+};
+
+/* dead key, base letter, composed letter; anything else is spelled out */
+static const uint16_t HID_KEYMAP_Compose[][3] = {
+  { '^',  'a', 0xE2 }, { '^',  'e', 0xEA }, { '^',  'i', 0xEE },
+  { '^',  'o', 0xF4 }, { '^',  'u', 0xFB }, { '^',  'A', 0xC2 },
+  { '^',  'E', 0xCA }, { '^',  'I', 0xCE }, { '^',  'O', 0xD4 },
+  { '^',  'U', 0xDB },
+  { 0xB4, 'a', 0xE1 }, { 0xB4, 'e', 0xE9 }, { 0xB4, 'i', 0xED },
+  { 0xB4, 'o', 0xF3 }, { 0xB4, 'u', 0xFA }, { 0xB4, 'y', 0xFD },
+  { 0xB4, 'A', 0xC1 }, { 0xB4, 'E', 0xC9 }, { 0xB4, 'I', 0xCD },
+  { 0xB4, 'O', 0xD3 }, { 0xB4, 'U', 0xDA }, { 0xB4, 'Y', 0xDD },
+  { '`',  'a', 0xE0 }, { '`',  'e', 0xE8 }, { '`',  'i', 0xEC },
+  { '`',  'o', 0xF2 }, { '`',  'u', 0xF9 }, { '`',  'A', 0xC0 },
+  { '`',  'E', 0xC8 }, { '`',  'I', 0xCC }, { '`',  'O', 0xD2 },
+  { '`',  'U', 0xD9 },
+  { 0xA8, 'a', 0xE4 }, { 0xA8, 'e', 0xEB }, { 0xA8, 'i', 0xEF },
+  { 0xA8, 'o', 0xF6 }, { 0xA8, 'u', 0xFC }, { 0xA8, 'y', 0xFF },
+  { 0xA8, 'A', 0xC4 }, { 0xA8, 'E', 0xCB }, { 0xA8, 'I', 0xCF },
+  { 0xA8, 'O', 0xD6 }, { 0xA8, 'U', 0xDC },
+};
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_KEYMAP_Private_Functions
+* @{
+*/
+
+static uint32_t USBH_HID_KeymapPutUTF8(uint16_t cp, uint8_t *out)
+{
+  if (cp < 0x80)
+  {
+    out[0] = (uint8_t)cp;
+    return 1;
+  }
+  if (cp < 0x800)
+  {
+    out[0] = 0xC0 | (cp >> 6);
+    out[1] = 0x80 | (cp & 0x3F);
+    return 2;
+  }
+  out[0] = 0xE0 | (cp >> 12);
+  out[1] = 0x80 | ((cp >> 6) & 0x3F);
+  out[2] = 0x80 | (cp & 0x3F);
+  return 3;
+}
+
+static uint16_t USBH_HID_KeymapCompose(uint16_t dead, uint16_t base)
+{
+  uint32_t i;
+
+  for (i = 0; i < sizeof(HID_KEYMAP_Compose) / sizeof(HID_KEYMAP_Compose[0]); i++)
+  {
+    if (HID_KEYMAP_Compose[i][0] == dead && HID_KEYMAP_Compose[i][1] == base)
+    {
+      return HID_KEYMAP_Compose[i][2];
+    }
+  }
+  return 0;
+}
+
+static uint8_t USBH_HID_KeymapModifier(uint16_t code)
+{
+  switch (code)
+  {
+  case KEY_LEFTCTRL:   return HID_KEYMAP_MOD_LCTRL;
+  case KEY_LEFTSHIFT:  return HID_KEYMAP_MOD_LSHIFT;
+  case KEY_LEFTALT:    return HID_KEYMAP_MOD_LALT;
+  case KEY_LEFTMETA:   return HID_KEYMAP_MOD_LGUI;
+  case KEY_RIGHTCTRL:  return HID_KEYMAP_MOD_RCTRL;
+  case KEY_RIGHTSHIFT: return HID_KEYMAP_MOD_RSHIFT;
+  case KEY_RIGHTALT:   return HID_KEYMAP_MOD_RALT;
+  case KEY_RIGHTMETA:  return HID_KEYMAP_MOD_RGUI;
+  default:             return 0;
+  }
+}
+
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_KEYMAP_Exported_Functions
+* @{
+*/
+
+/**
+  * @brief  USBH_HID_KeymapInit
+  *         The function selects a layout and clears the translation state.
+  * @param  km: translation state
+  * @param  layout: keyboard layout the device is configured for
+  * @retval None
+  */
+void USBH_HID_KeymapInit(HID_KEYMAP_StateTypeDef *km, HID_KEYMAP_LayoutTypeDef layout)
+{
+  uint32_t i;
+
+  if (layout >= HID_KEYMAP_NUM)
+  {
+    layout = HID_KEYMAP_US;
+  }
+
+  km->keys = HID_KEYMAP_Layouts[layout].keys;
+  km->altgr = HID_KEYMAP_Layouts[layout].altgr;
+  km->mods = 0;
+  km->capslock = 0;
+  km->dead = 0;
+  for (i = 0; i < sizeof(km->boot_keys); i++)
+  {
+    km->boot_keys[i] = 0;
+  }
+}
+
+/**
+  * @brief  USBH_HID_KeymapKey
+  *         The function applies one key event and writes the text it
+  *         produces, if any.
+  * @param  km: translation state
+  * @param  code: Linux keycode
+  * @param  value: 1 press, 0 release, 2 autorepeat
+  * @param  out: buffer of at least HID_KEYMAP_UTF8_MAX bytes
+  * @retval number of UTF-8 bytes written
+  */
+uint32_t USBH_HID_KeymapKey(HID_KEYMAP_StateTypeDef *km, uint16_t code, int32_t value, uint8_t *out)
+{
+  uint8_t  mod = USBH_HID_KeymapModifier(code);
+  uint8_t  altgr, shift;
+  uint16_t sym;
+  uint32_t len = 0;
+
+  if (mod != 0)
+  {
+    if (value)
+    {
+      km->mods |= mod;
+    }
+    else
+    {
+      km->mods &= ~mod;
+    }
+    return 0;
+  }
+
+  if (value == 0 || code >= KM_KEYS)
+  {
+    return 0;
+  }
+
+  if (code == KEY_CAPSLOCK)
+  {
+    if (value == 1)
+    {
+      km->capslock ^= 1;
+    }
+    return 0;
+  }
+
+  altgr = km->altgr && (km->mods & HID_KEYMAP_MOD_RALT);
+
+  /* shortcuts are not text */
+  if ((km->mods & (KM_CTRL | KM_GUI | HID_KEYMAP_MOD_LALT)) ||
+      (!km->altgr && (km->mods & HID_KEYMAP_MOD_RALT)))
+  {
+    return 0;
+  }
+
+  sym = km->keys[code][0];
+  if (altgr)
+  {
+    sym = km->keys[code][2];
+  }
+  else
+  {
+    shift = (km->mods & KM_SHIFT) != 0;
+    if (km->capslock && (sym & KM_CAPS))
+    {
+      shift ^= 1;
+    }
+    if (shift)
+    {
+      sym = km->keys[code][1];
+    }
+  }
+
+  if (sym == 0)
+  {
+    return 0;
+  }
+
+  if (km->dead != 0)
+  {
+    uint16_t dead = km->dead;
+    uint16_t composed;
+
+    km->dead = 0;
+    /* the dead key twice or followed by space gives the accent itself */
+    if (sym == (dead | KM_DEAD) || KM_SYM(sym) == ' ')
+    {
+      return USBH_HID_KeymapPutUTF8(dead, out);
+    }
+    if (!(sym & KM_DEAD))
+    {
+      composed = USBH_HID_KeymapCompose(dead, KM_SYM(sym));
+      if (composed != 0)
+      {
+        return USBH_HID_KeymapPutUTF8(composed, out);
+      }
+    }
+    len = USBH_HID_KeymapPutUTF8(dead, out);
+  }
+
+  if (sym & KM_DEAD)
+  {
+    km->dead = KM_SYM(sym);
+    return len;
+  }
+
+  return len + USBH_HID_KeymapPutUTF8(KM_SYM(sym), out + len);
+}
+
+/**
+  * @brief  USBH_HID_KeymapEvents
+  *         The function translates a batch delivered to an input handler.
+  * @param  km: translation state
+  * @param  vals: events of the batch
+  * @param  count: number of events
+  * @param  out: output buffer
+  * @param  size: size of the output buffer; text of keys that do not fit
+  *         is dropped
+  * @retval number of UTF-8 bytes written
+  */
+uint32_t USBH_HID_KeymapEvents(HID_KEYMAP_StateTypeDef *km, const struct input_event *vals,
+                               uint32_t count, uint8_t *out, uint32_t size)
+{
+  uint8_t  buf[HID_KEYMAP_UTF8_MAX];
+  uint32_t len = 0, n, i;
+
+  for (; count > 0; count--, vals++)
+  {
+    if (vals->type != EV_KEY)
+    {
+      continue;
+    }
+    n = USBH_HID_KeymapKey(km, vals->code, vals->value, buf);
+    if (len + n > size)
+    {
+      continue;
+    }
+    for (i = 0; i < n; i++)
+    {
+      out[len++] = buf[i];
+    }
+  }
+  return len;
+}
+
+/**
+  * @brief  USBH_HID_KeymapBootReport
+  *         The function translates a boot protocol keyboard report. Every
+  *         key that is new in this report produces text, in report order.
+  * @param  km: translation state
+  * @param  report: 8 byte boot keyboard report
+  * @param  out: output buffer
+  * @param  size: size of the output buffer
+  * @retval number of UTF-8 bytes written
+  */
+uint32_t USBH_HID_KeymapBootReport(HID_KEYMAP_StateTypeDef *km, const uint8_t *report,
+                                   uint8_t *out, uint32_t size)
+{
+  uint8_t  buf[HID_KEYMAP_UTF8_MAX];
+  uint32_t len = 0, n, i, j;
+
+  /* ErrorRollOver: keep the previous state */
+  if (report[2] == 0x01)
+  {
+    return 0;
+  }
+
+  km->mods = report[0];
+
+  for (i = 2; i < 8; i++)
+  {
+    if (report[i] == 0)
+    {
+      continue;
+    }
+    for (j = 0; j < sizeof(km->boot_keys); j++)
+    {
+      if (km->boot_keys[j] == report[i])
+      {
+        break;
+      }
+    }
+    if (j < sizeof(km->boot_keys))
+    {
+      continue;
+    }
+
+    n = USBH_HID_KeymapKey(km, hidinput_keyboard_code(report[i]), 1, buf);
+    if (len + n > size)
+    {
+      continue;
+    }
+    for (j = 0; j < n; j++)
+    {
+      out[len++] = buf[j];
+    }
+  }
+
+  for (i = 0; i < sizeof(km->boot_keys); i++)
+  {
+    km->boot_keys[i] = report[i + 2];
+  }
+  return len;
+}
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -0,0 +1,271 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_motion.c
+  * @brief   This file merges pointer motion into a bounded report rate.
+  *
+  *          It is an input handler: REL_X, REL_Y and REL_WHEEL deltas of
+  *          every pointer are summed and the mouse buttons tracked until
+  *          the next flush, which passes one HID_MOTION_ReportTypeDef to
+  *          USBH_HID_MotionCallback(). Motion is flushed at most once per
+  *          USBH_HID_MOTION_INTERVAL ms, and no delta waits longer than
+  *          that once USBH_HID_MotionPoll() runs. A button change is
+  *          flushed at once so that no click is merged away.
+  *
+  *          Deltas beyond the 8 bit range of a report are carried to the
+  *          next flush, up to HID_MOTION_LIMIT; motion the consumer could
+  *          not follow at all is dropped there rather than replayed late.
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uinput.h"
+#include "kinput.h"
+#include "usbh_hid_motion.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_HID_CLASS
+* @{
+*/
+
+/** @defgroup USBH_HID_MOTION
+* @brief    This file includes the pointer motion coalescing for USB Host HID class.
+* @{
+*/
+
+/** @defgroup USBH_HID_MOTION_Private_TypesDefinitions
+* @{
+*/
+#define HID_MOTION_AXES         3               /* x, y, wheel */
+#define HID_MOTION_LIMIT        (127 * 8)       /* carried delta, eight full reports */
+
+typedef struct
+{
+  int32_t  delta[HID_MOTION_AXES];
+  uint8_t  buttons;
+  uint8_t  changed;             /* buttons differ from the last flush */
+  uint16_t merged;
+  uint32_t last;                /* HAL tick of the last flush */
+}
+HID_MOTION_StateTypeDef;
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_MOTION_Private_Variables
+* @{
+*/
+static HID_MOTION_StateTypeDef motion;
+
+static void USBH_HID_MotionEvents(struct input_handler *handler, struct input_dev *dev,
+                                  const struct input_event *vals, unsigned int count);
+
+static struct input_handler motion_handler = {
+  .name = "motion",
+  .events = USBH_HID_MotionEvents,
+};
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_MOTION_Private_Functions
+* @{
+*/
+
+static uint8_t USBH_HID_MotionPending(void)
+{
+  return motion.delta[0] != 0 || motion.delta[1] != 0 || motion.delta[2] != 0 ||
+      motion.changed;
+}
+
+static int8_t USBH_HID_MotionTake(int32_t *delta)
+{
+  int32_t out = *delta;
+
+  if (out > 127)
+  {
+    out = 127;
+  }
+  else if (out < -127)
+  {
+    out = -127;
+  }
+  *delta -= out;
+  return (int8_t)out;
+}
+
+static void USBH_HID_MotionFlush(uint32_t now)
+{
+  HID_MOTION_ReportTypeDef report;
+
+  report.time = now;
+  report.x = USBH_HID_MotionTake(&motion.delta[0]);
+  report.y = USBH_HID_MotionTake(&motion.delta[1]);
+  report.wheel = USBH_HID_MotionTake(&motion.delta[2]);
+  report.buttons = motion.buttons;
+  report.merged = motion.merged;
+
+  motion.changed = 0;
+  motion.merged = 0;
+  motion.last = now;
+  USBH_HID_MotionCallback(&report);
+}
+
+static void USBH_HID_MotionEvents(struct input_handler *handler, struct input_dev *dev,
+                                  const struct input_event *vals, unsigned int count)
+{
+  uint32_t bit;
+  int32_t *delta;
+  uint8_t  used = 0;
+
+  for (; count > 0; count--, vals++)
+  {
+    switch (vals->type)
+    {
+    case EV_REL:
+      switch (vals->code)
+      {
+      case REL_X:     delta = &motion.delta[0]; break;
+      case REL_Y:     delta = &motion.delta[1]; break;
+      case REL_WHEEL: delta = &motion.delta[2]; break;
+      default:        continue;
+      }
+      *delta += vals->value;
+      if (*delta > HID_MOTION_LIMIT)
+      {
+        *delta = HID_MOTION_LIMIT;
+      }
+      else if (*delta < -HID_MOTION_LIMIT)
+      {
+        *delta = -HID_MOTION_LIMIT;
+      }
+      used = 1;
+      break;
+
+    case EV_KEY:
+      if (vals->code < BTN_MOUSE || vals->code > BTN_TASK || vals->value == 2)
+      {
+        continue;
+      }
+      bit = 1 << (vals->code - BTN_MOUSE);
+      motion.buttons = vals->value ? motion.buttons | bit : motion.buttons & ~bit;
+      motion.changed = 1;
+      used = 1;
+      break;
+
+    case EV_SYN:
+      if (!used)
+      {
+        break;
+      }
+      used = 0;
+      motion.merged++;
+      if (motion.changed || vals->time - motion.last >= USBH_HID_MOTION_INTERVAL)
+      {
+        USBH_HID_MotionFlush(vals->time);
+      }
+      break;
+    }
+  }
+}
+
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_MOTION_Exported_Functions
+* @{
+*/
+
+/**
+  * @brief  USBH_HID_MotionStart
+  *         The function clears the pending motion and subscribes the
+  *         coalescing stage to the input events.
+  * @retval None
+  */
+void USBH_HID_MotionStart(void)
+{
+  motion.delta[0] = 0;
+  motion.delta[1] = 0;
+  motion.delta[2] = 0;
+  motion.buttons = 0;
+  motion.changed = 0;
+  motion.merged = 0;
+  motion.last = HAL_GetTick();
+  input_register_handler(&motion_handler);
+}
+
+/**
+  * @brief  USBH_HID_MotionStop
+  *         The function unsubscribes the stage. Pending motion is dropped,
+  *         held buttons are reported released.
+  * @retval None
+  */
+void USBH_HID_MotionStop(void)
+{
+  input_unregister_handler(&motion_handler);
+  motion.delta[0] = 0;
+  motion.delta[1] = 0;
+  motion.delta[2] = 0;
+  if (motion.buttons != 0)
+  {
+    motion.buttons = 0;
+    USBH_HID_MotionFlush(HAL_GetTick());
+  }
+}
+
+/**
+  * @brief  USBH_HID_MotionPoll
+  *         The function flushes motion that has waited an interval, or the
+  *         rest of a saturated delta. Call it periodically.
+  * @retval None
+  */
+void USBH_HID_MotionPoll(void)
+{
+  uint32_t now = HAL_GetTick();
+
+  if (USBH_HID_MotionPending() && now - motion.last >= USBH_HID_MOTION_INTERVAL)
+  {
+    USBH_HID_MotionFlush(now);
+  }
+}
+
+/**
+  * @brief  USBH_HID_MotionCallback
+  *         The function is called once per flush, with the motion merged
+  *         since the previous one.
+  * @param  report: the report, valid for the duration of the call
+  * @retval None
+  */
+__weak void USBH_HID_MotionCallback(const HID_MOTION_ReportTypeDef *report)
+{
+  USBH_UsrLog("motion: %d %d wheel %d buttons %02x, %u reports",
+      (int)report->x, (int)report->y, (int)report->wheel,
+      (unsigned int)report->buttons, (unsigned int)report->merged);
+}
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
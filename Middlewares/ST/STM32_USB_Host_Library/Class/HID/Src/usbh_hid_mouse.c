@@ -175,7 +175,7 @@ static const HID_Report_ItemTypedef prop_y={
   */
 USBH_StatusTypeDef USBH_HID_MouseInit(USBH_HandleTypeDef *phost)
 {
-  HID_HandleTypeDef *HID_Handle =  phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle =  USBH_HID_GetHandle(phost);
 
   mouse_info.x=0;
   mouse_info.y=0;
@@ -190,7 +190,7 @@ USBH_StatusTypeDef USBH_HID_MouseInit(USBH_HandleTypeDef *phost)
     HID_Handle->length = sizeof(mouse_report_data);
   }
   HID_Handle->pData = (uint8_t *)mouse_report_data;
-  fifo_init(&HID_Handle->fifo, phost->device.Data, HID_QUEUE_SIZE * sizeof(mouse_report_data));
+  USBH_HID_QueueInit(&HID_Handle->fifo, HID_Handle->fifo_slot, HID_QUEUE_SIZE);
 
   return USBH_OK;  
 }
@@ -221,14 +221,30 @@ HID_MOUSE_Info_TypeDef *USBH_HID_GetMouseInfo(USBH_HandleTypeDef *phost)
   */
 static USBH_StatusTypeDef USBH_HID_MouseDecode(USBH_HandleTypeDef *phost)
 {
-  HID_HandleTypeDef *HID_Handle =  phost->pActiveClass->pData;
+  HID_HandleTypeDef *HID_Handle =  USBH_HID_GetHandle(phost);
+  uint16_t length;
+  uint32_t report;
   
-  if(HID_Handle->length == 0)
+  if(HID_Handle == NULL || HID_Handle->length == 0)
   {
     return USBH_FAIL;
   }
   /*Fill report */
-  if(fifo_read(&HID_Handle->fifo, &mouse_report_data, HID_Handle->length) ==  HID_Handle->length)
+  length = USBH_HID_QueueRead(&HID_Handle->fifo, &mouse_report_data, sizeof(mouse_report_data));
+  if(length >= 3)
+  {
+    /* boot report: button bits, x, y and an optional wheel, not decoded */
+    report = mouse_report_data[0];
+    mouse_info.x = (uint8_t)(report >> 8);
+    mouse_info.y = (uint8_t)(report >> 16);
+
+    mouse_info.buttons[0] = report & 1;
+    mouse_info.buttons[1] = (report >> 1) & 1;
+    mouse_info.buttons[2] = (report >> 2) & 1;
+
+    return USBH_OK;
+  }
+  if(length != 0)
   {
     
     /*Decode report */
@@ -2,14 +2,14 @@
 #include "usbh_hid.h"
 #include "usbh_hid_nonbootkbd.h"
 
-#define NB_KBD_DATA_SIZE                256
-
-uint8_t nonboot_kbd_data[NB_KBD_DATA_SIZE];
-
 USBH_StatusTypeDef USBH_HID_NonBootKbdInit(USBH_HandleTypeDef *phost) {
 
-  HID_HandleTypeDef *HID_Handle =  phost->pActiveClass->pData;
-  HID_Handle->pData = (uint8_t*)nonboot_kbd_data;
+  /* every interface receives into its own handle */
+  HID_HandleTypeDef *HID_Handle =  USBH_HID_GetHandle(phost);
+  if (HID_Handle->length > sizeof(HID_Handle->in_slot[0].data))
+    HID_Handle->length = sizeof(HID_Handle->in_slot[0].data);
+  HID_Handle->pData = HID_Handle->in_slot[0].data;
+  USBH_HID_QueueInit(&HID_Handle->fifo, HID_Handle->fifo_slot, HID_QUEUE_SIZE);
   return USBH_OK;
 }
 
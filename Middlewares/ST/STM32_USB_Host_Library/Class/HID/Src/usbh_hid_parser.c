@@ -126,7 +126,7 @@ uint32_t HID_ReadItem(HID_Report_ItemTypedef *ri, uint8_t ndx)
   /* read data bytes in little endian order */
   for(x=0; x < ((ri->size & 0x7) ? (ri->size/8)+1 : (ri->size/8)); x++)
   {
-    val=(uint32_t)(*data << (x*8));
+    val|=(uint32_t)data[x] << (x*8);
   }    
   val=(val >> shift) & ((1<<ri->size)-1);
   
@@ -0,0 +1,317 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_pos.c
+  * @brief   This file decodes HID POS barcode scanners (usage page 0x8C).
+  *
+  *          In POS mode the scanner sends the decoded barcode in one
+  *          Scanned Data Report (symbology identifiers, decoded data and a
+  *          "continued" flag) instead of a keystroke per character. The
+  *          report layout is taken from the parsed descriptor at connect
+  *          time and each barcode becomes one HID_SCAN_RecordTypeDef,
+  *          delivered through USBH_HID_ScanCallback().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "usbh_hid.h"
+#include "usbh_hid_scan.h"
+#include "usbh_hid_pos.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_HID_CLASS
+* @{
+*/
+
+/** @defgroup USBH_HID_POS
+* @brief    This file includes the HID POS barcode scanner handling for USB Host HID class.
+* @{
+*/
+
+/** @defgroup USBH_HID_POS_Private_TypesDefinitions
+* @{
+*/
+/* bit offsets are relative to the report data, after the report ID */
+typedef struct
+{
+  uint8_t  active;
+  uint8_t  numbered;
+  uint8_t  id;                  /* Scanned Data Report ID */
+  uint16_t sym[3];              /* symbology identifier bit offsets */
+  uint8_t  nsym;                /* bit n set when sym[n] is present */
+  uint16_t data;                /* decoded data bit offset, 8 bit values */
+  uint16_t count;               /* decoded data bytes per report */
+  uint16_t cont;                /* continued flag bit offset */
+  uint8_t  has_cont;
+
+  uint32_t trigger;             /* usage of the Trigger Report field, 0 if none */
+}
+HID_POS_LayoutTypeDef;
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_POS_Private_Variables
+* @{
+*/
+static HID_POS_LayoutTypeDef  pos_layout;
+static struct hid_device     *pos_hiddev;       /* device of the POS interface */
+static HID_SCAN_RecordTypeDef pos_record;
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_POS_Private_Functions
+* @{
+*/
+
+static void USBH_HID_PosEmit(void)
+{
+  /* the decoded data field is zero padded */
+  while (pos_record.length != 0 && pos_record.data[pos_record.length - 1] == 0)
+  {
+    pos_record.length--;
+  }
+  if (pos_record.length != 0)
+  {
+    USBH_HID_ScanCallback(&pos_record);
+  }
+  pos_record.length = 0;
+}
+
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_POS_Exported_Functions
+* @{
+*/
+
+/**
+  * @brief  USBH_HID_PosConnect
+  *         The function looks for a Scanned Data Report in the parsed
+  *         descriptor and prepares its decoding. One interface of the
+  *         device is served, the first one found.
+  * @param  hiddev: parsed device
+  * @retval USBH_OK if the device reports scanned data
+  */
+USBH_StatusTypeDef USBH_HID_PosConnect(struct hid_device *hiddev)
+{
+  struct hid_report_enum *report_enum;
+  struct hid_report *report;
+  struct hid_field *field;
+  unsigned i, j, hid, bit;
+
+  if (pos_layout.active)
+  {
+    return USBH_FAIL;
+  }
+  pos_layout.trigger = 0;
+  pos_record.length = 0;
+
+  report_enum = &hiddev->report_enum[HID_INPUT_REPORT];
+  list_for_each_entry(report, &report_enum->report_list, list)
+  {
+    pos_layout.nsym = 0;
+    pos_layout.count = 0;
+    pos_layout.has_cont = 0;
+
+    for (i = 0; i < report->maxfield; i++)
+    {
+      field = report->field[i];
+      if (field->maxusage == 0 || !(field->flags & HID_MAIN_ITEM_VARIABLE))
+        continue;
+
+      for (j = 0; j < field->report_count; j++)
+      {
+        hid = field->usage[j < field->maxusage ? j : field->maxusage - 1].hid;
+        bit = field->report_offset + j * field->report_size;
+
+        if (hid >= HID_BS_SYMBOLOGYID1 && hid <= HID_BS_SYMBOLOGYID3 &&
+            field->report_size == 8 && bit % 8 == 0)
+        {
+          pos_layout.sym[hid - HID_BS_SYMBOLOGYID1] = bit;
+          pos_layout.nsym |= 1 << (hid - HID_BS_SYMBOLOGYID1);
+        }
+        else if (hid == HID_BS_DECODEDDATA && field->report_size == 8 && bit % 8 == 0)
+        {
+          /* one contiguous run of bytes */
+          if (pos_layout.count == 0)
+            pos_layout.data = bit;
+          if (bit == pos_layout.data + pos_layout.count * 8)
+            pos_layout.count++;
+        }
+        else if (hid == HID_BS_DATACONTINUED)
+        {
+          pos_layout.cont = bit;
+          pos_layout.has_cont = 1;
+        }
+      }
+    }
+
+    if (pos_layout.count != 0)
+    {
+      pos_layout.id = report->id;
+      pos_layout.numbered = report_enum->numbered;
+      pos_layout.active = 1;
+      break;
+    }
+  }
+
+  if (!pos_layout.active)
+  {
+    return USBH_FAIL;
+  }
+
+  /* first output field of a Trigger Report collection starts a scan */
+  report_enum = &hiddev->report_enum[HID_OUTPUT_REPORT];
+  list_for_each_entry(report, &report_enum->report_list, list)
+  {
+    if (report->maxfield == 0)
+      continue;
+    field = report->field[0];
+    if (field->logical != HID_BS_TRIGGERREPORT || field->maxusage == 0 ||
+        !(field->flags & HID_MAIN_ITEM_VARIABLE))
+      continue;
+
+    pos_layout.trigger = field->usage[0].hid;
+    break;
+  }
+
+  pos_hiddev = hiddev;
+
+  USBH_UsrLog("HID POS: scanned data report %u, %u bytes per report%s%s",
+      (unsigned int)pos_layout.id, (unsigned int)pos_layout.count,
+      pos_layout.has_cont ? ", continued" : "",
+      pos_layout.trigger ? ", trigger" : "");
+  return USBH_OK;
+}
+
+/**
+  * @brief  USBH_HID_PosDisconnect
+  *         The function passes on a pending record and stops decoding.
+  * @param  hiddev: device going away
+  * @retval None
+  */
+void USBH_HID_PosDisconnect(struct hid_device *hiddev)
+{
+  if (!pos_layout.active || hiddev != pos_hiddev)
+  {
+    return;
+  }
+  USBH_HID_PosEmit();
+  pos_layout.active = 0;
+  pos_hiddev = NULL;
+}
+
+/**
+  * @brief  USBH_HID_PosDecode
+  *         The function decodes a Scanned Data Report into the record.
+  * @param  hiddev: device the report came from
+  * @param  data: input report as received
+  * @param  length: report length
+  * @retval USBH_OK if the report was consumed, USBH_FAIL if it is not a
+  *         Scanned Data Report and needs the generic path
+  */
+USBH_StatusTypeDef USBH_HID_PosDecode(struct hid_device *hiddev, uint8_t *data, uint32_t length)
+{
+  uint32_t i, n;
+
+  if (!pos_layout.active || hiddev != pos_hiddev || length == 0)
+  {
+    return USBH_FAIL;
+  }
+
+  if (pos_layout.numbered)
+  {
+    if (data[0] != pos_layout.id)
+    {
+      return USBH_FAIL;
+    }
+    data++;
+    length--;
+  }
+
+  if (pos_record.length == 0)
+  {
+    pos_record.start = HAL_GetTick();
+    pos_record.terminator = 0;
+    for (i = 0; i < 3; i++)
+    {
+      pos_record.symbology[i] = (pos_layout.nsym & (1 << i)) && pos_layout.sym[i] / 8 < length ?
+          data[pos_layout.sym[i] / 8] : 0;
+    }
+  }
+  pos_record.end = HAL_GetTick();
+
+  /* byte aligned, USBH_HID_PosConnect() checked */
+  n = pos_layout.count;
+  if (pos_layout.data / 8 + n > length)
+  {
+    n = pos_layout.data / 8 < length ? length - pos_layout.data / 8 : 0;
+  }
+  if (pos_record.length + n > sizeof(pos_record.data))
+  {
+    n = sizeof(pos_record.data) - pos_record.length;
+  }
+  for (i = 0; i < n; i++)
+  {
+    pos_record.data[pos_record.length++] = data[pos_layout.data / 8 + i];
+  }
+
+  if (pos_layout.has_cont && pos_layout.cont / 8 < length &&
+      (data[pos_layout.cont / 8] >> (pos_layout.cont % 8)) & 1)
+  {
+    /* the zero padding of a continued report is real data, keep it */
+    return USBH_OK;
+  }
+
+  USBH_HID_PosEmit();
+  return USBH_OK;
+}
+
+/**
+  * @brief  USBH_HID_PosTrigger
+  *         The function queues the Trigger Report to start or stop a
+  *         scan. It goes out with the other output reports, see
+  *         USBH_HID_SetUsage().
+  * @param  phost: Host handle
+  * @param  on: 1 to pull the trigger, 0 to release it
+  * @retval USBH_OK once queued, USBH_BUSY if the output queue is full,
+  *         USBH_NOT_SUPPORTED without a Trigger Report
+  */
+USBH_StatusTypeDef USBH_HID_PosTrigger(USBH_HandleTypeDef *phost, uint8_t on)
+{
+  if (!pos_layout.active || pos_layout.trigger == 0)
+  {
+    return USBH_NOT_SUPPORTED;
+  }
+
+  return USBH_HID_SetUsage(phost, HID_OUTPUT_REPORT, pos_layout.trigger, on ? 1 : 0);
+}
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
@@ -0,0 +1,228 @@
+/**
+  ******************************************************************************
+  * @file    usbh_hid_scan.c
+  * @brief   This file assembles the keystrokes of a keyboard-emulation
+  *          barcode scanner into one record per barcode.
+  *
+  *          It is an input handler: key events are translated with the
+  *          configured keymap and collected until a terminator character
+  *          arrives or the gap since the last character exceeds the
+  *          timeout. Each record is then passed to USBH_HID_ScanCallback().
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "uinput.h"
+#include "kinput.h"
+#include "usbh_hid_scan.h"
+
+/** @addtogroup USBH_LIB
+* @{
+*/
+
+/** @addtogroup USBH_CLASS
+* @{
+*/
+
+/** @addtogroup USBH_HID_CLASS
+* @{
+*/
+
+/** @defgroup USBH_HID_SCAN
+* @brief    This file includes the scan assembler for USB Host HID class.
+* @{
+*/
+
+/** @defgroup USBH_HID_SCAN_Private_Variables
+* @{
+*/
+static HID_KEYMAP_LayoutTypeDef scan_layout = USBH_HID_KEYMAP_LAYOUT;
+static uint8_t                  scan_terminators = USBH_HID_SCAN_TERMINATORS;
+static uint32_t                 scan_timeout = USBH_HID_SCAN_TIMEOUT;
+
+static HID_KEYMAP_StateTypeDef  scan_keymap;
+static HID_SCAN_RecordTypeDef   scan_record;
+
+static void USBH_HID_ScanEvents(struct input_handler *handler, struct input_dev *dev,
+                                const struct input_event *vals, unsigned int count);
+
+static struct input_handler scan_handler = {
+  .name = "scan",
+  .events = USBH_HID_ScanEvents,
+};
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_SCAN_Private_Functions
+* @{
+*/
+
+static void USBH_HID_ScanEmit(uint8_t terminator)
+{
+  scan_record.terminator = terminator;
+  if (scan_record.length != 0)
+  {
+    USBH_HID_ScanCallback(&scan_record);
+  }
+  scan_record.length = 0;
+}
+
+static uint8_t USBH_HID_ScanIsTerminator(uint8_t c)
+{
+  switch (c)
+  {
+  case '\r': return scan_terminators & HID_SCAN_TERM_CR;
+  case '\n': return scan_terminators & HID_SCAN_TERM_LF;
+  case '\t': return scan_terminators & HID_SCAN_TERM_TAB;
+  default:   return 0;
+  }
+}
+
+static void USBH_HID_ScanEvents(struct input_handler *handler, struct input_dev *dev,
+                                const struct input_event *vals, unsigned int count)
+{
+  uint8_t  text[HID_KEYMAP_UTF8_MAX];
+  uint32_t n, i;
+
+  for (; count > 0; count--, vals++)
+  {
+    if (vals->type != EV_KEY)
+    {
+      continue;
+    }
+
+    n = USBH_HID_KeymapKey(&scan_keymap, vals->code, vals->value, text);
+    if (n == 0)
+    {
+      continue;
+    }
+
+    /* USBH_HID_ScanPoll() may not have run since the gap expired */
+    if (scan_record.length != 0 && vals->time - scan_record.end > scan_timeout)
+    {
+      USBH_HID_ScanEmit(0);
+    }
+
+    if (n == 1 && USBH_HID_ScanIsTerminator(text[0]))
+    {
+      scan_record.end = vals->time;
+      USBH_HID_ScanEmit(text[0]);
+      continue;
+    }
+
+    /* a full record goes out as is, the rest starts a new one */
+    if (scan_record.length + n > sizeof(scan_record.data))
+    {
+      USBH_HID_ScanEmit(0);
+    }
+
+    if (scan_record.length == 0)
+    {
+      scan_record.start = vals->time;
+    }
+    for (i = 0; i < n; i++)
+    {
+      scan_record.data[scan_record.length++] = text[i];
+    }
+    scan_record.end = vals->time;
+  }
+}
+
+/**
+* @}
+*/
+
+/** @defgroup USBH_HID_SCAN_Exported_Functions
+* @{
+*/
+
+/**
+  * @brief  USBH_HID_ScanSetup
+  *         The function configures the assembler, effective from the next
+  *         USBH_HID_ScanStart().
+  * @param  layout: keyboard layout the scanner is configured for
+  * @param  terminators: HID_SCAN_TERM_* characters that end a record
+  * @param  timeout: gap in ms after which a record ends without terminator
+  * @retval None
+  */
+void USBH_HID_ScanSetup(HID_KEYMAP_LayoutTypeDef layout, uint8_t terminators, uint32_t timeout)
+{
+  scan_layout = layout;
+  scan_terminators = terminators;
+  scan_timeout = timeout;
+}
+
+/**
+  * @brief  USBH_HID_ScanStart
+  *         The function resets the assembler and subscribes it to the
+  *         input events.
+  * @retval None
+  */
+void USBH_HID_ScanStart(void)
+{
+  USBH_HID_KeymapInit(&scan_keymap, scan_layout);
+  scan_record.length = 0;
+  input_register_handler(&scan_handler);
+}
+
+/**
+  * @brief  USBH_HID_ScanStop
+  *         The function passes on a pending record and unsubscribes the
+  *         assembler.
+  * @retval None
+  */
+void USBH_HID_ScanStop(void)
+{
+  input_unregister_handler(&scan_handler);
+  USBH_HID_ScanEmit(0);
+}
+
+/**
+  * @brief  USBH_HID_ScanPoll
+  *         The function ends a pending record once the gap timeout has
+  *         expired. Call it periodically.
+  * @retval None
+  */
+void USBH_HID_ScanPoll(void)
+{
+  if (scan_record.length != 0 && HAL_GetTick() - scan_record.end > scan_timeout)
+  {
+    USBH_HID_ScanEmit(0);
+  }
+}
+
+/**
+  * @brief  USBH_HID_ScanCallback
+  *         The function is called once per assembled record.
+  * @param  record: the record, valid for the duration of the call
+  * @retval None
+  */
+__weak void USBH_HID_ScanCallback(const HID_SCAN_RecordTypeDef *record)
+{
+  USBH_UsrLog("scan: %u bytes in %u ms, %s: %.*s",
+      (unsigned int)record->length,
+      (unsigned int)(record->end - record->start),
+      record->terminator ? "terminated" : "timeout",
+      (int)record->length, (const char *)record->data);
+}
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
+
+/**
+* @}
+*/
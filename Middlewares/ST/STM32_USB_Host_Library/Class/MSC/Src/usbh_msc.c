@@ -151,10 +151,17 @@ static USBH_StatusTypeDef USBH_MSC_InterfaceInit (USBH_HandleTypeDef *phost)
   uint8_t interface = 0; 
   USBH_StatusTypeDef status = USBH_FAIL ;
   MSC_HandleTypeDef *MSC_Handle;
+  USBH_EpDescTypeDef *ep_in = NULL, *ep_out = NULL;
   
   interface = USBH_FindInterface(phost, phost->pActiveClass->ClassCode, MSC_TRANSPARENT, MSC_BOT);
   
-  if(interface == 0xFF) /* Not Valid Interface */
+  if(interface != 0xFF)
+  {
+    ep_in = USBH_FindEndpoint(phost, interface, USB_EP_TYPE_BULK, USB_EP_DIR_IN);
+    ep_out = USBH_FindEndpoint(phost, interface, USB_EP_TYPE_BULK, USB_EP_DIR_OUT);
+  }
+  
+  if((ep_in == NULL) || (ep_out == NULL)) /* Not Valid Interface */
   {
     USBH_DbgLog ("Cannot Find the interface for %s class.", phost->pActiveClass->Name);
     status = USBH_FAIL;      
@@ -166,27 +173,10 @@ static USBH_StatusTypeDef USBH_MSC_InterfaceInit (USBH_HandleTypeDef *phost)
     phost->pActiveClass->pData = (MSC_HandleTypeDef *)USBH_malloc (sizeof(MSC_HandleTypeDef));
     MSC_Handle =  phost->pActiveClass->pData;
     
-    if(phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].bEndpointAddress & 0x80)
-    {
-      MSC_Handle->InEp = (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].bEndpointAddress);
-      MSC_Handle->InEpSize  = phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].wMaxPacketSize;
-    }
-    else
-    {
-      MSC_Handle->OutEp = (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].bEndpointAddress);
-      MSC_Handle->OutEpSize  = phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[0].wMaxPacketSize;      
-    }
-    
-    if(phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[1].bEndpointAddress & 0x80)
-    {
-      MSC_Handle->InEp = (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[1].bEndpointAddress);
-      MSC_Handle->InEpSize  = phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[1].wMaxPacketSize;      
-    }
-    else
-    {
-      MSC_Handle->OutEp = (phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[1].bEndpointAddress);
-      MSC_Handle->OutEpSize  = phost->device.CfgDesc.Itf_Desc[phost->device.current_interface].Ep_Desc[1].wMaxPacketSize;      
-    }
+    MSC_Handle->InEp = ep_in->bEndpointAddress;
+    MSC_Handle->InEpSize = ep_in->wMaxPacketSize;
+    MSC_Handle->OutEp = ep_out->bEndpointAddress;
+    MSC_Handle->OutEpSize = ep_out->wMaxPacketSize;
     
     MSC_Handle->current_lun = 0;
     MSC_Handle->rw_lun = 0;
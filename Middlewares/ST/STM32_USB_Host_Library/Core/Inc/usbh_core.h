@@ -64,6 +64,25 @@
 #define HOST_USER_DISCONNECTION                 5
 #define HOST_USER_UNRECOVERED_ERROR             6
 
+/*
+ * Host channel statistics dump, all fields little endian:
+ *
+ * header: 'H' 'S' version nb_channels core_clock_hz(4) elapsed_ms(4)
+ * record: channel counter(4) x USBH_STATS_WORDS
+ *
+ * counters follow the order of HCD_HCStatsTypeDef: xfrc nak stall txerr
+ * bberr frmor dterr bytes_in bytes_out urb_count urb_lat_max (cycles)
+ * submit_count submit_cycles rearm_count rearm_cycles rxflvl
+ */
+#define USBH_STATS_MAGIC0                       'H'
+#define USBH_STATS_MAGIC1                       'S'
+#define USBH_STATS_VERSION                      3
+#define USBH_STATS_WORDS                        16
+#define USBH_STATS_MAX_CHANNELS                 15
+#define USBH_STATS_HEADER_SIZE                  12
+#define USBH_STATS_RECORD_SIZE                  (1 + 4 * USBH_STATS_WORDS)
+#define USBH_STATS_DUMP_SIZE                    (USBH_STATS_HEADER_SIZE + \
+                                                 USBH_STATS_MAX_CHANNELS * USBH_STATS_RECORD_SIZE)
 
 /**
   * @}
@@ -100,31 +119,12 @@ typedef enum {
     USBH_EVT_DISCONNECT,
     USBH_EVT_PORTUP,
     USBH_EVT_PORTDOWN,
-    USBH_EVT_OVERFLOW,
-    USBH_EVT_HCINT
+    USBH_EVT_OVERFLOW
 } USBH_EventTypeTypeDef;
 
-struct hcint_t {
-
-  uint32_t interrupt;
-  uint32_t hcint_reg;
-
-  int direction;        // 0 for out, 1 for in
-  int in_state;
-  int out_state;
-  int in_urbstate;
-  int out_urbstate;
-  int in_err_count;
-  int out_err_count;
-
-  unsigned int uid;
-};
-
 typedef union {
 
   uint32_t init;
-  struct hcint_t hcint;
-
 
 } USBH_LL_EventData;
 
@@ -146,6 +146,12 @@ uint8_t             USBH_FindInterface(USBH_HandleTypeDef *phost,
                                             uint8_t Class, 
                                             uint8_t SubClass, 
                                             uint8_t Protocol);
+uint8_t             USBH_FindNextInterface(USBH_HandleTypeDef *phost, 
+                                            uint8_t interface);
+USBH_EpDescTypeDef *USBH_FindEndpoint(USBH_HandleTypeDef *phost, 
+                                      uint8_t interface, 
+                                      uint8_t ep_type, 
+                                      uint8_t ep_dir);
 uint8_t             USBH_GetActiveClass(USBH_HandleTypeDef *phost);
 
 uint8_t             USBH_FindInterfaceIndex(USBH_HandleTypeDef *phost, 
@@ -176,13 +182,18 @@ uint32_t             USBH_LL_GetLastXferSize   (USBH_HandleTypeDef *phost, uint8
 USBH_StatusTypeDef   USBH_LL_DriverVBUS   (USBH_HandleTypeDef *phost, uint8_t );
 
 /********************************************************************/
-USBH_StatusTypeDef   USBH_LL_HCINT        (USBH_HandleTypeDef *phost, struct hcint_t * hcint);
+uint32_t             USBH_LL_DumpStats    (USBH_HandleTypeDef *phost, uint8_t *buf, uint32_t size);
+void                 USBH_LL_ResetStats   (USBH_HandleTypeDef *phost);
+void                 USBH_PrintStatsDump  (const uint8_t *buf, uint32_t len);
+void                 USBH_PrintStats      (USBH_HandleTypeDef *phost);
 /********************************************************************/
 
 USBH_StatusTypeDef   USBH_LL_OpenPipe     (USBH_HandleTypeDef *phost, uint8_t, uint8_t, uint8_t, uint8_t , uint8_t, uint16_t ); 
 USBH_StatusTypeDef   USBH_LL_ClosePipe    (USBH_HandleTypeDef *phost, uint8_t );   
 USBH_StatusTypeDef   USBH_LL_SubmitURB    (USBH_HandleTypeDef *phost, uint8_t, uint8_t,uint8_t,  uint8_t, uint8_t*, uint16_t, uint8_t ); 
+USBH_StatusTypeDef   USBH_LL_RearmURB     (USBH_HandleTypeDef *phost, uint8_t, uint8_t*, uint16_t ); 
 USBH_URBStateTypeDef USBH_LL_GetURBState  (USBH_HandleTypeDef *phost, uint8_t ); 
+uint32_t             USBH_LL_GetURBTime   (USBH_HandleTypeDef *phost, uint8_t ); 
 #if (USBH_USE_OS == 1)
 USBH_StatusTypeDef  USBH_LL_NotifyURBChange (USBH_HandleTypeDef *phost);
 #endif
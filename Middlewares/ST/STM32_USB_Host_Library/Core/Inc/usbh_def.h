@@ -276,6 +276,37 @@ typedef struct _InterfaceDescriptor
 }
 USBH_InterfaceDescTypeDef;
 
+/* Endpoint slot of an interface in the descriptor index: transfer type and direction */
+#define  USBH_EP_SLOT(type, dir)         ((((type) & 0x03U) << 1) | (((dir) & USB_EP_DIR_IN) ? 1U : 0U))
+#define  USBH_EP_SLOTS                   8
+#define  USBH_NO_INDEX                   0xFF
+
+typedef struct _InterfaceIndex
+{
+  uint8_t   ep[USBH_EP_SLOTS];  /* Ep_Desc index per USBH_EP_SLOT, USBH_NO_INDEX if none */
+  uint8_t   next;               /* next interface with the same class triple */
+}
+USBH_ItfIndexTypeDef;
+
+typedef struct _ClassIndex
+{
+  uint8_t   bInterfaceClass;
+  uint8_t   bInterfaceSubClass;
+  uint8_t   bInterfaceProtocol;
+  uint8_t   first;              /* first interface with this class triple */
+}
+USBH_ClassIndexTypeDef;
+
+/* Lookup tables built while parsing the configuration descriptor */
+typedef struct _CfgIndex
+{
+  uint8_t                  nb_itf;    /* Itf_Desc entries actually parsed */
+  uint8_t                  nb_class;  /* distinct class triples */
+  USBH_ClassIndexTypeDef   cls[USBH_MAX_NUM_INTERFACES];
+  USBH_ItfIndexTypeDef     itf[USBH_MAX_NUM_INTERFACES];
+}
+USBH_CfgIndexTypeDef;
+
 
 typedef struct _ConfigurationDescriptor
 {
@@ -288,6 +319,7 @@ typedef struct _ConfigurationDescriptor
   uint8_t   bmAttributes;         /* D7 Bus Powered , D6 Self Powered, D5 Remote Wakeup , D4..0 Reserved (0)*/
   uint8_t   bMaxPower;            /*Maximum Power Consumption */
   USBH_InterfaceDescTypeDef        Itf_Desc[USBH_MAX_NUM_INTERFACES];
+  USBH_CfgIndexTypeDef             Index;
 }
 USBH_CfgDescTypeDef;
 
@@ -416,6 +448,8 @@ typedef enum
 USBH_OSEventTypeDef;
 
 /* Control request structure */
+struct _USBH_HandleTypeDef;
+
 typedef struct 
 {
   uint8_t               pipe_in; 
@@ -427,9 +461,26 @@ typedef struct
   USB_Setup_TypeDef     setup;
   CTRL_StateTypeDef     state;  
   uint8_t               errorcount;  
+  /* data IN stage delivered in chunks to sink when not NULL */
+  void                  (*sink)(struct _USBH_HandleTypeDef *phost, uint8_t *data, uint16_t length);
+  uint16_t              chunk;
 
 } USBH_CtrlTypeDef;
 
+/* Incremental configuration descriptor parser state */
+typedef struct
+{
+  uint8_t               desc[USB_CONFIGURATION_DESC_SIZE]; /* head of the current descriptor */
+  uint8_t               have;         /* bytes of the current descriptor received */
+  uint8_t               nb_itf;       /* Itf_Desc slots used */
+  uint8_t               if_ix;        /* slot of the open interface, USBH_NO_INDEX if skipped */
+  uint8_t               ep_ix;        /* endpoints stored for the open interface */
+  uint8_t               error;        /* malformed descriptor, rest ignored */
+  uint16_t              offset;       /* bytes received */
+  uint16_t              skipped_itf;  /* interfaces no class wants or without a free slot */
+  uint16_t              skipped_ep;   /* endpoints beyond USBH_MAX_NUM_ENDPOINTS */
+} USBH_CfgParserTypeDef;
+
 /* Attached device structure */
 typedef struct
 {
@@ -443,6 +494,7 @@ typedef struct
   uint8_t                           current_interface;   
   USBH_DevDescTypeDef               DevDesc;
   USBH_CfgDescTypeDef               CfgDesc; 
+  USBH_CfgParserTypeDef             CfgParser;
   
 }USBH_DeviceTypeDef;
 
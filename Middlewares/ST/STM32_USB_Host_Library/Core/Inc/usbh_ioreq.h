@@ -125,6 +125,11 @@ USBH_StatusTypeDef USBH_InterruptSendData(USBH_HandleTypeDef *phost,
                                     uint8_t length,
                                     uint8_t hc_num);
 
+USBH_StatusTypeDef USBH_RearmReceiveData(USBH_HandleTypeDef *phost, 
+                                uint8_t *buff, 
+                                uint16_t length,
+                                uint8_t hc_num);
+
 
 USBH_StatusTypeDef USBH_IsocReceiveData(USBH_HandleTypeDef *phost, 
                                 uint8_t *buff, 
@@ -55,8 +55,7 @@ extern USBH_StatusTypeDef USBH_AOA_Handshake(USBH_HandleTypeDef * phost);
  */
 const static char* event_string[] =
 { "USBH_EVT_NULL", "USBH_EVT_CONNECT", "USBH_EVT_DISCONNECT",
-    "USBH_EVT_PORTUP", "USBH_EVT_PORTDOWN", "USBH_EVT_OVERFLOW",
-    "USBH_EVT_HCINT" };
+    "USBH_EVT_PORTUP", "USBH_EVT_PORTDOWN", "USBH_EVT_OVERFLOW" };
 
 const static char* pstate_string[] =
 { "PORT_IDLE", "PORT_DEBOUNCE", "PORT_RESET", "PORT_WAIT_ATTACHMENT",
@@ -83,20 +82,6 @@ const static char* control_state_string[] =
     "CTRL_DATA_IN_WAIT", "CTRL_DATA_OUT", "CTRL_DATA_OUT_WAIT",
     "CTRL_STATUS_IN", "CTRL_STATUS_IN_WAIT", "CTRL_STATUS_OUT",
     "CTRL_STATUS_OUT_WAIT", "CTRL_ERROR", "CTRL_STALLED", "CTRL_COMPLETE" };
-/**
-  * @brief  URB States definition
-  */
-const static char * urb_state_string[] =
-{ "URB_IDLE", // = 0,
-    "URB_DONE", "URB_NOTREADY", "URB_NYET", "URB_ERROR", "URB_STALL" };
-
-/**
-  * @brief  Host channel States  definition
-  */
-const static char * channel_state_string[] =
-{ "HC_IDLE", "HC_XFRC", "HC_HALTED", "HC_NAK", "HC_NYET", "HC_STALL",
-    "HC_XACTERR", "HC_BBLERR", "HC_DATATGLERR" };
-
 /*
  * local functions
  */
@@ -172,7 +157,7 @@ static void USBH_Print_DeviceDescriptor(USBH_HandleTypeDef *phost)
 	USBH_DevDescTypeDef* devdesc = &phost->device.DevDesc;
 	USBH_CfgDescTypeDef* cfgdesc = &phost->device.CfgDesc;
 	USBH_InterfaceDescTypeDef* itfdesc;
-	int bNumInterfaces =  cfgdesc->bNumInterfaces;
+	int bNumInterfaces =  cfgdesc->Index.nb_itf;
 
 	USBH_UsrLog("Device Descriptor:");
 	USBH_UsrLog("  bLength:            %d", 	devdesc->bLength);
@@ -218,31 +203,98 @@ for (i = 0; i < bNumInterfaces; i++) {
 
 }
 
-void hcint2string(char* buf, uint32_t hcint)
+static uint32_t stats_get32(const uint8_t *p)
 {
-  int i ;
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
 
+/**
+  * @brief  USBH_PrintStatsDump
+  *         Pretty print a host channel statistics dump produced by
+  *         USBH_LL_DumpStats. Only depends on printf so the same decoder
+  *         works on a dump captured from the UART.
+  * @param  buf: dump buffer
+  * @param  len: dump length in bytes
+  * @retval None
+  */
+void USBH_PrintStatsDump(const uint8_t *buf, uint32_t len)
+{
   static const char* name[] =
-  { "XFRC", "CHH", "AHBERR", "STALL", "NAK", "ACK", "NYET", "TXERR", "BBERR",
-      "FRMOR", "DTERR" };
+  { "XFRC", "NAK", "STALL", "TXERR", "BBERR", "FRMOR", "DTERR",
+      "IN", "OUT", "URB", "LAT(us)", "SUB", "SUB(cyc)", "REARM", "REARM(cyc)",
+      "RXFLVL" };
+
+  uint32_t nb_channels, clock_mhz, elapsed_ms, i, w;
+  uint32_t val[USBH_STATS_WORDS];
+  const uint8_t *rec;
+
+  if (len < USBH_STATS_HEADER_SIZE || buf[0] != USBH_STATS_MAGIC0
+      || buf[1] != USBH_STATS_MAGIC1 || buf[2] != USBH_STATS_VERSION) {
+    printf("stats: bad dump" NEW_LINE);
+    return;
+  }
+
+  nb_channels = buf[3];
+  clock_mhz = stats_get32(&buf[4]) / 1000000;
+  if (clock_mhz == 0)
+    clock_mhz = 1;
+  elapsed_ms = stats_get32(&buf[8]);
+  if (elapsed_ms == 0)
+    elapsed_ms = 1;
+
+  if (len < USBH_STATS_HEADER_SIZE + nb_channels * USBH_STATS_RECORD_SIZE) {
+    printf("stats: truncated dump" NEW_LINE);
+    return;
+  }
+
+  printf("stats over %u ms" NEW_LINE, (unsigned int)elapsed_ms);
+  printf("CH %8s %6s %5s %5s %5s %5s %5s %10s %10s %8s %8s %8s %8s %8s %10s %8s %8s" NEW_LINE,
+      name[0], name[1], name[2], name[3], name[4], name[5], name[6],
+      name[7], name[8], name[9], name[10], name[11], name[12], name[13],
+      name[14], name[15], "B/s");
 
-  for (i = 0; i < 11; i++) {
+  for (i = 0; i < nb_channels; i++) {
 
-    if (hcint & (1 << i)) {
-      strcpy(buf, name[i]);
-      buf += strlen(name[i]);
-      *buf = ' ';
-      buf ++;
+    rec = &buf[USBH_STATS_HEADER_SIZE + i * USBH_STATS_RECORD_SIZE];
+
+    for (w = 0; w < USBH_STATS_WORDS; w++) {
+      val[w] = stats_get32(&rec[1 + 4 * w]);
     }
-  }
 
-  /* remove last space */
-  if (strlen(buf) > 0) {
-    buf--;
-    *buf = 0;
+    /* idle channels are not worth a line */
+    if (val[0] == 0 && val[1] == 0 && val[11] == 0 && val[13] == 0)
+      continue;
+
+    /* submission costs are printed as average cycles per call */
+    printf("%2u %8u %6u %5u %5u %5u %5u %5u %10u %10u %8u %8u %8u %8u %8u %10u %8u %8u" NEW_LINE,
+        (unsigned int)rec[0],
+        (unsigned int)val[0], (unsigned int)val[1], (unsigned int)val[2],
+        (unsigned int)val[3], (unsigned int)val[4], (unsigned int)val[5],
+        (unsigned int)val[6], (unsigned int)val[7], (unsigned int)val[8],
+        (unsigned int)val[9], (unsigned int)(val[10] / clock_mhz),
+        (unsigned int)val[11],
+        (unsigned int)(val[11] ? val[12] / val[11] : 0),
+        (unsigned int)val[13],
+        (unsigned int)(val[13] ? val[14] / val[13] : 0),
+        (unsigned int)val[15],
+        (unsigned int)(((unsigned long long)(val[7] + val[8]) * 1000) / elapsed_ms));
   }
 }
 
+/**
+  * @brief  USBH_PrintStats
+  *         Print the host channel statistics gathered since the port came
+  *         up. Call it from the main loop, the device may stay attached.
+  * @param  phost: Host handle
+  * @retval None
+  */
+void USBH_PrintStats(USBH_HandleTypeDef *phost)
+{
+  static uint8_t stats_dump[USBH_STATS_DUMP_SIZE];
+
+  USBH_PrintStatsDump(stats_dump, USBH_LL_DumpStats(phost, stats_dump, sizeof(stats_dump)));
+}
+
 /*
  * a ring buffer for asynchronous USBH event
  *
@@ -476,7 +528,7 @@ USBH_StatusTypeDef USBH_SelectInterface(USBH_HandleTypeDef *phost, uint8_t inter
 {
   USBH_StatusTypeDef   status = USBH_OK;
   
-  if(interface < phost->device.CfgDesc.bNumInterfaces)
+  if(interface < phost->device.CfgDesc.Index.nb_itf)
   {
     phost->device.current_interface = interface;
     USBH_UsrLog ("Switching to Interface (#%d)", interface);
@@ -515,25 +567,74 @@ uint8_t USBH_GetActiveClass(USBH_HandleTypeDef *phost)
   */
 uint8_t  USBH_FindInterface(USBH_HandleTypeDef *phost, uint8_t Class, uint8_t SubClass, uint8_t Protocol)
 {
-  USBH_InterfaceDescTypeDef    *pif ;
-  USBH_CfgDescTypeDef          *pcfg ;
-  int8_t                        if_ix = 0;
-  
-  pif = (USBH_InterfaceDescTypeDef *)0;
-  pcfg = &phost->device.CfgDesc;  
+  USBH_CfgIndexTypeDef         *idx = &phost->device.CfgDesc.Index;
+  USBH_ClassIndexTypeDef       *pcls;
+  uint8_t                       i;
+  uint8_t                       if_ix = 0xFF;
   
-  while (if_ix < USBH_MAX_NUM_INTERFACES)
+  /* one entry per distinct class triple, the lowest matching interface wins */
+  for (i = 0; i < idx->nb_class; i++)
   {
-    pif = &pcfg->Itf_Desc[if_ix];
-    if(((pif->bInterfaceClass == Class) || (Class == 0xFF))&&
-       ((pif->bInterfaceSubClass == SubClass) || (SubClass == 0xFF))&&
-         ((pif->bInterfaceProtocol == Protocol) || (Protocol == 0xFF)))
+    pcls = &idx->cls[i];
+    if(((pcls->bInterfaceClass == Class) || (Class == 0xFF))&&
+       ((pcls->bInterfaceSubClass == SubClass) || (SubClass == 0xFF))&&
+         ((pcls->bInterfaceProtocol == Protocol) || (Protocol == 0xFF)))
     {
-      return  if_ix;
+      if (pcls->first < if_ix)
+      {
+        if_ix = pcls->first;
+      }
     }
-    if_ix++;
   }
-  return 0xFF;
+  return if_ix;
+}
+
+/**
+  * @brief  USBH_FindNextInterface 
+  *         Find the next interface with the same class, subclass and protocol.
+  * @param  phost: Host Handle
+  * @param  interface: interface index returned by USBH_FindInterface or
+  *         a previous USBH_FindNextInterface call
+  * @retval interface index in the configuration structure
+  * @note : (1)interface index 0xFF means no more interface
+  */
+uint8_t  USBH_FindNextInterface(USBH_HandleTypeDef *phost, uint8_t interface)
+{
+  USBH_CfgIndexTypeDef         *idx = &phost->device.CfgDesc.Index;
+  
+  if (interface >= idx->nb_itf)
+  {
+    return 0xFF;
+  }
+  return idx->itf[interface].next;
+}
+
+/**
+  * @brief  USBH_FindEndpoint 
+  *         Find the first endpoint of an interface with a transfer type and direction.
+  * @param  phost: Host Handle
+  * @param  interface: interface index in the configuration structure
+  * @param  ep_type: USB_EP_TYPE_xxx
+  * @param  ep_dir: USB_EP_DIR_IN or USB_EP_DIR_OUT
+  * @retval endpoint descriptor, NULL if the interface has no such endpoint
+  */
+USBH_EpDescTypeDef *USBH_FindEndpoint(USBH_HandleTypeDef *phost, uint8_t interface, 
+                                      uint8_t ep_type, uint8_t ep_dir)
+{
+  USBH_CfgDescTypeDef          *pcfg = &phost->device.CfgDesc;
+  uint8_t                       ep_ix;
+  
+  if (interface >= pcfg->Index.nb_itf)
+  {
+    return NULL;
+  }
+  
+  ep_ix = pcfg->Index.itf[interface].ep[USBH_EP_SLOT(ep_type, ep_dir)];
+  if (ep_ix == USBH_NO_INDEX)
+  {
+    return NULL;
+  }
+  return &pcfg->Itf_Desc[interface].Ep_Desc[ep_ix];
 }
 
 /**
@@ -554,7 +655,7 @@ uint8_t  USBH_FindInterfaceIndex(USBH_HandleTypeDef *phost, uint8_t interface_nu
   pif = (USBH_InterfaceDescTypeDef *)0;
   pcfg = &phost->device.CfgDesc;  
   
-  while (if_ix < USBH_MAX_NUM_INTERFACES)
+  while (if_ix < pcfg->Index.nb_itf)
   {
     pif = &pcfg->Itf_Desc[if_ix];
     if((pif->bInterfaceNumber == interface_number) && (pif->bAlternateSetting == alt_settings))
@@ -645,34 +746,8 @@ USBH_StatusTypeDef USBH_ProcessEvent(USBH_HandleTypeDef * phost)
 {
   static USBH_EventTypeDef e;
 
-  static char buf[128];
-
-pop:
   e = USBH_GetEvent();
 
-  if (e.evt == USBH_EVT_HCINT) {
-
-    memset(buf, 0, 128);
-
-    hcint2string(buf, e.data.hcint.hcint_reg);
-
-    printf(" :: HCINT %08x, %02x, %04x, %s, %s, %s %s, %s %s, %d %d, - %08u" NEW_LINE,
-        e.data.hcint.uid,
-        (unsigned int)e.data.hcint.interrupt,
-        (unsigned int)e.data.hcint.hcint_reg,
-        buf,
-        ((e.data.hcint.direction == 0) ? "OUT" : "IN"),
-        channel_state_string[e.data.hcint.in_state],
-        channel_state_string[e.data.hcint.out_state],
-        urb_state_string[e.data.hcint.in_urbstate],
-        urb_state_string[e.data.hcint.out_urbstate],
-        e.data.hcint.in_err_count,
-        e.data.hcint.out_err_count,
-        (unsigned int)e.timestamp);
-
-    goto pop;
-  }
-
   USBH_DebugOutput(phost, e, 0);
 
 #if 1
@@ -1108,16 +1183,18 @@ USBH_StatusTypeDef USBH_Process(USBH_HandleTypeDef *phost)
     for (idx = 0; idx < phost->ClassNumber; idx++)
     {
       // search all interfaces, not only interface 0
-      for (j = 0; j < phost->device.CfgDesc.bNumInterfaces; j++)
+      // (exact match, 0xFF is the vendor class here, not a wildcard)
+      for (j = 0; j < phost->device.CfgDesc.Index.nb_class; j++)
       {
 
         if (phost->pClass[idx]->ClassCode
-            == phost->device.CfgDesc.Itf_Desc[j].bInterfaceClass)
+            == phost->device.CfgDesc.Index.cls[j].bInterfaceClass)
         {
           phost->pActiveClass = phost->pClass[idx];
           USBH_UsrLog(
               "Registered %s class with code 0x%02x matches interface #%d",
-              phost->pClass[idx]->Name, phost->pClass[idx]->ClassCode, j);
+              phost->pClass[idx]->Name, phost->pClass[idx]->ClassCode,
+              phost->device.CfgDesc.Index.cls[j].first);
           break;
         }
       }
@@ -1487,18 +1564,6 @@ USBH_StatusTypeDef USBH_LL_PortDown (USBH_HandleTypeDef *phost)
 	return USBH_OK;
 }
 
-/*********************************************************************/
-
-USBH_StatusTypeDef USBH_LL_HCINT(USBH_HandleTypeDef *phost, struct hcint_t * hcint) {
-
-  USBH_EventTypeDef e;
-  e.evt = USBH_EVT_HCINT;
-  e.timestamp = HAL_GetTick();
-  e.data.hcint = *hcint;
-  USBH_PutEvent(e);
-  return USBH_OK;
-}
-
 /*****************************************************************************/
 /*
  * This function setup communication pipes and kick start host gstate machine.
@@ -1514,6 +1579,9 @@ static USBH_StatusTypeDef USBH_HandlePortUp(USBH_HandleTypeDef *phost)
   phost->device.speed = USBH_LL_GetSpeed(phost);
   phost->gState = HOST_ENUMERATION;
 
+  /* channel statistics cover one attachment */
+  USBH_LL_ResetStats(phost);
+
   /* Debug output:
    * USBH_AllocPipe ep_addr 0000 pipe 0
    * USBH_AllocPipe ep_addr 0080 pipe 1
@@ -1555,6 +1623,9 @@ static USBH_StatusTypeDef  USBH_HandlePortDown(USBH_HandleTypeDef *phost) {
   ASSERT(phost->pState == PORT_UP);
   ASSERT(phost->gState != HOST_IDLE);
 
+  /* final totals of the session */
+  USBH_PrintStats(phost);
+
   USBH_LL_Stop(phost);
 
   /* Re-Initialize Host for new Enumeration */
@@ -62,6 +62,11 @@
 
 
 
+/* Configuration descriptor data stage chunk. The HAL starts every control
+ * IN transfer with DATA1, so a chunk must be an even number of max packets
+ * to keep the toggle right across chunks: 128 holds for EP0 sizes 8 to 64. */
+#define USBH_CFG_DESC_CHUNK             128
+
 /** @defgroup USBH_CTLREQ_Private_Variables
 * @{
 */
@@ -76,14 +81,20 @@ static USBH_StatusTypeDef USBH_HandleControl (USBH_HandleTypeDef *phost);
 
 static void USBH_ParseDevDesc (USBH_DevDescTypeDef* , uint8_t *buf, uint16_t length);
 
-static void USBH_ParseCfgDesc (USBH_CfgDescTypeDef* cfg_desc,
-                               uint8_t *buf, 
-                               uint16_t length);
+static void USBH_CfgParseBegin (USBH_HandleTypeDef *phost);
+static void USBH_CfgParseChunk (USBH_HandleTypeDef *phost, uint8_t *data, uint16_t length);
+static void USBH_CfgParseEnd (USBH_HandleTypeDef *phost);
+static void USBH_CfgParseDesc (USBH_HandleTypeDef *phost, uint8_t *buf);
+static void USBH_CfgCloseInterface (USBH_HandleTypeDef *phost);
+static uint8_t USBH_CfgWantsInterface (USBH_HandleTypeDef *phost, uint8_t class_code);
+static void USBH_SetupGetDescriptor (USBH_HandleTypeDef *phost, uint8_t req_type,
+                                     uint16_t value_idx, uint16_t length);
 
 
 static void USBH_ParseEPDesc (USBH_EpDescTypeDef  *ep_descriptor, uint8_t *buf);
 static void USBH_ParseStringDesc (uint8_t* psrc, uint8_t* pdest, uint16_t length);
 static void USBH_ParseInterfaceDesc (USBH_InterfaceDescTypeDef  *if_descriptor, uint8_t *buf);
+static void USBH_IndexInterface (USBH_CfgDescTypeDef* cfg_desc, uint8_t if_ix);
 
 
 /**
@@ -112,9 +123,10 @@ USBH_StatusTypeDef USBH_Get_DevDesc(USBH_HandleTypeDef *phost, uint8_t length)
 
 /**
   * @brief  USBH_Get_CfgDesc
-  *         Issues Configuration Descriptor to the device. Once the response 
-  *         received, it parses the configuartion descriptor and updates the 
-  *         status.
+  *         Issues Configuration Descriptor to the device. The data stage is
+  *         received in USBH_CFG_DESC_CHUNK pieces and parsed as it arrives,
+  *         so the descriptor length is not limited by any buffer. Only the
+  *         interfaces a registered class wants are kept.
   * @param  phost: Host Handle
   * @param  length: Length of the descriptor
   * @retval USBH Status
@@ -124,24 +136,26 @@ USBH_StatusTypeDef USBH_Get_CfgDesc(USBH_HandleTypeDef *phost,
 
 {
   USBH_StatusTypeDef status;
-  uint8_t *pData;
-#if (USBH_KEEP_CFG_DESCRIPTOR == 1)  
-  pData = phost->device.CfgDesc_Raw;
-#else
-  pData = phost->device.Data;
-#endif  
-  if((status = USBH_GetDescriptor(phost,
-                                  USB_REQ_RECIPIENT_DEVICE | USB_REQ_TYPE_STANDARD,                          
-                                  USB_DESC_CONFIGURATION, 
-                                  pData,
-                                  length)) == USBH_OK)
+  
+  if(phost->RequestState == CMD_SEND)
   {
+    USBH_SetupGetDescriptor(phost,
+                            USB_REQ_RECIPIENT_DEVICE | USB_REQ_TYPE_STANDARD,
+                            USB_DESC_CONFIGURATION, 
+                            length);
+    USBH_CfgParseBegin(phost);
     
+    /* USBH_CtlReq resets the sink when it starts a request */
+    status = USBH_CtlReq(phost, phost->device.Data, length);
+    phost->Control.sink = USBH_CfgParseChunk;
+    phost->Control.chunk = USBH_CFG_DESC_CHUNK;
+    return status;
+  }
+  
+  if((status = USBH_CtlReq(phost, phost->device.Data, length)) == USBH_OK)
+  {
     /* Commands successfully sent and Response Received  */       
-    USBH_ParseCfgDesc (&phost->device.CfgDesc,
-                       pData,
-                       length); 
-    
+    USBH_CfgParseEnd(phost);
   }
   return status;
 }
@@ -194,23 +208,40 @@ USBH_StatusTypeDef USBH_GetDescriptor(USBH_HandleTypeDef *phost,
 { 
   if(phost->RequestState == CMD_SEND)
   {
-    phost->Control.setup.b.bmRequestType = USB_D2H | req_type;
-    phost->Control.setup.b.bRequest = USB_REQ_GET_DESCRIPTOR;
-    phost->Control.setup.b.wValue.w = value_idx;
-    
-    if ((value_idx & 0xff00) == USB_DESC_STRING)
-    {
-      phost->Control.setup.b.wIndex.w = 0x0409;
-    }
-    else
-    {
-      phost->Control.setup.b.wIndex.w = 0;
-    }
-    phost->Control.setup.b.wLength.w = length; 
+    USBH_SetupGetDescriptor(phost, req_type, value_idx, length);
   }
   return USBH_CtlReq(phost, buff , length );     
 }
 
+/**
+  * @brief  USBH_SetupGetDescriptor
+  *         Fill the setup packet of a GetDescriptor request.
+  * @param  phost: Host Handle
+  * @param  req_type: Descriptor type
+  * @param  value_idx: wValue for the GetDescriptr request
+  * @param  length: Length of the descriptor
+  * @retval None
+  */
+static void USBH_SetupGetDescriptor(USBH_HandleTypeDef *phost,
+                                    uint8_t  req_type,
+                                    uint16_t value_idx, 
+                                    uint16_t length)
+{
+  phost->Control.setup.b.bmRequestType = USB_D2H | req_type;
+  phost->Control.setup.b.bRequest = USB_REQ_GET_DESCRIPTOR;
+  phost->Control.setup.b.wValue.w = value_idx;
+  
+  if ((value_idx & 0xff00) == USB_DESC_STRING)
+  {
+    phost->Control.setup.b.wIndex.w = 0x0409;
+  }
+  else
+  {
+    phost->Control.setup.b.wIndex.w = 0;
+  }
+  phost->Control.setup.b.wLength.w = length; 
+}
+
 /**
   * @brief  USBH_SetAddress
   *         This command sets the address to the connected device
@@ -341,71 +372,278 @@ static void  USBH_ParseDevDesc (USBH_DevDescTypeDef* dev_desc,
 }
 
 /**
-  * @brief  USBH_ParseCfgDesc 
-  *         This function Parses the configuration descriptor
-  * @param  cfg_desc: Configuration Descriptor address
-  * @param  buf: Buffer where the source descriptor is available
-  * @param  length: Length of the descriptor
+  * @brief  USBH_CfgWantsInterface 
+  *         Tell if a registered class handles an interface class code.
+  *         Without any registered class every interface is kept.
+  * @param  phost: Host Handle
+  * @param  class_code: bInterfaceClass
+  * @retval 1 to keep the interface, 0 to skip it
+  */
+static uint8_t USBH_CfgWantsInterface (USBH_HandleTypeDef *phost, uint8_t class_code)
+{
+  uint32_t idx;
+  
+  if (phost->ClassNumber == 0)
+  {
+    return 1;
+  }
+  
+  for (idx = 0; idx < phost->ClassNumber; idx++)
+  {
+    if (phost->pClass[idx]->ClassCode == class_code)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  USBH_CfgParseBegin 
+  *         Reset the configuration descriptor parser before a new transfer.
+  * @param  phost: Host Handle
   * @retval None
   */
-static void USBH_ParseCfgDesc (USBH_CfgDescTypeDef* cfg_desc,
-                               uint8_t *buf, 
-                               uint16_t length)
-{  
-  USBH_InterfaceDescTypeDef    *pif ;
-  USBH_EpDescTypeDef           *pep;  
-  USBH_DescHeader_t             *pdesc = (USBH_DescHeader_t *)buf;
-  uint16_t                      ptr;
-  int8_t                        if_ix = 0;
-  int8_t                        ep_ix = 0;  
+static void USBH_CfgParseBegin (USBH_HandleTypeDef *phost)
+{
+  USBH_CfgDescTypeDef *cfg_desc = &phost->device.CfgDesc;
   
-  pdesc   = (USBH_DescHeader_t *)buf;
+  USBH_memset(&phost->device.CfgParser, 0, sizeof(phost->device.CfgParser));
+  phost->device.CfgParser.if_ix = USBH_NO_INDEX;
   
-  /* Parse configuration descriptor */
-  cfg_desc->bLength             = *(uint8_t  *) (buf + 0);
-  cfg_desc->bDescriptorType     = *(uint8_t  *) (buf + 1);
-  cfg_desc->wTotalLength        = LE16 (buf + 2);
-  cfg_desc->bNumInterfaces      = *(uint8_t  *) (buf + 4);
-  cfg_desc->bConfigurationValue = *(uint8_t  *) (buf + 5);
-  cfg_desc->iConfiguration      = *(uint8_t  *) (buf + 6);
-  cfg_desc->bmAttributes        = *(uint8_t  *) (buf + 7);
-  cfg_desc->bMaxPower           = *(uint8_t  *) (buf + 8);    
+  USBH_memset(cfg_desc->Itf_Desc, 0, sizeof(cfg_desc->Itf_Desc));
+  USBH_memset(&cfg_desc->Index, 0, sizeof(cfg_desc->Index));
+}
+
+/**
+  * @brief  USBH_CfgParseChunk 
+  *         Control data stage sink: split the incoming bytes into descriptors.
+  *         Only the head of each descriptor is buffered, longer class specific
+  *         descriptors are skipped, so memory does not grow with wTotalLength.
+  * @param  phost: Host Handle
+  * @param  data: received bytes
+  * @param  length: number of received bytes
+  * @retval None
+  */
+static void USBH_CfgParseChunk (USBH_HandleTypeDef *phost, uint8_t *data, uint16_t length)
+{
+  USBH_CfgParserTypeDef *p = &phost->device.CfgParser;
   
+#if (USBH_KEEP_CFG_DESCRIPTOR == 1)  
+  if (p->offset < USBH_MAX_SIZE_CONFIGURATION)
+  {
+    USBH_memcpy(&phost->device.CfgDesc_Raw[p->offset], data,
+                (length < USBH_MAX_SIZE_CONFIGURATION - p->offset) ?
+                length : USBH_MAX_SIZE_CONFIGURATION - p->offset);
+  }
+#endif  
+  p->offset += length;
   
-  if (length > USB_CONFIGURATION_DESC_SIZE)
+  while ((length > 0) && (p->error == 0))
   {
-    ptr = USB_LEN_CFG_DESC;
-    pif = (USBH_InterfaceDescTypeDef *)0;
+    if (p->have < sizeof(p->desc))
+    {
+      p->desc[p->have] = *data;
+    }
+    p->have++;
+    data++;
+    length--;
     
+    if ((p->have == 1) && (p->desc[0] < 2))
+    {
+      /* a zero or one byte descriptor would never end */
+      USBH_ErrLog("Malformed configuration descriptor, %d bytes",
+                  p->desc[0]);
+      p->error = 1;
+    }
+    else if ((p->have > 1) && (p->have == p->desc[0]))
+    {
+      USBH_CfgParseDesc(phost, p->desc);
+      p->have = 0;
+    }
+  }
+}
+
+/**
+  * @brief  USBH_CfgParseDesc 
+  *         Handle one complete descriptor of the configuration.
+  * @param  phost: Host Handle
+  * @param  buf: descriptor head, at most USB_CONFIGURATION_DESC_SIZE bytes
+  * @retval None
+  */
+static void USBH_CfgParseDesc (USBH_HandleTypeDef *phost, uint8_t *buf)
+{
+  USBH_CfgParserTypeDef     *p = &phost->device.CfgParser;
+  USBH_CfgDescTypeDef       *cfg_desc = &phost->device.CfgDesc;
+  USBH_InterfaceDescTypeDef *pif;
+  USBH_DescHeader_t         *pdesc = (USBH_DescHeader_t *)buf;
+  
+  switch (pdesc->bDescriptorType)
+  {
+  case USB_DESC_TYPE_CONFIGURATION:
+    if (pdesc->bLength < USB_CONFIGURATION_DESC_SIZE)
+    {
+      break;
+    }
+    cfg_desc->bLength             = *(uint8_t  *) (buf + 0);
+    cfg_desc->bDescriptorType     = *(uint8_t  *) (buf + 1);
+    cfg_desc->wTotalLength        = LE16 (buf + 2);
+    cfg_desc->bNumInterfaces      = *(uint8_t  *) (buf + 4);
+    cfg_desc->bConfigurationValue = *(uint8_t  *) (buf + 5);
+    cfg_desc->iConfiguration      = *(uint8_t  *) (buf + 6);
+    cfg_desc->bmAttributes        = *(uint8_t  *) (buf + 7);
+    cfg_desc->bMaxPower           = *(uint8_t  *) (buf + 8);    
+    break;
     
-    while ((if_ix < USBH_MAX_NUM_INTERFACES ) && (ptr < cfg_desc->wTotalLength))
+  case USB_DESC_TYPE_INTERFACE:
+    USBH_CfgCloseInterface(phost);
+    if (pdesc->bLength < USB_INTERFACE_DESC_SIZE)
     {
-      pdesc = USBH_GetNextDesc((uint8_t *)pdesc, &ptr);
-      if (pdesc->bDescriptorType   == USB_DESC_TYPE_INTERFACE) 
-      {
-        pif = &cfg_desc->Itf_Desc[if_ix];
-        USBH_ParseInterfaceDesc (pif, (uint8_t *)pdesc);            
-        
-        ep_ix = 0;
-        pep = (USBH_EpDescTypeDef *)0;        
-        while ((ep_ix < pif->bNumEndpoints) && (ptr < cfg_desc->wTotalLength))
-        {
-          pdesc = USBH_GetNextDesc((void* )pdesc, &ptr);
-          if (pdesc->bDescriptorType   == USB_DESC_TYPE_ENDPOINT) 
-          {  
-            pep = &cfg_desc->Itf_Desc[if_ix].Ep_Desc[ep_ix];
-            USBH_ParseEPDesc (pep, (uint8_t *)pdesc);
-            ep_ix++;
-          }
-        }
-        if_ix++;
-      }
+      break;
     }
-  }  
+    
+    if ((p->nb_itf < USBH_MAX_NUM_INTERFACES) &&
+        USBH_CfgWantsInterface(phost, buf[5]))
+    {
+      p->if_ix = p->nb_itf++;
+      p->ep_ix = 0;
+      pif = &cfg_desc->Itf_Desc[p->if_ix];
+      USBH_ParseInterfaceDesc (pif, buf);
+    }
+    else
+    {
+      USBH_DbgLog("Skip interface %d alt %d, class %02xh",
+                  buf[2], buf[3], buf[5]);
+      p->skipped_itf++;
+    }
+    break;
+    
+  case USB_DESC_TYPE_ENDPOINT:
+    if ((p->if_ix == USBH_NO_INDEX) || (pdesc->bLength < USB_ENDPOINT_DESC_SIZE))
+    {
+      break;
+    }
+    if (p->ep_ix < USBH_MAX_NUM_ENDPOINTS)
+    {
+      USBH_ParseEPDesc (&cfg_desc->Itf_Desc[p->if_ix].Ep_Desc[p->ep_ix], buf);
+      p->ep_ix++;
+    }
+    else
+    {
+      p->skipped_ep++;
+    }
+    break;
+    
+  default:
+    /* class specific and other descriptors are not kept */
+    break;
+  }
+}
+
+/**
+  * @brief  USBH_CfgCloseInterface 
+  *         Finish the open interface: bNumEndpoints becomes the number of
+  *         endpoints actually stored and the interface enters the index.
+  * @param  phost: Host Handle
+  * @retval None
+  */
+static void USBH_CfgCloseInterface (USBH_HandleTypeDef *phost)
+{
+  USBH_CfgParserTypeDef *p = &phost->device.CfgParser;
+  
+  if (p->if_ix != USBH_NO_INDEX)
+  {
+    phost->device.CfgDesc.Itf_Desc[p->if_ix].bNumEndpoints = p->ep_ix;
+    USBH_IndexInterface (&phost->device.CfgDesc, p->if_ix);
+    p->if_ix = USBH_NO_INDEX;
+  }
+}
+
+/**
+  * @brief  USBH_CfgParseEnd 
+  *         Complete the parsing once the data stage is over and report what
+  *         was left out.
+  * @param  phost: Host Handle
+  * @retval None
+  */
+static void USBH_CfgParseEnd (USBH_HandleTypeDef *phost)
+{
+  USBH_CfgParserTypeDef *p = &phost->device.CfgParser;
+  
+  USBH_CfgCloseInterface(phost);
+  
+  if ((p->skipped_itf != 0) || (p->skipped_ep != 0))
+  {
+    USBH_UsrLog("Configuration %d bytes: kept %d interfaces, skipped %d interfaces, %d endpoints",
+                p->offset, p->nb_itf, p->skipped_itf, p->skipped_ep);
+  }
 }
 
 
 
+/**
+  * @brief  USBH_IndexInterface 
+  *         Add a parsed interface to the configuration index: chain it to
+  *         the interfaces sharing its class triple and record the first
+  *         endpoint of each transfer type and direction.
+  * @param  cfg_desc: Configuration Descriptor address
+  * @param  if_ix: Itf_Desc index of the interface
+  * @retval None
+  */
+static void USBH_IndexInterface (USBH_CfgDescTypeDef* cfg_desc, uint8_t if_ix)
+{
+  USBH_CfgIndexTypeDef       *idx = &cfg_desc->Index;
+  USBH_InterfaceDescTypeDef  *pif = &cfg_desc->Itf_Desc[if_ix];
+  USBH_ItfIndexTypeDef       *pitf = &idx->itf[if_ix];
+  USBH_ClassIndexTypeDef     *pcls;
+  uint8_t                     i, slot, last;
+  uint8_t                     nb_ep;
+  
+  USBH_memset(pitf->ep, USBH_NO_INDEX, sizeof(pitf->ep));
+  pitf->next = USBH_NO_INDEX;
+  
+  nb_ep = (pif->bNumEndpoints <= USBH_MAX_NUM_ENDPOINTS) ? 
+    pif->bNumEndpoints : USBH_MAX_NUM_ENDPOINTS;
+  
+  for (i = 0; i < nb_ep; i++)
+  {
+    slot = USBH_EP_SLOT(pif->Ep_Desc[i].bmAttributes, pif->Ep_Desc[i].bEndpointAddress);
+    if (pitf->ep[slot] == USBH_NO_INDEX)
+    {
+      pitf->ep[slot] = i;
+    }
+  }
+  
+  for (i = 0; i < idx->nb_class; i++)
+  {
+    pcls = &idx->cls[i];
+    if ((pcls->bInterfaceClass == pif->bInterfaceClass) &&
+        (pcls->bInterfaceSubClass == pif->bInterfaceSubClass) &&
+        (pcls->bInterfaceProtocol == pif->bInterfaceProtocol))
+    {
+      /* interfaces are parsed in order, append at the tail */
+      last = pcls->first;
+      while (idx->itf[last].next != USBH_NO_INDEX)
+      {
+        last = idx->itf[last].next;
+      }
+      idx->itf[last].next = if_ix;
+      break;
+    }
+  }
+  
+  if (i == idx->nb_class)
+  {
+    pcls = &idx->cls[idx->nb_class++];
+    pcls->bInterfaceClass = pif->bInterfaceClass;
+    pcls->bInterfaceSubClass = pif->bInterfaceSubClass;
+    pcls->bInterfaceProtocol = pif->bInterfaceProtocol;
+    pcls->first = if_ix;
+  }
+  
+  idx->nb_itf = if_ix + 1;
+}
+
 /**
   * @brief  USBH_ParseInterfaceDesc 
   *         This function Parses the interface descriptor
@@ -526,6 +764,7 @@ USBH_StatusTypeDef USBH_CtlReq(USBH_HandleTypeDef *phost,
     /* Start a SETUP transfer */
     phost->Control.buff = buff; 
     phost->Control.length = length;
+    phost->Control.sink = NULL;
     phost->Control.state = CTRL_SETUP;  
     phost->RequestState = CMD_WAIT;
 
@@ -580,6 +819,7 @@ USBH_StatusTypeDef USBH_CtlReq(USBH_HandleTypeDef *phost,
 static USBH_StatusTypeDef USBH_HandleControl (USBH_HandleTypeDef *phost)
 {
   uint8_t direction;  
+  uint16_t length, received;
   USBH_StatusTypeDef status = USBH_BUSY;
   USBH_URBStateTypeDef URB_Status = USBH_URB_IDLE;
   
@@ -649,9 +889,14 @@ static USBH_StatusTypeDef USBH_HandleControl (USBH_HandleTypeDef *phost)
   case CTRL_DATA_IN:  
     /* Issue an IN token */ 
      phost->Control.timer = phost->Timer;
+    length = phost->Control.length;
+    if ((phost->Control.sink != NULL) && (length > phost->Control.chunk))
+    {
+      length = phost->Control.chunk;
+    }
     USBH_CtlReceiveData(phost,
                         phost->Control.buff, 
-                        phost->Control.length,
+                        length,
                         phost->Control.pipe_in);
  
     phost->Control.state = CTRL_DATA_IN_WAIT;
@@ -664,6 +909,28 @@ static USBH_StatusTypeDef USBH_HandleControl (USBH_HandleTypeDef *phost)
     if  (URB_Status == USBH_URB_DONE)
     { 
       phost->Control.state = CTRL_STATUS_OUT;
+      
+      if (phost->Control.sink != NULL)
+      {
+        length = phost->Control.length;
+        if (length > phost->Control.chunk)
+        {
+          length = phost->Control.chunk;
+        }
+        received = USBH_LL_GetLastXferSize(phost, phost->Control.pipe_in);
+        if (received > length)
+        {
+          received = length;
+        }
+        phost->Control.sink(phost, phost->Control.buff, received);
+        phost->Control.length -= received;
+        
+        /* a full chunk with data left: fetch the next one, a short one ends the stage */
+        if ((received == length) && (phost->Control.length != 0))
+        {
+          phost->Control.state = CTRL_DATA_IN;
+        }
+      }
 #if (USBH_USE_OS == 1)
     osMessagePut ( phost->os_event, USBH_CONTROL_EVENT, 0);
 #endif      
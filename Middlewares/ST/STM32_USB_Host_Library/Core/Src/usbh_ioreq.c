@@ -282,6 +282,30 @@ USBH_StatusTypeDef USBH_InterruptSendData(USBH_HandleTypeDef *phost,
   return USBH_OK;
 }
 
+/**
+  * @brief  USBH_RearmReceiveData
+  *         Issues another IN transfer on a bulk or interrupt IN pipe whose
+  *         address, endpoint and type are unchanged, reloading only the
+  *         buffer and length of the channel.
+  * @param  phost: Host Handle
+  * @param  buff: Buffer pointer in which the response needs to be copied
+  * @param  length: Length of the data to be received
+  * @param  pipe_num: Pipe Number
+  * @retval USBH Status. 
+  */
+USBH_StatusTypeDef USBH_RearmReceiveData(USBH_HandleTypeDef *phost, 
+                                uint8_t *buff, 
+                                uint16_t length,
+                                uint8_t pipe_num)
+{
+  USBH_LL_RearmURB (phost,          /* Driver handle    */
+                          pipe_num,             /* Pipe index       */
+                          buff,                 /* data buffer      */
+                          length);              /* data length      */
+  
+  return USBH_OK;
+}
+
 /**
   * @brief  USBH_IsocReceiveData
   *         Receives the Device Response to the Isochronous IN token
@@ -49,7 +49,9 @@ ApplicationTypeDef Appli_state = APPLICATION_IDLE;
 * -- Insert your variables declaration here --
 */ 
 /* USER CODE BEGIN 0 */
-
+#if (USBH_STATS_INTERVAL > 0)
+static uint32_t stats_tick;
+#endif
 /* USER CODE END 0 */
 
 /*
@@ -108,6 +110,15 @@ void MX_USB_HOST_Process()
   /* USB Host Background task */
     USBH_ProcessEvent(&hUsbHostHS);
     // USBH_Process(&hUsbHostFS);
+
+#if (USBH_STATS_INTERVAL > 0)
+    /* channel statistics while the device is in use */
+    if (Appli_state == APPLICATION_READY && HAL_GetTick() - stats_tick >= USBH_STATS_INTERVAL)
+    {
+      stats_tick = HAL_GetTick();
+      USBH_PrintStats(&hUsbHostHS);
+    }
+#endif
 }
 
 /*
@@ -39,6 +39,37 @@
 HCD_HandleTypeDef hhcd_USB_OTG_FS;
 HCD_HandleTypeDef hhcd_USB_OTG_HS;
 
+/* phost->Timer when the last URB of each channel completed, FS then HS */
+static volatile uint32_t hc_urb_time[2][15];
+
+/*
+ * OTG FIFO partitions, in 32-bit words, indexed by USBH_FIFO_PROFILE_xxx.
+ * HID heavy grows the Rx FIFO for many small interrupt IN reports, bulk
+ * heavy grows the non periodic Tx FIFO for AOA bulk OUT writes, balanced
+ * is the split USB_HostInit uses by default.
+ */
+typedef struct
+{
+  const char *name;
+  uint16_t    rx;
+  uint16_t    nptx;
+  uint16_t    ptx;
+} USBH_FifoProfileTypeDef;
+
+static const USBH_FifoProfileTypeDef fifo_profiles_fs[] =
+{
+  { "balanced",   0x80,  0x60,  0x40  },
+  { "hid-heavy",  0xA0,  0x40,  0x60  },
+  { "bulk-heavy", 0x80,  0xA0,  0x20  },
+};
+
+static const USBH_FifoProfileTypeDef fifo_profiles_hs[] =
+{
+  { "balanced",   0x200, 0x100, 0xE0  },
+  { "hid-heavy",  0x280, 0x80,  0x100 },
+  { "bulk-heavy", 0x180, 0x200, 0x80  },
+};
+
 /*******************************************************************************
                        LL Driver Callbacks (HCD -> USB Host Library)
 *******************************************************************************/
@@ -186,11 +217,75 @@ void HAL_HCD_Disconnect_Callback(HCD_HandleTypeDef *hhcd)
   */
 void HAL_HCD_HC_NotifyURBChange_Callback(HCD_HandleTypeDef *hhcd, uint8_t chnum, HCD_URBStateTypeDef urb_state)
 {
+  if (urb_state == URB_DONE && chnum < 15)
+  {
+    hc_urb_time[hhcd == &hhcd_USB_OTG_HS][chnum] = ((USBH_HandleTypeDef *)hhcd->pData)->Timer;
+  }
+
   /* To be used with OS to sync URB state with the global state machine */
 #if (USBH_USE_OS == 1)   
   USBH_LL_NotifyURBChange(hhcd->pData);
 #endif 
 }
+/**
+  * @brief  USBH_LL_SetFifoProfile 
+  *         Program a FIFO partition profile in the HCD init parameters.
+  *         The profile must fit in the FIFO RAM of the core and give every
+  *         FIFO room for at least one full speed max packet, otherwise the
+  *         default partition of USB_HostInit is kept.
+  * @param  hhcd: HCD handle, Instance must be set
+  * @param  profile: USBH_FIFO_PROFILE_xxx
+  * @retval Status
+  */
+static USBH_StatusTypeDef USBH_LL_SetFifoProfile(HCD_HandleTypeDef *hhcd, uint32_t profile)
+{
+  const USBH_FifoProfileTypeDef *p;
+  uint32_t count, total;
+  uint32_t min = USB_OTG_FS_MAX_PACKET_SIZE / 4;
+  
+  hhcd->Init.Host_rx_fifo_size = 0;
+  hhcd->Init.Host_nptx_fifo_size = 0;
+  hhcd->Init.Host_ptx_fifo_size = 0;
+  
+  if (hhcd->Instance == USB_OTG_FS)
+  {
+    p = fifo_profiles_fs;
+    count = sizeof(fifo_profiles_fs) / sizeof(fifo_profiles_fs[0]);
+    total = USB_OTG_FS_TOTAL_FIFO_SIZE;
+  }
+  else
+  {
+    p = fifo_profiles_hs;
+    count = sizeof(fifo_profiles_hs) / sizeof(fifo_profiles_hs[0]);
+    total = USB_OTG_HS_TOTAL_FIFO_SIZE;
+  }
+  
+  if (profile >= count)
+  {
+    USBH_ErrLog("FIFO profile %u unknown, default partition kept", (unsigned int)profile);
+    return USBH_FAIL;
+  }
+  p += profile;
+  
+  /* the Rx FIFO also stores one status word per packet and per channel halt */
+  if ((p->rx + p->nptx + p->ptx > total) ||
+      (p->rx < min + 2) || (p->nptx < min) || (p->ptx < min))
+  {
+    USBH_ErrLog("FIFO profile %s does not fit %u words, default partition kept",
+                p->name, (unsigned int)total);
+    return USBH_FAIL;
+  }
+  
+  hhcd->Init.Host_rx_fifo_size = p->rx;
+  hhcd->Init.Host_nptx_fifo_size = p->nptx;
+  hhcd->Init.Host_ptx_fifo_size = p->ptx;
+  
+  USBH_UsrLog("FIFO profile %s: rx %u, nptx %u, ptx %u of %u words", p->name,
+              (unsigned int)p->rx, (unsigned int)p->nptx, (unsigned int)p->ptx,
+              (unsigned int)total);
+  return USBH_OK;
+}
+
 /*******************************************************************************
                        LL Driver Interface (USB Host Library --> HCD)
 *******************************************************************************/
@@ -218,6 +313,7 @@ USBH_StatusTypeDef  USBH_LL_Init (USBH_HandleTypeDef *phost)
   hhcd_USB_OTG_FS.Init.low_power_enable = ENABLE;
   hhcd_USB_OTG_FS.Init.vbus_sensing_enable = ENABLE;
   hhcd_USB_OTG_FS.Init.use_external_vbus = ENABLE;
+  USBH_LL_SetFifoProfile(&hhcd_USB_OTG_FS, USBH_FIFO_PROFILE);
   HAL_HCD_Init(&hhcd_USB_OTG_FS);
 
   USBH_LL_SetTimer (phost, HAL_HCD_GetCurrentFrame(&hhcd_USB_OTG_FS));
@@ -236,6 +332,7 @@ USBH_StatusTypeDef  USBH_LL_Init (USBH_HandleTypeDef *phost)
   hhcd_USB_OTG_HS.Init.low_power_enable = ENABLE;
   hhcd_USB_OTG_HS.Init.vbus_sensing_enable = ENABLE;
   hhcd_USB_OTG_HS.Init.use_external_vbus = DISABLE;
+  USBH_LL_SetFifoProfile(&hhcd_USB_OTG_HS, USBH_FIFO_PROFILE);
   HAL_HCD_Init(&hhcd_USB_OTG_HS);
 
   USBH_LL_SetTimer (phost, HAL_HCD_GetCurrentFrame(&hhcd_USB_OTG_HS));
@@ -414,6 +511,37 @@ USBH_StatusTypeDef   USBH_LL_SubmitURB  (USBH_HandleTypeDef *phost,
   return USBH_OK;   
 }
 
+/**
+  * @brief  USBH_LL_RearmURB 
+  *         Re-arm an opened bulk or interrupt IN pipe, falling back to a
+  *         full submission when the HCD can not take the fast path.
+  * @param  phost: Host handle
+  * @param  pipe: Pipe index
+  * @param  pbuff: data buffer
+  * @param  length: data length
+  * @retval Status
+  */
+USBH_StatusTypeDef   USBH_LL_RearmURB  (USBH_HandleTypeDef *phost, 
+                                            uint8_t pipe, 
+                                            uint8_t* pbuff, 
+                                            uint16_t length)
+{
+  HCD_HandleTypeDef *pHandle = phost->pData;
+  
+  if (HAL_HCD_HC_Rearm(pHandle, pipe, pbuff, length) != HAL_OK)
+  {
+    return USBH_LL_SubmitURB(phost,
+                             pipe,
+                             pHandle->hc[pipe].ep_is_in,
+                             pHandle->hc[pipe].ep_type,
+                             1,
+                             pbuff,
+                             length,
+                             0);
+  }
+  return USBH_OK;   
+}
+
 /**
   * @brief   
   * @param  
@@ -425,6 +553,19 @@ USBH_URBStateTypeDef  USBH_LL_GetURBState (USBH_HandleTypeDef *phost, uint8_t pi
   return (USBH_URBStateTypeDef)HAL_HCD_HC_GetURBState (phost->pData, pipe);
 }
 
+/**
+  * @brief  USBH_LL_GetURBTime 
+  *         Return when the last URB of a pipe completed, stamped in the
+  *         channel interrupt rather than when the class notices it.
+  * @param  phost: Host handle
+  * @param  pipe: Pipe index
+  * @retval phost->Timer at completion
+  */
+uint32_t  USBH_LL_GetURBTime (USBH_HandleTypeDef *phost, uint8_t pipe) 
+{
+  return pipe < 15 ? hc_urb_time[phost->pData == &hhcd_USB_OTG_HS][pipe] : phost->Timer;
+}
+
 /**
   * @brief   
   * @param  
@@ -502,6 +643,70 @@ uint8_t  USBH_LL_GetToggle   (USBH_HandleTypeDef *phost, uint8_t pipe)
   return toggle; 
 }
 
+static void USBH_LL_Put32(uint8_t *p, uint32_t val)
+{
+  p[0] = (uint8_t)val;
+  p[1] = (uint8_t)(val >> 8);
+  p[2] = (uint8_t)(val >> 16);
+  p[3] = (uint8_t)(val >> 24);
+}
+
+/**
+  * @brief  USBH_LL_DumpStats 
+  *         Serialize a snapshot of the host channel statistics, see
+  *         USBH_STATS_* in usbh_core.h for the layout.
+  * @param  phost: Host handle
+  * @param  buf: destination buffer
+  * @param  size: buffer size, USBH_STATS_DUMP_SIZE always fits
+  * @retval Number of bytes written, 0 if the buffer is too small
+  */
+uint32_t USBH_LL_DumpStats(USBH_HandleTypeDef *phost, uint8_t *buf, uint32_t size)
+{
+  HCD_HandleTypeDef *pHandle = phost->pData;
+  HCD_HCStatsTypeDef stats;
+  uint32_t nb_channels = pHandle->Init.Host_channels;
+  uint32_t ch, w;
+  uint8_t *rec;
+  
+  if (size < USBH_STATS_HEADER_SIZE + nb_channels * USBH_STATS_RECORD_SIZE)
+  {
+    return 0;
+  }
+  
+  buf[0] = USBH_STATS_MAGIC0;
+  buf[1] = USBH_STATS_MAGIC1;
+  buf[2] = USBH_STATS_VERSION;
+  buf[3] = (uint8_t)nb_channels;
+  USBH_LL_Put32(&buf[4], SystemCoreClock);
+  USBH_LL_Put32(&buf[8], HAL_GetTick() - pHandle->StatsTick);
+  
+  rec = &buf[USBH_STATS_HEADER_SIZE];
+  for (ch = 0; ch < nb_channels; ch++)
+  {
+    HAL_HCD_HC_GetStats(pHandle, ch, &stats);
+    
+    rec[0] = (uint8_t)ch;
+    for (w = 0; w < USBH_STATS_WORDS; w++)
+    {
+      USBH_LL_Put32(&rec[1 + 4 * w], ((uint32_t *)&stats)[w]);
+    }
+    rec += USBH_STATS_RECORD_SIZE;
+  }
+  
+  return (uint32_t)(rec - buf);
+}
+
+/**
+  * @brief  USBH_LL_ResetStats 
+  *         Clear the host channel statistics.
+  * @param  phost: Host handle
+  * @retval None
+  */
+void USBH_LL_ResetStats(USBH_HandleTypeDef *phost)
+{
+  HAL_HCD_ResetStats(phost->pData);
+}
+
 /**
   * @brief   
   * @param  